@@ -60,13 +60,19 @@
     typedef bool U1;                        // unsigned int with length 1; can receive 0 and 1, lowstate and highstate respectively
 
 #elif defined(__GNUC__)
+    #if !defined(__cplusplus)
+        #include <stdbool.h>
+    #endif  // !defined(__cplusplus)
     typedef bool B1;                        // boolean; can receive 'true' or 'false'
     typedef bool U1;                        // unsigned int with length 1; can receive 0 and 1, lowstate and highstate respectively
 #endif  // defined(__GNUC__)
 
 #endif  // !defined(cdefs_h_included)
 
+// may be defined before this header by ports without GIE (host builds)
+#if !defined(EnableInterrupts) && !defined(DisableInterrupts)
 #define EnableInterrupts()  { GIE = highstate; }
 #define DisableInterrupts() { GIE = lowstate; }
+#endif  // !defined(EnableInterrupts) && !defined(DisableInterrupts)
 
 // End of cdefs.h
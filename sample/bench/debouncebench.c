@@ -0,0 +1,228 @@
+/* debouncebench.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Check and speed of the DEBOUNCE_BANK. Two banks (256 inputs in 64-bit words
+// with 3-bit counters, 16 inputs in 8-bit words with 2-bit counters) are ticked
+// with noisy inputs next to a scalar model of one counter per input; the states,
+// the counters and the Changed bits must be equal after every tick, also when
+// the consumer clears Changed with masks narrower than the word. Then the
+// ticks per second of the large bank. The exit status is 1 at a difference.
+//
+//  gcc -O2 -I../.. -o debouncebench debouncebench.c
+//  ./debouncebench [ticks]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define EnableInterrupts()
+#define DisableInterrupts()
+
+#include "cdefs.h"
+#include "timedefs.h"
+
+#define L_WORDS     (4u)
+#define L_BITS      (3u)
+#define S_WORDS     (2u)
+#define S_BITS      (2u)
+#define SPEED_TICKS (10000000u)
+
+DEFINE_DEBOUNCE_BANK(L,uint64_t,L_WORDS,L_BITS)
+DEFINE_DEBOUNCE_BANK(S,uint8_t,S_WORDS,S_BITS)
+
+// scalar model of a bank of up to 256 inputs
+typedef struct {
+    uint32_t Inputs;
+    uint32_t Setting;
+    uint8_t Count[256];
+    uint8_t State[256];
+    uint8_t Changed[256];
+} Model;
+
+static Model ML, MS;
+static uint64_t RawL[L_WORDS];
+static uint8_t RawS[S_WORDS];
+static uint8_t FlatL[64u * L_WORDS], FlatS[8u * S_WORDS];  // one input per byte
+static uint8_t Noise[256];          // chance of a flip of the input, in 1/256
+static uint32_t Seed = 2463534242u;
+static uint32_t Errors;
+
+static inline uint32_t Random(void)
+{
+    Seed ^= Seed << 13;
+    Seed ^= Seed >> 17;
+    Seed ^= Seed << 5;
+    return Seed;
+}
+
+static double Seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void ModelSet(Model *m, uint32_t inputs, uint32_t setting, const uint8_t *raw)
+{
+    uint32_t i;
+
+    m->Inputs = inputs;
+    m->Setting = setting;
+    for (i = 0u; i < inputs; i++) {
+        m->Count[i] = 0u;
+        m->State[i] = raw[i];
+        m->Changed[i] = 0u;
+    }
+}
+
+static void ModelTick(Model *m, const uint8_t *raw)
+{
+    uint32_t i;
+
+    for (i = 0u; i < m->Inputs; i++) {
+        if (raw[i] != m->State[i]) {
+            if (++m->Count[i] == m->Setting) {
+                m->State[i] = raw[i];
+                m->Changed[i] = 1u;
+                m->Count[i] = 0u;
+            }
+        } else if (m->Count[i] != 0u) {
+            m->Count[i]--;
+        }
+    }
+}
+
+// inputs flip with their own noise; the model gets the same values
+#define NEXT_RAW(raw,n,words,flat) { \
+    uint32_t w_, b_; \
+    uint64_t v_; \
+    for (w_ = 0u; w_ < (words); w_++) { \
+        v_ = 0u; \
+        for (b_ = 0u; b_ < (n); b_++) { \
+            if ((Random() & 0xFFu) < Noise[w_ * (n) + b_]) { \
+                flat[w_ * (n) + b_] ^= 1u; \
+            } \
+            v_ |= (uint64_t)flat[w_ * (n) + b_] << b_; \
+        } \
+        raw[w_] = v_; \
+    } \
+}
+
+// the consumer clears some Changed bits: a whole word, one bit with an
+// unsigned int mask or a random 64-bit mask
+#define CONSUME(x,m,n,words) { \
+    uint32_t w_ = Random() % (words), b_ = Random() % 32u, i_; \
+    uint64_t k_; \
+    switch (Random() % 4u) { \
+    case 0u: \
+        k_ = ~0uLL; \
+        ClearDebounceBankChangedI(x,w_,~0uLL); \
+        break; \
+    case 1u: \
+        k_ = 1uLL << b_; \
+        ClearDebounceBankChangedI(x,w_,1u << b_); \
+        break; \
+    case 2u: \
+        k_ = ((uint64_t)Random() << 32) | Random(); \
+        ClearDebounceBankChanged(x,w_,k_); \
+        break; \
+    default: \
+        k_ = 0u; \
+        break; \
+    } \
+    for (i_ = 0u; i_ < (n); i_++) { \
+        if (((k_ >> i_) & 1u) != 0u) { \
+            (m).Changed[w_ * (n) + i_] = 0u; \
+        } \
+    } \
+}
+
+// the bank against the model; n inputs per word
+#define COMPARE(x,m,bits,n,tick) { \
+    uint32_t i_, j_, c_, s_, h_; \
+    for (i_ = 0u; i_ < (m).Inputs; i_++) { \
+        c_ = 0u; \
+        for (j_ = 0u; j_ < (bits); j_++) { \
+            c_ |= (uint32_t)((DB_Count_##x[j_][i_ / (n)] >> (i_ % (n))) & 1u) << j_; \
+        } \
+        s_ = (uint32_t)((DB_State_##x[i_ / (n)] >> (i_ % (n))) & 1u); \
+        h_ = (uint32_t)((DB_Changed_##x[i_ / (n)] >> (i_ % (n))) & 1u); \
+        if ((c_ != (m).Count[i_]) || (s_ != (m).State[i_]) || (h_ != (m).Changed[i_])) { \
+            if (Errors++ < 10u) { \
+                printf("%s tick %u input %u: count %u state %u changed %u, model %u %u %u\n",#x,(tick),i_, \
+                        c_,s_,h_,(m).Count[i_],(m).State[i_],(m).Changed[i_]); \
+            } \
+            break; \
+        } \
+    } \
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t ticks = (argc > 1) ? (uint32_t)strtoul(argv[1],NULL,0) : 200000u;
+    uint32_t t, i, setting;
+    double s;
+
+    // a narrow mask clears one bit of a 64-bit word
+    SetDebounceBankI(L,uint64_t,5u,RawL);
+    DB_Changed_L[0] = ~0uLL;
+    ClearDebounceBankChangedI(L,0u,1u);
+    printf("Changed ~0, cleared with 1u: %016llx\n",(unsigned long long)DB_Changed_L[0]);
+    if (DB_Changed_L[0] != 0xFFFFFFFFFFFFFFFEuLL) {
+        Errors++;
+    }
+
+    for (i = 0u; i < 256u; i++) {
+        Noise[i] = (uint8_t)(Random() % 96u);
+        FlatL[i] = (uint8_t)(Random() & 1u);
+        FlatS[i % (8u * S_WORDS)] = (uint8_t)(Random() & 1u);
+    }
+    NEXT_RAW(RawL,64u,L_WORDS,FlatL)
+    NEXT_RAW(RawS,8u,S_WORDS,FlatS)
+    for (t = 0u; t < ticks; t++) {
+        if ((t % 5000u) == 0u) {
+            setting = 1u + Random() % ((1u << L_BITS) - 1u);
+            SetDebounceBankI(L,uint64_t,setting,RawL);
+            ModelSet(&ML,64u * L_WORDS,setting,FlatL);
+            setting = 1u + Random() % ((1u << S_BITS) - 1u);
+            SetDebounceBankI(S,uint8_t,setting,RawS);
+            ModelSet(&MS,8u * S_WORDS,setting,FlatS);
+        }
+        NEXT_RAW(RawL,64u,L_WORDS,FlatL)
+        NEXT_RAW(RawS,8u,S_WORDS,FlatS)
+        TickDebounceBank(L,uint64_t,RawL);
+        TickDebounceBank(S,uint8_t,RawS);
+        ModelTick(&ML,FlatL);
+        ModelTick(&MS,FlatS);
+        CONSUME(L,ML,64u,L_WORDS)
+        CONSUME(S,MS,8u,S_WORDS)
+        COMPARE(L,ML,L_BITS,64u,t)
+        COMPARE(S,MS,S_BITS,8u,t)
+    }
+    printf("%u ticks of %u + %u inputs: %u differences\n",ticks,64u * L_WORDS,8u * S_WORDS,Errors);
+
+    s = Seconds();
+    for (t = 0u; t < SPEED_TICKS; t++) {
+        RawL[t & (L_WORDS - 1u)] ^= (uint64_t)1u << (t & 63u);
+        TickDebounceBank(L,uint64_t,RawL);
+    }
+    s = Seconds() - s;
+    printf("%u inputs: %.1f ns per tick, %.2f ns per input (state %016llx)\n",64u * L_WORDS,
+            s / SPEED_TICKS * 1e9,s / SPEED_TICKS / (64.0 * L_WORDS) * 1e9,(unsigned long long)DB_State_L[0]);
+    return (Errors == 0u) ? 0 : 1;
+}
+
+// End of debouncebench.c
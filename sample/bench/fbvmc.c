@@ -0,0 +1,66 @@
+/* fbvmc.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Monte Carlo runner of timemc.h; the scenario is given by the arguments.
+//
+//  gcc -O2 -I../.. -o fbvmc fbvmc.c -lpthread -lm
+//  ./fbvmc setting=60000 stepf=3 stepb=2 heat=500 cool=400 horizon=1000000 runs=100000
+
+#include <stdio.h>
+
+#define EnableInterrupts()
+#define DisableInterrupts()
+
+#include "cdefs.h"
+#include "timedefs.h"
+#include "timemc.h"
+
+int main(int argc, char **argv)
+{
+    TimerMcScenario sc = TIMER_MC_SCENARIO;
+    TimerMcResult r;
+    uint32_t i, last = 0u;
+    int k;
+
+    for (k = 1; k < argc; k++) {
+        if (TimerMcParse(&sc,argv[k]) == false) {
+            fprintf(stderr,"bad scenario: %s\n",argv[k]);
+            return 1;
+        }
+    }
+    if (TimerMcRun(&sc,&r) == false) {
+        fprintf(stderr,"cannot run\n");
+        return 1;
+    }
+    printf("runs %llu, tripped %llu (%.2f%%), expirations %llu\n",(unsigned long long)r.Runs,
+            (unsigned long long)r.Tripped,r.Runs ? 100.0 * (double)r.Tripped / (double)r.Runs : 0.0,
+            (unsigned long long)r.Expirations);
+    if (r.Tripped != 0u) {
+        printf("first expiration: mean %.1f, sd %.1f, min %u, max %u ticks\n",r.Mean,TimerMcStdDev(&r),r.Min,r.Max);
+        for (i = 0u; i < TIMER_MC_BINS; i++) {
+            if (r.Histogram[i] != 0u) {
+                last = i;
+            }
+        }
+        for (i = 0u; i <= last; i++) {
+            printf("%10u%s %10llu\n",i * sc.BinTicks,(i == TIMER_MC_BINS - 1u) ? "+" : " ",
+                    (unsigned long long)r.Histogram[i]);
+        }
+    }
+    printf("%.3f s, %.1f M model ticks/s\n",r.Seconds,(double)r.ModelTicks / r.Seconds * 1e-6);
+    return 0;
+}
+
+// End of fbvmc.c
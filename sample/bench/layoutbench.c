@@ -0,0 +1,111 @@
+/* layoutbench.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// False sharing between the tick thread and an application thread with the
+// default and the split storage layout of timedefs.h. The tick thread ticks
+// the timers as fast as it can; the application thread re-arms the single pulse
+// timers, consumes the tick flags of the continuous timers and changes the
+// burst generators. Both rates are printed; run the two builds on a machine
+// with two free cores.
+//
+//  gcc -O2 -I../.. -o layout_packed layoutbench.c -lpthread
+//  gcc -O2 -DTIMER_LAYOUT_SPLIT -I../.. -o layout_split layoutbench.c -lpthread
+//  ./layout_packed [seconds]; ./layout_split [seconds]
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define EnableInterrupts()
+#define DisableInterrupts()
+
+#include "cdefs.h"
+#include "timedefs.h"
+
+#define TIMERS(X) X(0) X(1) X(2) X(3) X(4) X(5) X(6) X(7)
+
+#define DEFINE_SET(n) DEFINE_SINGLE_PULSE_TIMER(S##n,uint32_t) \
+    DEFINE_CONTINUOUS_TIMER(C##n,uint32_t) \
+    DEFINE_BURST_GENERATOR(G##n,uint32_t)
+TIMERS(DEFINE_SET)
+DEFINE_TIMER_LAYOUT
+
+static volatile int Running = 1;
+static uint64_t Ticks, Ops;
+
+static __attribute__((noinline)) void Tick(void)
+{
+#define TICK_SET(n) TickSinglePulseTimer(S##n); \
+    TickContinuousTimer(C##n); \
+    TickBurstGenerator(G##n);
+    TIMERS(TICK_SET)
+}
+
+static __attribute__((noinline)) void Application(uint32_t i)
+{
+#define APP_SET(n) SetSinglePulseTimer(S##n,1000u); \
+    if (ContinuousTimerTick(C##n) == true) { \
+        ClearContinuousTimerTick(C##n); \
+    } \
+    if ((i & 0xFFu) == 0u) { \
+        BurstGeneratorHighTime(G##n) = 2u + (i & 1u); \
+    }
+    TIMERS(APP_SET)
+}
+
+static void *TickThread(void *p)
+{
+    uint64_t n = 0u;
+
+    (void)p;
+    while (Running) {
+        Tick();
+        n++;
+    }
+    Ticks = n;
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    pthread_t th;
+    uint32_t seconds = (argc > 1) ? (uint32_t)strtoul(argv[1],NULL,0) : 3u;
+    uint32_t i = 0u;
+    time_t end;
+
+#define START_SET(n) SetSinglePulseTimerI(S##n,1000u); \
+    SetContinuousTimerI(C##n,3u + n); \
+    SetBurstGeneratorI(G##n,3u,2u,2u,10u);
+    TIMERS(START_SET)
+    pthread_create(&th,NULL,TickThread,NULL);
+    end = time(NULL) + (time_t)seconds;
+    while (time(NULL) < end) {
+        Application(i++);
+    }
+    Running = 0;
+    pthread_join(th,NULL);
+    Ops = i;
+#if defined(TIMER_LAYOUT_SPLIT)
+    printf("split:  ");
+#else
+    printf("packed: ");
+#endif
+    printf("%.1f M ticks/s (24 timers), %.1f M application passes/s\n",(double)Ticks / seconds * 1e-6,
+            (double)Ops / seconds * 1e-6);
+    return 0;
+}
+
+// End of layoutbench.c
@@ -0,0 +1,117 @@
+/* shardbench.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Scaling of timeshard.h with the number of workers. Every worker owns TIMERS
+// timers of 100us ticks; its poller re-arms random timers of its shard like
+// received packets do, and every expiration re-arms the timer from the handler,
+// on the worker that took it (through the command ring when it was stolen).
+// The result is arms plus expirations per second of all workers.
+//
+//  gcc -O2 -D_GNU_SOURCE -I../.. -o shardbench shardbench.c -lpthread
+//  ./shardbench [workers] [seconds]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "timeshard.h"
+
+#define TIMERS      (1000000u)      // per worker
+#define SLOTS       (65536u)
+#define TICK_NS     (100000u)
+#define PACKETS     (256u)          // re-arms per poll
+#define MAX_WORKERS (256u)
+
+static TimerShardEngine Engine;
+static TimerHandle *Handle[MAX_WORKERS];
+static __thread uint32_t Seed;
+static uint64_t Lost[MAX_WORKERS];
+
+static inline uint32_t Random(void)
+{
+    Seed ^= Seed << 13;
+    Seed ^= Seed >> 17;
+    Seed ^= Seed << 5;
+    return Seed;
+}
+
+// timeouts of 1..256 ticks
+static void Expired(TimerHandle h, void *arg)
+{
+    (void)arg;
+    if (TimerShardSet(&Engine,h,1u + (Random() & 0xFFu)) == false) {
+        __atomic_fetch_add(&Lost[TimerShardOf(h)],1u,__ATOMIC_RELAXED);
+    }
+}
+
+static bool Poll(uint32_t shard, void *arg)
+{
+    uint32_t i;
+
+    (void)arg;
+    if (Seed == 0u) {
+        Seed = 2463534242u + shard * 7919u;
+    }
+    for (i = 0u; i < PACKETS; i++) {
+        TimerShardSet(&Engine,Handle[shard][Random() % TIMERS],1u + (Random() & 0xFFu));
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t workers = 1u, seconds = 5u, k, i;
+    uint64_t arms = 0u, expirations = 0u, stolen = 0u, lost = 0u;
+
+    if (argc > 1) {
+        workers = (uint32_t)strtoul(argv[1],NULL,0);
+    }
+    if (argc > 2) {
+        seconds = (uint32_t)strtoul(argv[2],NULL,0);
+    }
+    if ((workers == 0u) || (workers > MAX_WORKERS)) {
+        workers = 1u;
+    }
+    if (TimerShardInit(&Engine,workers,TIMERS,SLOTS,TICK_NS,Expired,Poll,NULL) == false) {
+        fprintf(stderr,"out of memory\n");
+        return 1;
+    }
+    Seed = 1u;
+    for (k = 0u; k < workers; k++) {
+        Handle[k] = (TimerHandle *)malloc(TIMERS * sizeof(TimerHandle));
+        for (i = 0u; i < TIMERS; i++) {
+            Handle[k][i] = TimerShardCreate(&Engine,k);
+            TimerShardSet(&Engine,Handle[k][i],1u + (Random() & 0xFFu));
+        }
+    }
+    Seed = 0u;
+    TimerShardRun(&Engine);
+    sleep(seconds);
+    TimerShardShutdown(&Engine);
+
+    for (k = 0u; k < workers; k++) {
+        arms += Engine.Shard[k].Arms;
+        expirations += Engine.Shard[k].Expirations;
+        stolen += Engine.Shard[k].Stolen;
+        lost += Lost[k];
+    }
+    printf("workers %u: %.1f M arms/s, %.1f M expirations/s, %.1f M total/s, %.1f%% stolen, %llu lost\n",
+            workers,(double)arms / seconds * 1e-6,(double)expirations / seconds * 1e-6,
+            (double)(arms + expirations) / seconds * 1e-6,
+            expirations ? 100.0 * (double)stolen / (double)expirations : 0.0,(unsigned long long)lost);
+    TimerShardFree(&Engine);
+    return 0;
+}
+
+// End of shardbench.c
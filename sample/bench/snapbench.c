@@ -0,0 +1,224 @@
+/* snapbench.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Check and speed of timesnap.h. Timers of every kind with random settings
+// (one phase of the asymmetric timers may be 0) run a random number of ticks,
+// set A is saved into an image and restored into set B with an elapsed time,
+// while A is ticked as many times; then every field of A and B must be equal.
+// The second part measures the restore of all timers for downtimes of 1e3 to
+// 1e9 ticks, which must not grow with the downtime. The exit status is 1 when
+// a field differs or an image does not check.
+//
+//  gcc -O2 -I../.. -o snapbench snapbench.c
+//  ./snapbench [rounds]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define EnableInterrupts()
+#define DisableInterrupts()
+
+#include "cdefs.h"
+#include "timedefs.h"
+#include "timesnap.h"
+
+#define LAYOUT      (1u)
+#define MAX_TICKS   (3000u)         // ticks before the snapshot and elapsed time
+#define CCT_PER     (37u)
+#define CFCT_PER    (53u)
+
+#define DEFINE_SET(s) DEFINE_SINGLE_PULSE_TIMER(S##s,uint16_t) \
+    DEFINE_CONTINUOUS_TIMER(C##s,uint16_t) \
+    DEFINE_CONST_CONTINUOUS_TIMER(K##s,uint16_t) \
+    DEFINE_CONST_FREE_CONTINUOUS_TIMER(F##s,uint16_t) \
+    DEFINE_FBSINGLE_PULSE_TIMER(B##s,uint16_t) \
+    DEFINE_FBVSINGLE_PULSE_TIMER(V##s,uint16_t) \
+    DEFINE_ASYMMETRIC_CONTINUOUS_TIMER(T##s,uint16_t) \
+    DEFINE_ASYMMETRIC_SINGLE_PULSE_TIMER(P##s,uint16_t) \
+    DEFINE_BURST_GENERATOR(G##s,uint16_t)
+DEFINE_SET(A)
+DEFINE_SET(B)
+
+static uint8_t Image[TSNAP_HEADER_SIZE + TSNAP_TRAILER_SIZE +
+    TSNAP_SINGLE_PULSE_TIMER_SIZE(uint16_t) + TSNAP_CONTINUOUS_TIMER_SIZE(uint16_t) +
+    TSNAP_CONST_CONTINUOUS_TIMER_SIZE(uint16_t) + TSNAP_CONST_FREE_CONTINUOUS_TIMER_SIZE(uint16_t) +
+    TSNAP_FBSINGLE_PULSE_TIMER_SIZE(uint16_t) + TSNAP_FBVSINGLE_PULSE_TIMER_SIZE(uint16_t) +
+    TSNAP_ASYMMETRIC_CONTINUOUS_TIMER_SIZE(uint16_t) + TSNAP_ASYMMETRIC_SINGLE_PULSE_TIMER_SIZE(uint16_t) +
+    TSNAP_BURST_GENERATOR_SIZE(uint16_t)];
+static uint32_t Seed = 2463534242u;
+static uint32_t Errors;
+
+static inline uint32_t Random(void)
+{
+    Seed ^= Seed << 13;
+    Seed ^= Seed >> 17;
+    Seed ^= Seed << 5;
+    return Seed;
+}
+
+static double Seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// 1..n
+#define R(n) (1u + Random() % (n))
+
+static void SetA(void)
+{
+    uint16_t h = (uint16_t)R(40u), l = (uint16_t)R(40u);
+
+    SetSinglePulseTimer(SA,R(500u));
+    SetContinuousTimer(CA,R(100u));
+    SetConstContinuousTimer(KA,CCT_PER);
+    SetConstFreeContinuousTimer(FA,CFCT_PER);
+    SetFBSinglePulseTimer(BA,R(300u),(Random() & 1u) ? FBS_FORWARD : FBS_BACKWARD);
+    SetFBVSinglePulseTimer(VA,R(1000u),R(5u),R(5u),(Random() & 1u) ? FBS_FORWARD : FBS_BACKWARD);
+    // one phase is 0 every third time; the high one after the start (at the
+    // Set it is the first count)
+    SetAsymmetricContinuousTimer(TA,h,((Random() % 3u) == 0u) ? 0u : l);
+    if ((Random() % 3u) == 0u) {
+        ChangeAsymmetricContinuousTimerSetting(TA,0u,l);
+    }
+    SetAsymmetricSinglePulseTimer(PA,(Random() & 3u) ? R(200u) : 0u,R(200u),(Random() & 1u) ? true : false);
+    SetBurstGenerator(GA,R(5u),R(10u),R(10u),R(50u));
+}
+
+static void TickA(uint32_t n)
+{
+    while (n-- != 0u) {
+        TickSinglePulseTimer(SA);
+        TickContinuousTimer(CA);
+        TickConstContinuousTimer(KA,CCT_PER);
+        TickConstFreeContinuousTimer(FA,CFCT_PER);
+        TickFBSinglePulseTimer(BA);
+        TickFBVSinglePulseTimer(VA);
+        TickAsymmetricContinuousTimer(TA);
+        TickAsymmetricSinglePulseTimer(PA);
+        TickBurstGenerator(GA);
+    }
+}
+
+static uint32_t Save(void)
+{
+    uint8_t *p;
+
+    TimerSnapshotBegin(Image,p,LAYOUT);
+    SnapshotSinglePulseTimer(SA,p);
+    SnapshotContinuousTimer(CA,p);
+    SnapshotConstContinuousTimer(KA,p);
+    SnapshotConstFreeContinuousTimer(FA,p);
+    SnapshotFBSinglePulseTimer(BA,p);
+    SnapshotFBVSinglePulseTimer(VA,p);
+    SnapshotAsymmetricContinuousTimer(TA,p);
+    SnapshotAsymmetricSinglePulseTimer(PA,p);
+    SnapshotBurstGenerator(GA,p);
+    TimerSnapshotEnd(Image,p);
+    return (uint32_t)(p - Image);
+}
+
+static bool RestoreB(uint32_t len, uint32_t elapsed)
+{
+    const uint8_t *p;
+    bool ok;
+
+    TimerSnapshotCheck(Image,len,LAYOUT,ok);
+    if (ok == false) {
+        return false;
+    }
+    TimerRestoreBegin(Image,p);
+    RestoreSinglePulseTimer(SB,p,elapsed);
+    RestoreContinuousTimer(CB,p,elapsed);
+    RestoreConstContinuousTimer(KB,p,CCT_PER,elapsed);
+    RestoreConstFreeContinuousTimer(FB,p,CFCT_PER,elapsed);
+    RestoreFBSinglePulseTimer(BB,p,elapsed);
+    RestoreFBVSinglePulseTimer(VB,p,elapsed);
+    RestoreAsymmetricContinuousTimer(TB,p,elapsed);
+    RestoreAsymmetricSinglePulseTimer(PB,p,elapsed);
+    RestoreBurstGenerator(GB,p,elapsed);
+    return true;
+}
+
+#define EQ(v) { \
+    if (v##A != v##B) { \
+        if (Errors++ < 10u) { \
+            printf("round %u, elapsed %u: %s %lu, restored %lu\n",round,elapsed,#v,(unsigned long)v##A,(unsigned long)v##B); \
+        } \
+    } \
+}
+
+static void Compare(uint32_t round, uint32_t elapsed)
+{
+    EQ(ST_Flag_S) EQ(ST_Expired_S) EQ(ST_Counter_S)
+    EQ(CT_Flag_C) EQ(CT_Tick_C) EQ(CT_Counter_C) EQ(CT_Setting_C)
+    EQ(CCT_Flag_K) EQ(CCT_Tick_K) EQ(CCT_Counter_K)
+    EQ(CFCT_Tick_F) EQ(CFCT_Counter_F)
+    EQ(FBS_Flag_B) EQ(FBS_Expired_B) EQ(FBS_Direction_B) EQ(FBS_Counter_B) EQ(FBS_Setting_B)
+    EQ(FBVS_Flag_V) EQ(FBVS_Expired_V) EQ(FBVS_Direction_V) EQ(FBVS_Counter_V) EQ(FBVS_Setting_V)
+    EQ(FBVS_StepF_V) EQ(FBVS_StepB_V)
+    EQ(ACT_Flag_T) EQ(ACT_Tick_T) EQ(ACT_State_T) EQ(ACT_Counter_T) EQ(ACT_SettingHigh_T) EQ(ACT_SettingLow_T)
+    EQ(ASP_Flag_P) EQ(ASP_Expired_P) EQ(ASP_State_P) EQ(ASP_sp_P) EQ(ASP_SemiPeriod_Expired_P) EQ(ASP_Counter_P)
+    EQ(BG_Flag_G) EQ(BG_Tick_G) EQ(BG_state_G) EQ(BG_pc_G) EQ(BG_Counter_G)
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t rounds = (argc > 1) ? (uint32_t)strtoul(argv[1],NULL,0) : 20000u;
+    uint32_t round, elapsed, len = 0u, k, i;
+    double t;
+
+    // equivalence with the tick
+    for (round = 0u; round < rounds; round++) {
+        SetA();
+        TickA(Random() % MAX_TICKS);
+        len = Save();
+        elapsed = (Random() & 7u) ? Random() % MAX_TICKS : 0u;
+        if (RestoreB(len,elapsed) == false) {
+            printf("round %u: image of %u bytes does not check\n",round,len);
+            return 1;
+        }
+        TickA(elapsed);
+        Compare(round,elapsed);
+    }
+    printf("%u rounds of 9 timers, image %u bytes: %u differences\n",rounds,len,Errors);
+    if ((RestoreB(len - 1u,0u) == true) || ((Image[5] ^= 0x10u), (RestoreB(len,0u) == true))) {
+        printf("a damaged image checks\n");
+        Errors++;
+    }
+    Image[5] ^= 0x10u;
+
+    // restore time against the downtime, with the low phase of the asymmetric
+    // timer 0
+    SetA();
+    SetAsymmetricContinuousTimer(TA,3u,0u);
+    len = Save();
+    for (k = 1000u; k <= 1000000000u; k *= 10u) {
+        t = Seconds();
+        for (i = 0u; i < 10000u; i++) {
+            (void)RestoreB(len,k + (Random() & 0xFFFu));
+        }
+        printf("downtime %10u ticks: restore %.0f ns\n",k,(Seconds() - t) / 10000.0 * 1e9);
+        if (k == 1000000000u) {
+            break;
+        }
+    }
+    return (Errors == 0u) ? 0 : 1;
+}
+
+// End of snapbench.c
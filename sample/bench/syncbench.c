@@ -0,0 +1,173 @@
+/* syncbench.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Two nodes of timesync.h: a reference and a follower whose clock runs ppm
+// faster, in two processes connected by a pipe or by UDP on the loopback. After
+// a third of the run the follower is pushed 1/10 tick off its timeline (slewed
+// back), after two thirds 1/2 tick (stepped back). The follower prints when it
+// locks, the convergence in ticks, the phase error measured by the servo at the
+// beacons and the true one against the ticks of the reference, which both
+// processes see in the same CLOCK_MONOTONIC.
+//
+//  gcc -O2 -I../.. -o syncbench syncbench.c
+//  ./syncbench [pipe|udp] [seconds] [ppm]
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "timesync.h"
+
+#define TICK_NS     (5000000LL)
+#define INTERVAL    (10u)           // ticks between the beacons
+#define PORT_REF    (47001u)
+#define PORT_FOL    (47002u)
+
+// tick timeline of the reference
+typedef struct {
+    int64_t Last;
+    uint32_t Ticks;
+} Shared;
+
+static Shared *Ref;
+
+static void Reference(TimerSyncTransport *t, uint32_t ticks)
+{
+    TimerSync s;
+
+    TimerSyncOpen(&s,t,0u,0u,TICK_NS,INTERVAL);
+    while (TimerSyncTicks(&s) < ticks) {
+        (void)TimerSyncWait(&s);
+        __atomic_store_n(&Ref->Last,s.Last,__ATOMIC_RELAXED);
+        __atomic_store_n(&Ref->Ticks,s.Ticks,__ATOMIC_RELEASE);
+    }
+}
+
+static void Follower(TimerSyncTransport *t, uint32_t ticks, double ppm)
+{
+    TimerSync s;
+    uint32_t n, k = 0u, locked = 0u, pushed = 0u, count = 0u, servo = 0u;
+    double e, sum = 0.0, max = 0.0;
+    int64_t push;
+    uint32_t rt;
+    int64_t rl;
+
+    // a faster clock: a tick of it is longer in the time of the reference
+    TimerSyncOpen(&s,t,1u,0u,(uint64_t)((double)TICK_NS * (1.0 + ppm * 1e-6)),INTERVAL);
+    while (k < ticks) {
+        n = TimerSyncWait(&s);
+        k += n;
+        if ((k == ticks / 3u) || (k == 2u * ticks / 3u)) {
+            push = (k == ticks / 3u) ? TICK_NS / 10 : TICK_NS / 2;
+            s.Last += push;
+            s.Next += push;
+            pushed = 1u;
+            printf("tick %6u: pushed %.2f tick\n",s.Ticks,(double)push / TICK_NS);
+        }
+        if (TimerSyncLocked(&s) != (locked != 0u)) {
+            locked = TimerSyncLocked(&s) ? 1u : 0u;
+            if (locked != 0u) {
+                pushed = 0u;
+                printf("tick %6u: locked, convergence %u ticks, steps %u\n",s.Ticks,s.Convergence,s.Steps);
+            } else {
+                printf("tick %6u: lock lost, phase error %.1f us\n",s.Ticks,
+                        (double)s.PhaseError * TICK_NS / 65536.0 * 1e-3);
+            }
+        }
+        // the servo sees a push at the next beacon
+        if ((locked == 0u) || (pushed != 0u)) {
+            continue;
+        }
+        // start of the same tick on the reference
+        rt = __atomic_load_n(&Ref->Ticks,__ATOMIC_ACQUIRE);
+        rl = __atomic_load_n(&Ref->Last,__ATOMIC_RELAXED);
+        e = (double)((rl + (int64_t)(int32_t)(s.Ticks - rt) * TICK_NS) - s.Last) * 1e-3;
+        e = (e < 0.0) ? -e : e;
+        sum += e;
+        max = (e > max) ? e : max;
+        count++;
+        servo = (s.MaxError > servo) ? s.MaxError : servo;
+    }
+    printf("beacons %u, steps %u, locked %s\n",s.Beacons,s.Steps,TimerSyncLocked(&s) ? "yes" : "no");
+    printf("servo phase error: last %.1f us, max %.1f us while locked\n",
+            (double)s.PhaseError * TICK_NS / 65536.0 * 1e-3,(double)servo * TICK_NS / 65536.0 * 1e-3);
+    printf("true phase error: mean %.1f us, max %.1f us over %u locked ticks (tick %.1f ms)\n",
+            (count != 0u) ? sum / count : 0.0,max,count,TICK_NS * 1e-6);
+    printf("rate correction %.1f ppm\n",(double)s.Freq / 1024.0 / TICK_NS * 1e6);
+}
+
+int main(int argc, char **argv)
+{
+    const char *mode = (argc > 1) ? argv[1] : "pipe";
+    uint32_t seconds = (argc > 2) ? (uint32_t)strtoul(argv[2],NULL,0) : 10u;
+    double ppm = (argc > 3) ? strtod(argv[3],NULL) : 200.0;
+    uint32_t ticks = (uint32_t)(seconds * 1000000000LL / TICK_NS);
+    TimerSyncTransport t;
+    TimerSyncPipe p;
+    TimerSyncUdp u;
+    int fd[2], status;
+    pid_t pid;
+
+    Ref = (Shared *)mmap(NULL,sizeof(Shared),PROT_READ | PROT_WRITE,MAP_SHARED | MAP_ANONYMOUS,-1,0);
+    if (Ref == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    memset(Ref,0,sizeof(*Ref));
+    if ((strcmp(mode,"pipe") == 0) && (pipe(fd) != 0)) {
+        perror("pipe");
+        return 1;
+    }
+    if ((strcmp(mode,"pipe") != 0) && (strcmp(mode,"udp") != 0)) {
+        fprintf(stderr,"usage: syncbench [pipe|udp] [seconds] [ppm]\n");
+        return 1;
+    }
+    printf("%s, %u s, follower %+.0f ppm\n",mode,seconds,ppm);
+    fflush(stdout);
+
+    pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return 1;
+    }
+    if (pid == 0) {
+        if (strcmp(mode,"pipe") == 0) {
+            close(fd[1]);
+            TimerSyncPipeOpen(&p,&t,fd[0],-1);
+        } else if (TimerSyncUdpOpen(&u,&t,PORT_FOL) != 0) {
+            perror("follower socket");
+            return 1;
+        }
+        Follower(&t,ticks,ppm);
+        return 0;
+    }
+    if (strcmp(mode,"pipe") == 0) {
+        close(fd[0]);
+        TimerSyncPipeOpen(&p,&t,-1,fd[1]);
+    } else if ((TimerSyncUdpOpen(&u,&t,PORT_REF) != 0) || (TimerSyncUdpPeer(&u,PORT_FOL) != 0)) {
+        perror("reference socket");
+        return 1;
+    }
+    // the follower may end first
+    signal(SIGPIPE,SIG_IGN);
+    // the follower starts later and counts from its first step
+    Reference(&t,ticks + 100u * INTERVAL);
+    (void)waitpid(pid,&status,0);
+    return (WIFEXITED(status) && (WEXITSTATUS(status) == 0)) ? 0 : 1;
+}
+
+// End of syncbench.c
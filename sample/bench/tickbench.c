@@ -0,0 +1,184 @@
+/* tickbench.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Cycles per tick of 64 burst generators and 64 asymmetric single pulse timers
+// at random phases, with the branching and the branchless tick macros (x86).
+// Before, the branchless macros are checked against the branching ones from
+// random states; the exit status is 1 when a field differs.
+//
+//  gcc -O2 -I../.. -o tickbench tickbench.c
+//  ./tickbench
+
+#include <stdio.h>
+#include <x86intrin.h>
+
+#define EnableInterrupts()
+#define DisableInterrupts()
+
+#include "cdefs.h"
+#include "timedefs.h"
+
+#define ROUNDS      (20000u)
+#define CHECKS      (200000u)       // random states of the equivalence check
+#define CHECK_TICKS (64u)           // ticks from each of them
+
+#define X8(X,p) X(p##0) X(p##1) X(p##2) X(p##3) X(p##4) X(p##5) X(p##6) X(p##7)
+#define X64(X) X8(X,0) X8(X,1) X8(X,2) X8(X,3) X8(X,4) X8(X,5) X8(X,6) X8(X,7)
+
+#define DEFINE_SET(n) DEFINE_BURST_GENERATOR(G##n,uint16_t) \
+    DEFINE_ASYMMETRIC_SINGLE_PULSE_TIMER(P##n,uint16_t)
+X64(DEFINE_SET)
+
+// branching (A) and branchless (B) copies for the check
+DEFINE_BURST_GENERATOR(GA,uint16_t)
+DEFINE_BURST_GENERATOR(GB,uint16_t)
+DEFINE_BURST_GENERATOR(OA,uint16_t)
+DEFINE_BURST_GENERATOR(OB,uint16_t)
+DEFINE_ASYMMETRIC_SINGLE_PULSE_TIMER(PA,uint16_t)
+DEFINE_ASYMMETRIC_SINGLE_PULSE_TIMER(PB,uint16_t)
+static U1 OutA, OutB;
+
+static uint32_t Seed = 2463534242u;
+
+static uint32_t Random(void)
+{
+    Seed ^= Seed << 13;
+    Seed ^= Seed >> 17;
+    Seed ^= Seed << 5;
+    return Seed;
+}
+
+static void Start(void)
+{
+#define START_SET(n) SetBurstGeneratorI(G##n,1u + Random() % 5u,1u + Random() % 4u,1u + Random() % 4u,1u + Random() % 9u); \
+    BG_Counter_G##n = 1u + Random() % 8u; \
+    SetAsymmetricSinglePulseTimerI(P##n,1u + Random() % 7u,Random() % 7u,lowstate);
+    X64(START_SET)
+}
+
+// one tick of all of them; the single pulse timers are restarted when they expire
+static __attribute__((noinline)) void TickBranching(void)
+{
+#define TICK_SET(n) TickBurstGenerator(G##n); \
+    TickAsymmetricSinglePulseTimer(P##n); \
+    if (ASP_Flag_P##n == false) { \
+        SetAsymmetricSinglePulseTimerI(P##n,ASP_SettingFirst_P##n,ASP_SettingSecond_P##n,lowstate); \
+    }
+    X64(TICK_SET)
+}
+
+static __attribute__((noinline)) void TickBranchless(void)
+{
+#define TICK_BL_SET(n) TickBurstGeneratorBranchless(G##n); \
+    TickAsymmetricSinglePulseTimerBranchless(P##n); \
+    if (ASP_Flag_P##n == false) { \
+        SetAsymmetricSinglePulseTimerI(P##n,ASP_SettingFirst_P##n,ASP_SettingSecond_P##n,lowstate); \
+    }
+    X64(TICK_BL_SET)
+}
+
+// any state, also ones Set does not give (0 settings, pc above pulses)
+#define RANDOM_BG(a,b) { \
+    BG_Flag_##a = (B1)(Random() & 1u); \
+    BG_Tick_##a = (B1)(Random() & 1u); \
+    BG_state_##a = (B1)(Random() & 1u); \
+    BG_pulses_##a = (uint8_t)(Random() % 6u); \
+    BG_pc_##a = (uint8_t)(Random() % 7u); \
+    BG_Counter_##a = (uint16_t)(Random() % 10u); \
+    BG_ht_##a = (uint16_t)(Random() % 10u); \
+    BG_lt_##a = (uint16_t)(Random() % 10u); \
+    BG_it_##a = (uint16_t)(Random() % 10u); \
+    BG_Flag_##b = BG_Flag_##a; BG_Tick_##b = BG_Tick_##a; BG_state_##b = BG_state_##a; \
+    BG_pulses_##b = BG_pulses_##a; BG_pc_##b = BG_pc_##a; BG_Counter_##b = BG_Counter_##a; \
+    BG_ht_##b = BG_ht_##a; BG_lt_##b = BG_lt_##a; BG_it_##b = BG_it_##a; \
+}
+#define SAME_BG(a,b) ((BG_Flag_##a == BG_Flag_##b) && (BG_Tick_##a == BG_Tick_##b) && \
+    (BG_state_##a == BG_state_##b) && (BG_pc_##a == BG_pc_##b) && (BG_Counter_##a == BG_Counter_##b))
+
+// the branchless macros against the branching ones; returns the differences
+static uint32_t Check(void)
+{
+    uint32_t i, k, errors = 0u;
+
+    for (i = 0u; i < CHECKS; i++) {
+        RANDOM_BG(GA,GB)
+        RANDOM_BG(OA,OB)
+        OutA = (U1)(Random() & 1u);
+        OutB = OutA;
+        ASP_Flag_PA = (B1)(Random() & 1u);
+        ASP_sp_PA = (B1)(Random() & 1u);
+        ASP_State_PA = (U1)(Random() & 1u);
+        ASP_SemiPeriod_Expired_PA = (B1)(Random() & 1u);
+        ASP_Expired_PA = (B1)(Random() & 1u);
+        ASP_Counter_PA = (uint16_t)(Random() % 10u);
+        ASP_SettingFirst_PA = (uint16_t)(Random() % 10u);
+        ASP_SettingSecond_PA = (uint16_t)(Random() % 10u);
+        ASP_Flag_PB = ASP_Flag_PA; ASP_sp_PB = ASP_sp_PA; ASP_State_PB = ASP_State_PA;
+        ASP_SemiPeriod_Expired_PB = ASP_SemiPeriod_Expired_PA; ASP_Expired_PB = ASP_Expired_PA;
+        ASP_Counter_PB = ASP_Counter_PA; ASP_SettingFirst_PB = ASP_SettingFirst_PA;
+        ASP_SettingSecond_PB = ASP_SettingSecond_PA;
+        for (k = 0u; k < CHECK_TICKS; k++) {
+            TickBurstGenerator(GA);
+            TickBurstGeneratorBranchless(GB);
+            TickBurstGeneratorWithOutput(OA,OutA);
+            TickBurstGeneratorBranchlessWithOutput(OB,OutB);
+            TickAsymmetricSinglePulseTimer(PA);
+            TickAsymmetricSinglePulseTimerBranchless(PB);
+            if (!SAME_BG(GA,GB) || !SAME_BG(OA,OB) || (OutA != OutB) ||
+                    (ASP_Flag_PA != ASP_Flag_PB) || (ASP_sp_PA != ASP_sp_PB) ||
+                    (ASP_State_PA != ASP_State_PB) || (ASP_Counter_PA != ASP_Counter_PB) ||
+                    (ASP_SemiPeriod_Expired_PA != ASP_SemiPeriod_Expired_PB) ||
+                    (ASP_Expired_PA != ASP_Expired_PB)) {
+                if (errors++ < 10u) {
+                    printf("state %u, tick %u: branchless differs\n",i,k);
+                }
+                break;
+            }
+        }
+    }
+    return errors;
+}
+
+static void Measure(const char *name, void (*tick)(void))
+{
+    uint64_t t, d, min = ~0uLL, sum = 0u;
+    uint32_t i;
+
+    Seed = 2463534242u;
+    Start();
+    for (i = 0u; i < ROUNDS; i++) {
+        t = __rdtsc();
+        tick();
+        d = __rdtsc() - t;
+        sum += d;
+        min = (d < min) ? d : min;
+    }
+    printf("%-11s %6.1f cycles per generator + timer (min %.1f)\n",name,
+            (double)sum / ROUNDS / 64.0,(double)min / 64.0);
+}
+
+int main(void)
+{
+    uint32_t errors = Check();
+
+    printf("equivalence: %u random states of %u ticks, %u differ\n",CHECKS,CHECK_TICKS,errors);
+    Measure("branching",TickBranching);
+    Measure("branchless",TickBranchless);
+    Measure("branching",TickBranching);
+    Measure("branchless",TickBranchless);
+    return (errors == 0u) ? 0 : 1;
+}
+
+// End of tickbench.c
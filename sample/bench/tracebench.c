@@ -0,0 +1,1025 @@
+/* tracebench.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Golden traces of timetrace.h: records the commands of a workload with the
+// events the macros of timedefs.h give for them, replays a trace at full speed
+// against an engine, checks that the engine gives the same events on the same
+// ticks and compares its speed with a stored baseline.
+//
+//  gcc -O2 -I../.. -o tracebench tracebench.c
+//  ./tracebench record demo|random|simple out.trc [ticks] [timers]
+//  ./tracebench import cmds.txt|app.trc out.trc [ticks]
+//  ./tracebench replay in.trc [macros|advance|branchless|pool|wheel] [-s base.txt] [-b base.txt]
+//
+// Workloads:
+//  demo    - sample/demo.X on timers instances with shifted phases: T1 of 0.5s
+//            starts a burst of G1, the end of the burst stops G1 and starts T1
+//  random  - random Set, Stop, direction and setting changes of all kinds
+//  simple  - the same with single pulse and continuous timers only
+// Engines:
+//  macros  - Tick* of every timer on every tick (the reference)
+//  advance - Advance* by the ticks to the next event (RTC_ADAPTIVE)
+//  branchless - the same with the Tick*Branchless macros of the asymmetric
+//            single pulse timers and burst generators
+//  pool    - timepool.h (single pulse and continuous timers)
+//  wheel   - timewheel.h (single pulse timers)
+// import takes the commands of a host build of an application (Trace* macros)
+// or a text log, one command per line, '#' starts a comment; blank lines are
+// skipped, any other line that is not a command is an error:
+//  tick set sp|ct id per
+//  tick set fbv id per stepF stepB 1|0     (1 forward)
+//  tick set act id high low
+//  tick set bg|bb id pulses ht lt it      (bb: TIMER_TRACE_BANK_CHANNELS)
+//  tick set asp id first second 1|0       (1 high first)
+//  tick stop sp|ct|fbv|act|bg|asp|bb id
+//  tick dir fbv id 1|0
+//  tick setting fbv id per
+//  tick setting act id high low
+// replay skips the commands and events of the kinds the engine does not run
+// (the burst generators of demo on pool and wheel); -s saves the speed of the
+// engine as a baseline, -b prints the difference from one. The exit status is 1
+// when the events differ (or at an error), 2 when the throughput fell more than
+// REGRESSION percent below the baseline and 3 when the trace has no command of
+// a kind the engine runs.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define EnableInterrupts()
+#define DisableInterrupts()
+
+#include "cdefs.h"
+#include "timedefs.h"
+#include "timepool.h"
+#include "timetrace.h"
+#include "timewheel.h"
+
+#define TIMERS      (1024u)     // per kind at most
+#define TICKS       (100000u)
+#define TAIL        (1000u)     // ticks after the last imported command
+#define MIN_TIME    (0.5)       // s of the throughput runs at least
+#define REGRESSION  (10.0)      // %
+#define BANK_EDGES  (2u * 31u * TIMER_TRACE_BANK_CHANNELS)  // up to 31 pulses
+#define WHEEL_SLOTS (256u)
+#define ALL_KINDS   ((1u << TIMER_TRACE_KINDS) - 1u)
+
+// demo.X with MU_001S = 1 tick
+#define DEMO_T1     (50u)
+#define DEMO_PULSES (5u)
+#define DEMO_HT     (3u)
+#define DEMO_LT     (2u)
+#define DEMO_IT     (5u)
+#define DEMO_TIMERS (16u)
+#define RANDOM_TIMERS (64u)
+
+typedef struct {
+    uint32_t Tick;
+    uint16_t Kind;
+    uint16_t Id;
+} Event;
+
+typedef struct {
+    const char *Name;
+    uint32_t Kinds;                             // mask of the kinds it runs
+    void (*Reset)(void);
+    void (*Command)(const TimerTraceRecord *r);
+    uint32_t (*Step)(uint32_t n);               // up to n ticks, returns the ticks done
+    void (*Collect)(void);                      // set events to Emit(), cleared
+} Engine;
+
+static const char *KindName[TIMER_TRACE_KINDS] = { "sp", "ct", "fbv", "act", "bg", "asp", "bb" };
+static const char *OpName[TIMER_TRACE_EVENT + 1u] = { "", "set", "stop", "dir", "setting", "event" };
+static const uint8_t SetArgs[TIMER_TRACE_KINDS] = { 1u, 1u, 4u, 2u, 4u, 3u, 4u };
+
+static uint32_t Timers;     // per kind in the trace
+static uint32_t Now;
+static Event *Out;          // events given by the engine
+static uint32_t NOut;
+static uint32_t MaxOut;
+static uint32_t Seed = 2463534242u;
+
+static inline uint32_t Random(void)
+{
+    Seed ^= Seed << 13;
+    Seed ^= Seed >> 17;
+    Seed ^= Seed << 5;
+    return Seed;
+}
+
+static double Seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void Emit(uint16_t kind, uint32_t id)
+{
+    if (NOut == MaxOut) {
+        MaxOut = (MaxOut != 0u) ? 2u * MaxOut : 4096u;
+        Out = (Event *)realloc(Out,MaxOut * sizeof(*Out));
+        if (Out == NULL) {
+            fprintf(stderr,"out of memory\n");
+            exit(1);
+        }
+    }
+    Out[NOut].Tick = Now;
+    Out[NOut].Kind = kind;
+    Out[NOut].Id = (uint16_t)id;
+    NOut++;
+}
+
+// the macros of timedefs.h on arrays of timers
+DEFINE_SINGLE_PULSE_TIMER(Sp[TIMERS],uint32_t)
+DEFINE_CONTINUOUS_TIMER(Ct[TIMERS],uint32_t)
+DEFINE_FBVSINGLE_PULSE_TIMER(Fbv[TIMERS],uint32_t)
+DEFINE_ASYMMETRIC_CONTINUOUS_TIMER(Act[TIMERS],uint32_t)
+DEFINE_BURST_GENERATOR(Bg[TIMERS],uint32_t)
+DEFINE_ASYMMETRIC_SINGLE_PULSE_TIMER(Asp[TIMERS],uint32_t)
+DEFINE_BURST_BANK(Bb[TIMERS],uint32_t,uint8_t,BANK_EDGES)
+
+static void MacrosReset(void)
+{
+    uint32_t i;
+
+    for (i = 0u; i < TIMERS; i++) {
+        StopSinglePulseTimerI(Sp[i]);
+        StopContinuousTimerI(Ct[i]);
+        StopFBVSinglePulseTimerI(Fbv[i]);
+        StopAsymmetricContinuousTimerI(Act[i]);
+        ResetBurstGenerator(Bg[i]);
+        ResetAsymmetricSinglePulseTimer(Asp[i]);
+        ResetBurstBank(Bb[i]);
+    }
+}
+
+static void MacrosCommand(const TimerTraceRecord *r)
+{
+    uint32_t i = r->Id, phase[TIMER_TRACE_BANK_CHANNELS], p, c;
+
+    switch (r->Op) {
+    case TIMER_TRACE_SET:
+        switch (r->Kind) {
+        case TIMER_TRACE_SINGLE_PULSE:
+            SetSinglePulseTimerI(Sp[i],r->A);
+            break;
+        case TIMER_TRACE_CONTINUOUS:
+            SetContinuousTimerI(Ct[i],r->A);
+            break;
+        case TIMER_TRACE_FBV:
+            SetFBVSinglePulseTimerI(Fbv[i],r->A,r->B,r->C,(r->D != 0u) ? FBS_FORWARD : FBS_BACKWARD);
+            break;
+        case TIMER_TRACE_ASYMMETRIC:
+            SetAsymmetricContinuousTimerI(Act[i],r->A,r->B);
+            break;
+        case TIMER_TRACE_BURST:
+            SetBurstGeneratorI(Bg[i],(uint8_t)r->A,r->B,r->C,r->D);
+            break;
+        case TIMER_TRACE_ASYMMETRIC_SP:
+            SetAsymmetricSinglePulseTimerI(Asp[i],r->A,r->B,(r->C != 0u) ? ASPT_STATE_HIGH : ASPT_STATE_LOW);
+            break;
+        default:
+            p = r->A * (r->B + r->C) - r->C + r->D;
+            for (c = 0u; c < TIMER_TRACE_BANK_CHANNELS; c++) {
+                phase[c] = c * p / TIMER_TRACE_BANK_CHANNELS;
+            }
+            SetBurstBankI(Bb[i],r->A,r->B,r->C,r->D,phase,TIMER_TRACE_BANK_CHANNELS);
+            break;
+        }
+        break;
+    case TIMER_TRACE_STOP:
+        switch (r->Kind) {
+        case TIMER_TRACE_SINGLE_PULSE:
+            StopSinglePulseTimerI(Sp[i]);
+            break;
+        case TIMER_TRACE_CONTINUOUS:
+            StopContinuousTimerI(Ct[i]);
+            break;
+        case TIMER_TRACE_FBV:
+            StopFBVSinglePulseTimerI(Fbv[i]);
+            break;
+        case TIMER_TRACE_ASYMMETRIC:
+            StopAsymmetricContinuousTimerI(Act[i]);
+            break;
+        case TIMER_TRACE_BURST:
+            StopBurstGeneratorI(Bg[i]);
+            break;
+        case TIMER_TRACE_ASYMMETRIC_SP:
+            StopAsymmetricSinglePulseTimerI(Asp[i]);
+            break;
+        default:
+            StopBurstBankI(Bb[i]);
+            break;
+        }
+        break;
+    case TIMER_TRACE_DIRECTION:
+        SetFBVSinglePulseTimerDirection(Fbv[i],(r->A != 0u) ? FBS_FORWARD : FBS_BACKWARD);
+        break;
+    default:
+        if (r->Kind == TIMER_TRACE_FBV) {
+            ChangeFBVSinglePulseTimerSettingI(Fbv[i],r->A);
+        } else {
+            ChangeAsymmetricContinuousTimerSettingI(Act[i],r->A,r->B);
+        }
+        break;
+    }
+}
+
+static uint32_t MacrosStep(uint32_t n)
+{
+    uint32_t i;
+
+    (void)n;
+    for (i = 0u; i < Timers; i++) {
+        TickSinglePulseTimer(Sp[i]);
+        TickContinuousTimer(Ct[i]);
+        TickFBVSinglePulseTimer(Fbv[i]);
+        TickAsymmetricContinuousTimer(Act[i]);
+        TickBurstGenerator(Bg[i]);
+        TickAsymmetricSinglePulseTimer(Asp[i]);
+        TickBurstBank(Bb[i]);
+    }
+    return 1u;
+}
+
+// the timers that have a branchless tick use it
+static uint32_t BranchlessStep(uint32_t n)
+{
+    uint32_t i;
+
+    (void)n;
+    for (i = 0u; i < Timers; i++) {
+        TickSinglePulseTimer(Sp[i]);
+        TickContinuousTimer(Ct[i]);
+        TickFBVSinglePulseTimer(Fbv[i]);
+        TickAsymmetricContinuousTimer(Act[i]);
+        TickBurstGeneratorBranchless(Bg[i]);
+        TickAsymmetricSinglePulseTimerBranchless(Asp[i]);
+        TickBurstBank(Bb[i]);
+    }
+    return 1u;
+}
+
+static void MacrosCollect(void)
+{
+    uint32_t i;
+
+    for (i = 0u; i < Timers; i++) {
+        if (SinglePulseTimerExpired(Sp[i]) == true) {
+            ClearSinglePulseTimerExpired(Sp[i]);
+            Emit(TIMER_TRACE_SINGLE_PULSE,i);
+        }
+    }
+    for (i = 0u; i < Timers; i++) {
+        if (ContinuousTimerTick(Ct[i]) == true) {
+            ClearContinuousTimerTick(Ct[i]);
+            Emit(TIMER_TRACE_CONTINUOUS,i);
+        }
+    }
+    for (i = 0u; i < Timers; i++) {
+        if (FBVSinglePulseTimerExpired(Fbv[i]) == true) {
+            ClearFBVSinglePulseTimerExpired(Fbv[i]);
+            Emit(TIMER_TRACE_FBV,i);
+        }
+    }
+    for (i = 0u; i < Timers; i++) {
+        if (AsymmetricContinuousTimerTick(Act[i]) == true) {
+            ClearAsymmetricContinuousTimerTick(Act[i]);
+            Emit(TIMER_TRACE_ASYMMETRIC,i);
+        }
+    }
+    for (i = 0u; i < Timers; i++) {
+        if (BurstGeneratorTick(Bg[i]) == true) {
+            BurstGeneratorTick(Bg[i]) = false;
+            Emit(TIMER_TRACE_BURST,i);
+        }
+    }
+    for (i = 0u; i < Timers; i++) {
+        if (AsymmetricSinglePulseTimerSemiperiodExpired(Asp[i]) == true) {
+            AsymmetricSinglePulseTimerSemiperiodExpired(Asp[i]) = false;
+            Emit(TIMER_TRACE_ASYMMETRIC_SP,i);
+        }
+        if (AsymmetricSinglePulseTimerExpired(Asp[i]) == true) {
+            AsymmetricSinglePulseTimerExpired(Asp[i]) = false;
+            Emit(TIMER_TRACE_ASYMMETRIC_SP,i);
+        }
+    }
+    for (i = 0u; i < Timers; i++) {
+        if (BurstBankTick(Bb[i]) == true) {
+            ClearBurstBankTick(Bb[i]);
+            Emit(TIMER_TRACE_BANK,i);
+        }
+    }
+}
+
+// the same timers advanced from event to event
+static uint32_t AdvanceStep(uint32_t n)
+{
+    uint32_t d = n, i;
+
+    for (i = 0u; i < Timers; i++) {
+        NextEventSinglePulseTimer(Sp[i],d);
+        NextEventContinuousTimer(Ct[i],d);
+        NextEventFBVSinglePulseTimer(Fbv[i],d);
+        NextEventAsymmetricContinuousTimer(Act[i],d);
+        NextEventBurstGenerator(Bg[i],d);
+        NextEventAsymmetricSinglePulseTimer(Asp[i],d);
+        NextEventBurstBank(Bb[i],d);
+    }
+    if (d == 0u) {
+        d = 1u;
+    }
+    for (i = 0u; i < Timers; i++) {
+        AdvanceSinglePulseTimer(Sp[i],d);
+        AdvanceContinuousTimer(Ct[i],d);
+        AdvanceFBVSinglePulseTimer(Fbv[i],d);
+        AdvanceAsymmetricContinuousTimer(Act[i],d);
+        AdvanceBurstGenerator(Bg[i],d);
+        AdvanceAsymmetricSinglePulseTimer(Asp[i],d);
+        AdvanceBurstBank(Bb[i],d);
+    }
+    return d;
+}
+
+// timepool.h; the single pulse timers have the records 0 .. TIMERS - 1, the
+// continuous ones the next TIMERS
+DEFINE_TIMER_POOL(Pool,2u * TIMERS);
+static TimerHandle PoolHandle[2u * TIMERS];
+
+static void PoolReset(void)
+{
+    uint32_t i;
+
+    TimerPoolInit(&Pool);
+    for (i = 0u; i < 2u * TIMERS; i++) {
+        PoolHandle[i] = TimerPoolCreate(&Pool);
+    }
+}
+
+static void PoolCommand(const TimerTraceRecord *r)
+{
+    TimerHandle h = PoolHandle[(r->Kind == TIMER_TRACE_CONTINUOUS) ? TIMERS + r->Id : r->Id];
+
+    if (r->Op == TIMER_TRACE_STOP) {
+        TimerPoolStop(&Pool,h);
+    } else if (r->Kind == TIMER_TRACE_CONTINUOUS) {
+        TimerPoolSetContinuous(&Pool,h,r->A);
+    } else {
+        TimerPoolSetSinglePulse(&Pool,h,r->A);
+    }
+}
+
+static uint32_t PoolStep(uint32_t n)
+{
+    (void)n;
+    TimerPoolTick(&Pool);
+    return 1u;
+}
+
+static void PoolCollect(void)
+{
+    TimerHandle h;
+    uint32_t i;
+
+    while ((h = TimerPoolNextExpired(&Pool)) != TIMER_HANDLE_NULL) {
+        i = TimerPoolIndex_(h);
+        Emit((i < TIMERS) ? TIMER_TRACE_SINGLE_PULSE : TIMER_TRACE_CONTINUOUS,i % TIMERS);
+    }
+}
+
+// timewheel.h; the single pulse timers
+DEFINE_TIMER_WHEEL(Wheel,TIMERS,WHEEL_SLOTS)
+static TimerHandle WheelHandle[TIMERS];
+
+static void WheelReset(void)
+{
+    uint32_t i;
+
+    TimerWheelInit(&Wheel);
+    for (i = 0u; i < TIMERS; i++) {
+        WheelHandle[i] = TimerWheelCreate(&Wheel);
+    }
+}
+
+static void WheelCommand(const TimerTraceRecord *r)
+{
+    if (r->Op == TIMER_TRACE_STOP) {
+        TimerWheelStop(&Wheel,WheelHandle[r->Id]);
+    } else {
+        TimerWheelSet(&Wheel,WheelHandle[r->Id],r->A);
+    }
+}
+
+static uint32_t WheelStep(uint32_t n)
+{
+    (void)n;
+    TimerWheelTick(&Wheel);
+    return 1u;
+}
+
+static void WheelCollect(void)
+{
+    TimerHandle h;
+
+    while ((h = TimerWheelNextExpired(&Wheel)) != TIMER_HANDLE_NULL) {
+        Emit(TIMER_TRACE_SINGLE_PULSE,TimerPoolIndex_(h));
+    }
+}
+
+static const Engine Engines[] = {
+    { "macros", ALL_KINDS, MacrosReset, MacrosCommand, MacrosStep, MacrosCollect },
+    { "advance", ALL_KINDS, MacrosReset, MacrosCommand, AdvanceStep, MacrosCollect },
+    { "branchless", ALL_KINDS, MacrosReset, MacrosCommand, BranchlessStep, MacrosCollect },
+    { "pool", 0x03u, PoolReset, PoolCommand, PoolStep, PoolCollect },
+    { "wheel", 0x01u, WheelReset, WheelCommand, WheelStep, WheelCollect },
+};
+
+// true for a command the engines can take
+static bool Valid(const TimerTraceRecord *r)
+{
+    if ((r->Kind >= TIMER_TRACE_KINDS) || (r->Id >= TIMERS)) {
+        return false;
+    }
+    switch (r->Op) {
+    case TIMER_TRACE_SET:
+    case TIMER_TRACE_STOP:
+        return true;
+    case TIMER_TRACE_DIRECTION:
+        return r->Kind == TIMER_TRACE_FBV;
+    case TIMER_TRACE_SETTING:
+        return (r->Kind == TIMER_TRACE_FBV) || (r->Kind == TIMER_TRACE_ASYMMETRIC);
+    default:
+        return false;
+    }
+}
+
+// RECORDING
+// the reference engine runs the workload; the events of every tick are written
+// before its commands, the events of the commands after them
+typedef void (*Workload)(uint32_t n);  // commands after the n events in Out
+
+static TimerTraceWriter W;
+static uint32_t Kinds;      // of the random workload
+static uint32_t Edges[TIMERS];
+static TimerTraceRecord *Script;
+static uint32_t NScript;
+static uint32_t KScript;
+
+static void Issue(uint8_t op, uint8_t kind, uint32_t id, uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+    TimerTraceRecord r = { Now, op, kind, (uint16_t)id, a, b, c, d };
+
+    TimerTraceWrite(&W,&r);
+    MacrosCommand(&r);
+}
+
+static void WriteEvents(uint32_t from)
+{
+    for (; from < NOut; from++) {
+        TimerTraceEvent(&W,(uint8_t)Out[from].Kind,Out[from].Id);
+    }
+}
+
+static bool Record(const char *path, uint32_t ticks, uint32_t timers, Workload fn)
+{
+    uint32_t n;
+
+    if (TimerTraceCreate(&W,path,timers) == false) {
+        return false;
+    }
+    Timers = timers;
+    Now = 0u;
+    NOut = 0u;
+    MacrosReset();
+    do {
+        WriteEvents(0u);
+        n = NOut;
+        fn(n);
+        MacrosCollect();
+        WriteEvents(n);
+        if (Now == ticks) {
+            break;
+        }
+        NOut = 0u;
+        MacrosStep(1u);
+        Now++;
+        TimerTraceTick(&W,1u);
+        MacrosCollect();
+    } while (1);
+    return TimerTraceClose(&W);
+}
+
+static void DemoWork(uint32_t n)
+{
+    uint32_t i;
+
+    for (i = 0u; i < Timers; i++) {
+        if (Now == (i * 7u) % DEMO_T1) {
+            Issue(TIMER_TRACE_SET,TIMER_TRACE_SINGLE_PULSE,i,DEMO_T1,0u,0u,0u);
+        }
+    }
+    for (i = 0u; i < n; i++) {
+        if (Out[i].Kind == TIMER_TRACE_SINGLE_PULSE) {
+            Edges[Out[i].Id] = 0u;
+            Issue(TIMER_TRACE_SET,TIMER_TRACE_BURST,Out[i].Id,DEMO_PULSES,DEMO_HT,DEMO_LT,DEMO_IT);
+        } else if ((Out[i].Kind == TIMER_TRACE_BURST) && (++Edges[Out[i].Id] == 2u * DEMO_PULSES)) {
+            Issue(TIMER_TRACE_STOP,TIMER_TRACE_BURST,Out[i].Id,0u,0u,0u,0u);
+            Issue(TIMER_TRACE_SET,TIMER_TRACE_SINGLE_PULSE,Out[i].Id,DEMO_T1,0u,0u,0u);
+        }
+    }
+}
+
+static void RandomSet(uint8_t kind, uint32_t id)
+{
+    switch (kind) {
+    case TIMER_TRACE_SINGLE_PULSE:
+    case TIMER_TRACE_CONTINUOUS:
+        Issue(TIMER_TRACE_SET,kind,id,1u + Random() % 200u,0u,0u,0u);
+        break;
+    case TIMER_TRACE_FBV:
+        Issue(TIMER_TRACE_SET,kind,id,1u + Random() % 400u,Random() % 5u,Random() % 4u,Random() % 2u);
+        break;
+    case TIMER_TRACE_ASYMMETRIC:
+        Issue(TIMER_TRACE_SET,kind,id,1u + Random() % 100u,1u + Random() % 100u,0u,0u);
+        break;
+    case TIMER_TRACE_ASYMMETRIC_SP:
+        Issue(TIMER_TRACE_SET,kind,id,Random() % 100u,Random() % 100u,Random() % 2u,0u);
+        break;
+    default:
+        Issue(TIMER_TRACE_SET,kind,id,1u + Random() % 8u,1u + Random() % 20u,1u + Random() % 20u,1u + Random() % 20u);
+        break;
+    }
+}
+
+static void RandomWork(uint32_t n)
+{
+    uint32_t i, k, id;
+    uint8_t kind;
+
+    (void)n;
+    if (Now == 0u) {
+        for (kind = 0u; kind < TIMER_TRACE_KINDS; kind++) {
+            for (i = 0u; (i < Timers) && ((Kinds & (1u << kind)) != 0u); i++) {
+                RandomSet(kind,i);
+            }
+        }
+        return;
+    }
+    for (k = Random() % (Timers / 16u + 2u); k != 0u; k--) {
+        do {
+            kind = (uint8_t)(Random() % TIMER_TRACE_KINDS);
+        } while ((Kinds & (1u << kind)) == 0u);
+        id = Random() % Timers;
+        switch (Random() % 8u) {
+        case 5u:
+            Issue(TIMER_TRACE_STOP,kind,id,0u,0u,0u,0u);
+            break;
+        case 6u:
+            if (kind == TIMER_TRACE_FBV) {
+                Issue(TIMER_TRACE_DIRECTION,kind,id,Random() % 2u,0u,0u,0u);
+            } else {
+                RandomSet(kind,id);
+            }
+            break;
+        case 7u:
+            if (kind == TIMER_TRACE_FBV) {
+                Issue(TIMER_TRACE_SETTING,kind,id,1u + Random() % 400u,0u,0u,0u);
+            } else if (kind == TIMER_TRACE_ASYMMETRIC) {
+                Issue(TIMER_TRACE_SETTING,kind,id,1u + Random() % 100u,1u + Random() % 100u,0u,0u);
+            } else {
+                Issue(TIMER_TRACE_STOP,kind,id,0u,0u,0u,0u);
+            }
+            break;
+        default:
+            RandomSet(kind,id);
+            break;
+        }
+    }
+}
+
+static void ScriptWork(uint32_t n)
+{
+    const TimerTraceRecord *r;
+
+    (void)n;
+    while ((KScript < NScript) && (Script[KScript].Tick == Now)) {
+        r = &Script[KScript++];
+        Issue(r->Op,r->Kind,r->Id,r->A,r->B,r->C,r->D);
+    }
+}
+
+static int Find(const char *s, const char **names, uint32_t n)
+{
+    uint32_t i;
+
+    for (i = 0u; i < n; i++) {
+        if (strcmp(s,names[i]) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+// commands of a text log into Script; false at an error
+static bool ParseText(FILE *f)
+{
+    char line[256], op[16], kind[16], *p;
+    unsigned long t, id, a[4] = { 0u, 0u, 0u, 0u };
+    uint32_t ln = 0u, need;
+    int n, o, k;
+
+    while (fgets(line,sizeof(line),f) != NULL) {
+        ln++;
+        if ((p = strchr(line,'#')) != NULL) {
+            *p = '\0';
+        }
+        if (line[strspn(line," \t\r\n")] == '\0') {
+            continue;
+        }
+        n = sscanf(line,"%lu %15s %15s %lu %lu %lu %lu %lu",&t,op,kind,&id,&a[0],&a[1],&a[2],&a[3]);
+        o = Find(op,OpName,TIMER_TRACE_SETTING + 1u);
+        k = Find(kind,KindName,TIMER_TRACE_KINDS);
+        if ((n < 4) || (o <= 0) || (k < 0)) {
+            fprintf(stderr,"line %u: bad command\n",ln);
+            return false;
+        }
+        need = (o == TIMER_TRACE_SET) ? SetArgs[k] : (o == TIMER_TRACE_STOP) ? 0u :
+            ((o == TIMER_TRACE_SETTING) && (k == TIMER_TRACE_ASYMMETRIC)) ? 2u : 1u;
+        if ((uint32_t)(n - 4) < need) {
+            fprintf(stderr,"line %u: %u arguments expected\n",ln,need);
+            return false;
+        }
+        Script = (TimerTraceRecord *)realloc(Script,(NScript + 1u) * sizeof(*Script));
+        if (Script == NULL) {
+            return false;
+        }
+        Script[NScript].Tick = (uint32_t)t;
+        Script[NScript].Op = (uint8_t)o;
+        Script[NScript].Kind = (uint8_t)k;
+        Script[NScript].Id = (uint16_t)id;
+        Script[NScript].A = (need > 0u) ? (uint32_t)a[0] : 0u;
+        Script[NScript].B = (need > 1u) ? (uint32_t)a[1] : 0u;
+        Script[NScript].C = (need > 2u) ? (uint32_t)a[2] : 0u;
+        Script[NScript].D = (need > 3u) ? (uint32_t)a[3] : 0u;
+        if (id >= TIMERS) {
+            fprintf(stderr,"line %u: id above %u\n",ln,TIMERS - 1u);
+            return false;
+        }
+        NScript++;
+    }
+    return true;
+}
+
+// golden trace of the commands of a log or of a trace; its events are replaced
+static int Import(const char *in, const char *out, uint32_t ticks)
+{
+    TimerTraceHeader h;
+    TimerTraceRecord *r;
+    FILE *f;
+    uint32_t i, n = 0u, timers = 1u, last = 0u;
+
+    if ((r = TimerTraceLoad(in,&h)) != NULL) {
+        for (i = 0u; i < h.Records; i++) {
+            if (r[i].Op != TIMER_TRACE_EVENT) {
+                r[n++] = r[i];
+            }
+        }
+        Script = r;
+        NScript = n;
+        last = h.Ticks;
+    } else if ((f = fopen(in,"r")) != NULL) {
+        if (ParseText(f) == false) {
+            fclose(f);
+            return 1;
+        }
+        fclose(f);
+    } else {
+        fprintf(stderr,"cannot read %s\n",in);
+        return 1;
+    }
+    for (i = 0u; i < NScript; i++) {
+        if ((Valid(&Script[i]) == false) || ((i != 0u) && (Script[i].Tick < Script[i - 1u].Tick))) {
+            fprintf(stderr,"command %u: invalid or out of order\n",i);
+            return 1;
+        }
+        if (Script[i].Id >= timers) {
+            timers = Script[i].Id + 1u;
+        }
+    }
+    if ((NScript != 0u) && (Script[NScript - 1u].Tick + TAIL > last)) {
+        last = Script[NScript - 1u].Tick + TAIL;
+    }
+    if (ticks == 0u) {
+        ticks = last;
+    }
+    KScript = 0u;
+    if (Record(out,ticks,timers,ScriptWork) == false) {
+        fprintf(stderr,"cannot write %s\n",out);
+        return 1;
+    }
+    printf("%s: %u commands, %u events, %u ticks\n",out,W.H.Records - W.H.Events,W.H.Events,ticks);
+    return 0;
+}
+
+// REPLAY
+static int CompareEvents(const void *a, const void *b)
+{
+    const Event *x = (const Event *)a, *y = (const Event *)b;
+
+    if (x->Tick != y->Tick) {
+        return (x->Tick < y->Tick) ? -1 : 1;
+    }
+    if (x->Kind != y->Kind) {
+        return (x->Kind < y->Kind) ? -1 : 1;
+    }
+    return (x->Id < y->Id) ? -1 : (x->Id > y->Id) ? 1 : 0;
+}
+
+static int CompareU32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+    return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+// one run of the commands; lat receives the ns of every step (tick and
+// collection of its events) when it is not NULL; returns the steps
+static uint32_t Run(const Engine *e, const TimerTraceRecord *cmd, uint32_t ncmd, uint32_t ticks, uint32_t *lat)
+{
+    uint32_t k = 0u, steps = 0u, next;
+    double t = 0.0;
+
+    Now = 0u;
+    NOut = 0u;
+    e->Reset();
+    while ((k < ncmd) && (cmd[k].Tick == 0u)) {
+        e->Command(&cmd[k++]);
+    }
+    e->Collect();
+    while (Now < ticks) {
+        next = ((k < ncmd) && (cmd[k].Tick < ticks)) ? cmd[k].Tick : ticks;
+        if (lat != NULL) {
+            t = Seconds();
+        }
+        Now += e->Step(next - Now);
+        e->Collect();
+        if (lat != NULL) {
+            lat[steps] = (uint32_t)((Seconds() - t) * 1e9);
+        }
+        steps++;
+        if ((k < ncmd) && (cmd[k].Tick == Now)) {
+            do {
+                e->Command(&cmd[k++]);
+            } while ((k < ncmd) && (cmd[k].Tick == Now));
+            e->Collect();
+        }
+    }
+    return steps;
+}
+
+typedef struct {
+    char Engine[32];
+    double TicksPerS;
+    double P50;
+    double P99;
+    double Max;
+} Baseline;
+
+static bool LoadBaseline(const char *path, Baseline *b)
+{
+    FILE *f = fopen(path,"r");
+    char line[256], key[32], value[192];
+
+    if (f == NULL) {
+        return false;
+    }
+    memset(b,0,sizeof(*b));
+    while (fgets(line,sizeof(line),f) != NULL) {
+        if (sscanf(line,"%31[^=]=%191s",key,value) != 2) {
+            continue;
+        }
+        if (strcmp(key,"engine") == 0) {
+            snprintf(b->Engine,sizeof(b->Engine),"%.31s",value);
+        } else if (strcmp(key,"ticks_per_s") == 0) {
+            b->TicksPerS = strtod(value,NULL);
+        } else if (strcmp(key,"p50_ns") == 0) {
+            b->P50 = strtod(value,NULL);
+        } else if (strcmp(key,"p99_ns") == 0) {
+            b->P99 = strtod(value,NULL);
+        } else if (strcmp(key,"max_ns") == 0) {
+            b->Max = strtod(value,NULL);
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+static double Delta(double now, double base)
+{
+    return (base != 0.0) ? 100.0 * (now - base) / base : 0.0;
+}
+
+static int Replay(const char *path, const Engine *e, const char *save, const char *base)
+{
+    TimerTraceHeader h;
+    TimerTraceRecord *r;
+    Event *golden;
+    uint32_t *lat;
+    uint32_t i, ncmd = 0u, nev = 0u, steps, runs = 0u, skipped = 0u;
+    double t, tps;
+    Baseline b;
+    FILE *f;
+    int status = 0;
+
+    if ((r = TimerTraceLoad(path,&h)) == NULL) {
+        fprintf(stderr,"cannot read %s\n",path);
+        return 1;
+    }
+    if ((h.Timers > TIMERS) || (h.Ticks == 0u)) {
+        fprintf(stderr,"%s: %u timers, %u ticks\n",path,h.Timers,h.Ticks);
+        return 1;
+    }
+    golden = (Event *)malloc((h.Events + 1u) * sizeof(*golden));
+    lat = (uint32_t *)malloc((size_t)h.Ticks * sizeof(*lat));
+    if ((golden == NULL) || (lat == NULL)) {
+        fprintf(stderr,"out of memory\n");
+        return 1;
+    }
+    for (i = 0u; i < h.Records; i++) {
+        if ((r[i].Kind < TIMER_TRACE_KINDS) && ((e->Kinds & (1u << r[i].Kind)) == 0u)) {
+            skipped |= 1u << r[i].Kind;
+        } else if (r[i].Op == TIMER_TRACE_EVENT) {
+            golden[nev].Tick = r[i].Tick;
+            golden[nev].Kind = r[i].Kind;
+            golden[nev].Id = r[i].Id;
+            nev++;
+        } else if (Valid(&r[i]) == false) {
+            fprintf(stderr,"%s: record %u (%s %u) is invalid\n",path,i,
+                    (r[i].Op <= TIMER_TRACE_EVENT) ? OpName[r[i].Op] : "?",r[i].Kind);
+            return 1;
+        } else {
+            r[ncmd++] = r[i];
+        }
+    }
+    Timers = h.Timers;
+    printf("trace %s: %u ticks, %u commands, %u events, %u timers per kind\n",path,h.Ticks,ncmd,nev,h.Timers);
+    if (skipped != 0u) {
+        printf("engine %s does not run",e->Name);
+        for (i = 0u; i < TIMER_TRACE_KINDS; i++) {
+            if ((skipped & (1u << i)) != 0u) {
+                printf(" %s",KindName[i]);
+            }
+        }
+        printf(": skipped\n");
+        if (ncmd == 0u) {
+            return 3;
+        }
+    }
+
+    // equivalence
+    Run(e,r,ncmd,h.Ticks,NULL);
+    qsort(golden,nev,sizeof(*golden),CompareEvents);
+    qsort(Out,NOut,sizeof(*Out),CompareEvents);
+    for (i = 0u; (i < nev) && (i < NOut) && (CompareEvents(&golden[i],&Out[i]) == 0); i++) {
+    }
+    if ((i == nev) && (i == NOut)) {
+        printf("engine %s: %u events equal\n",e->Name,nev);
+    } else {
+        printf("engine %s: events differ at %u of %u (%u given)",e->Name,i,nev,NOut);
+        if (i < nev) {
+            printf(", expected %s %u at tick %u",KindName[golden[i].Kind],golden[i].Id,golden[i].Tick);
+        }
+        if (i < NOut) {
+            printf(", got %s %u at tick %u",KindName[Out[i].Kind],Out[i].Id,Out[i].Tick);
+        }
+        printf("\n");
+        status = 1;
+    }
+
+    // throughput
+    t = Seconds();
+    do {
+        Run(e,r,ncmd,h.Ticks,NULL);
+        runs++;
+    } while (Seconds() - t < MIN_TIME);
+    t = Seconds() - t;
+    tps = (double)h.Ticks * runs / t;
+    printf("throughput %.2f Mticks/s, %.2f Mcommands/s (%u runs, %.3f s)\n",tps * 1e-6,(double)ncmd * runs / t * 1e-6,runs,t);
+
+    // latency of the steps, with the clock
+    steps = Run(e,r,ncmd,h.Ticks,lat);
+    qsort(lat,steps,sizeof(*lat),CompareU32);
+    printf("step latency p50 %u ns, p99 %u ns, max %u ns (%u steps)\n",lat[steps / 2u],lat[(uint32_t)((uint64_t)steps * 99u / 100u)],
+            lat[steps - 1u],steps);
+
+    if ((base != NULL) && (LoadBaseline(base,&b) == true)) {
+        printf("against %s (%s): throughput %+.1f%%, p50 %+.1f%%, p99 %+.1f%%, max %+.1f%%\n",base,b.Engine,
+                Delta(tps,b.TicksPerS),Delta(lat[steps / 2u],b.P50),Delta(lat[(uint32_t)((uint64_t)steps * 99u / 100u)],b.P99),
+                Delta(lat[steps - 1u],b.Max));
+        if ((status == 0) && (Delta(tps,b.TicksPerS) < -REGRESSION)) {
+            printf("throughput regression above %.0f%%\n",REGRESSION);
+            status = 2;
+        }
+    } else if (base != NULL) {
+        fprintf(stderr,"cannot read %s\n",base);
+    }
+    if (save != NULL) {
+        if ((f = fopen(save,"w")) == NULL) {
+            fprintf(stderr,"cannot write %s\n",save);
+        } else {
+            fprintf(f,"trace=%s\nengine=%s\nticks_per_s=%.0f\np50_ns=%u\np99_ns=%u\nmax_ns=%u\n",path,e->Name,tps,
+                    lat[steps / 2u],lat[(uint32_t)((uint64_t)steps * 99u / 100u)],lat[steps - 1u]);
+            fclose(f);
+        }
+    }
+    free(r);
+    free(golden);
+    free(lat);
+    return status;
+}
+
+static void Usage(void)
+{
+    fprintf(stderr,"tracebench record demo|random|simple out.trc [ticks] [timers]\n"
+            "tracebench import cmds.txt|app.trc out.trc [ticks]\n"
+            "tracebench replay in.trc [macros|advance|branchless|pool|wheel] [-s base.txt] [-b base.txt]\n");
+}
+
+int main(int argc, char **argv)
+{
+    const Engine *e = &Engines[0];
+    const char *save = NULL, *base = NULL;
+    uint32_t ticks, timers;
+    Workload fn;
+    int k, i;
+
+    if (argc < 3) {
+        Usage();
+        return 1;
+    }
+    if ((strcmp(argv[1],"record") == 0) && (argc >= 4)) {
+        ticks = (argc > 4) ? (uint32_t)strtoul(argv[4],NULL,0) : TICKS;
+        timers = (argc > 5) ? (uint32_t)strtoul(argv[5],NULL,0) : 0u;
+        if (strcmp(argv[2],"demo") == 0) {
+            fn = DemoWork;
+            timers = (timers != 0u) ? timers : DEMO_TIMERS;
+        } else if ((strcmp(argv[2],"random") == 0) || (strcmp(argv[2],"simple") == 0)) {
+            fn = RandomWork;
+            Kinds = (argv[2][0] == 'r') ? ALL_KINDS : 0x03u;
+            timers = (timers != 0u) ? timers : RANDOM_TIMERS;
+        } else {
+            Usage();
+            return 1;
+        }
+        if ((ticks == 0u) || (timers > TIMERS)) {
+            fprintf(stderr,"1 tick and %u timers at least\n",TIMERS);
+            return 1;
+        }
+        if (Record(argv[3],ticks,timers,fn) == false) {
+            fprintf(stderr,"cannot write %s\n",argv[3]);
+            return 1;
+        }
+        printf("%s: %u commands, %u events, %u ticks\n",argv[3],W.H.Records - W.H.Events,W.H.Events,ticks);
+        return 0;
+    }
+    if ((strcmp(argv[1],"import") == 0) && (argc >= 4)) {
+        return Import(argv[2],argv[3],(argc > 4) ? (uint32_t)strtoul(argv[4],NULL,0) : 0u);
+    }
+    if (strcmp(argv[1],"replay") == 0) {
+        for (k = 3; k < argc; k++) {
+            if ((strcmp(argv[k],"-s") == 0) && (k + 1 < argc)) {
+                save = argv[++k];
+            } else if ((strcmp(argv[k],"-b") == 0) && (k + 1 < argc)) {
+                base = argv[++k];
+            } else {
+                for (i = 0; (i < (int)(sizeof(Engines) / sizeof(Engines[0]))) && (strcmp(argv[k],Engines[i].Name) != 0); i++) {
+                }
+                if (i == (int)(sizeof(Engines) / sizeof(Engines[0]))) {
+                    fprintf(stderr,"unknown engine %s\n",argv[k]);
+                    return 1;
+                }
+                e = &Engines[i];
+            }
+        }
+        return Replay(argv[2],e,save,base);
+    }
+    Usage();
+    return 1;
+}
+
+// End of tracebench.c
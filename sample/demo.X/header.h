@@ -57,6 +57,32 @@ extern "C" {
 
 #define RTC_TICK    (100u)  // 100 x 0.1ms = 10ms
 
+// adaptive tick (timeadapt.h): TMR0 counts 16us in 16-bit mode and overflows
+// after 1..RTC_MAX_SCALE RTC ticks; RTC_Base is the TMR0 value of the start of
+// the current period
+#if defined(RTC_ADAPTIVE)
+#define INI_T0CON0_ADAPTIVE (0b00010000u)   // disabled, 16bit, post=1:1
+#define INI_T0CON1_ADAPTIVE (0b01000110u)   // Fosc/4, synchronized, pre=1:64
+#define RTC_COUNTS      (625u)              // TMR0 counts of an RTC tick
+#define RTC_MAX_SCALE   (100u)              // RTC_MAX_SCALE * RTC_COUNTS < 65536
+#define TIMER_ADAPT_MAX RTC_MAX_SCALE
+
+#define RTClockStartAdaptive() { \
+    T0CON0 = INI_T0CON0_ADAPTIVE; \
+    T0CON1 = INI_T0CON1_ADAPTIVE; \
+    RTC_Base = (uint16_t)(0u - RTC_COUNTS); \
+    TMR0H = (uint8_t)(RTC_Base >> 8); \
+    TMR0L = (uint8_t)RTC_Base; \
+    TMR0IF = false; \
+    TMR0IE = true; \
+    T0EN = true; \
+}
+
+extern uint16_t RTC_Base;
+uint16_t RTClockCatchUp(void);
+void RTClockProgram(uint16_t d);
+#endif  // defined(RTC_ADAPTIVE)
+
 // time units in rtc ticks
 #define MU_001S (100u/RTC_TICK)     // 0.01 sec
 #define MU_01S  (1000u/RTC_TICK)    // 0.1 sec
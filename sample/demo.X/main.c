@@ -17,29 +17,81 @@
 #include "cdefs.h"
 #include "timedefs.h"
 #include "header.h"
+#include "timewait.h"
+#if defined(RTC_ADAPTIVE)
+#include "timeadapt.h"
+#endif  // defined(RTC_ADAPTIVE)
 
 DEFINE_SINGLE_PULSE_TIMER(T1,uint8_t);
 DEFINE_BURST_GENERATOR(G1,uint8_t);
 
+// events of the main loop
+#define EV_T1   (0x01u)
+#define EV_G1   (0x02u)
+
+static uint8_t TimersPending(void)
+{
+    uint8_t m = 0u;
+
+    if (SinglePulseTimerExpired(T1) == true) {
+        m |= EV_T1;
+    }
+    if (BurstGeneratorTick(G1) == true) {
+        m |= EV_G1;
+    }
+    return m;
+}
+
+#if defined(RTC_ADAPTIVE)
+DEFINE_ADAPTIVE_TICK
+uint16_t RTC_Base;
+
+static uint16_t TimersAdvance(uint16_t n)
+{
+    uint16_t d = TIMER_ADAPT_MAX;
+
+    AdvanceSinglePulseTimer(T1,n);
+    AdvanceBurstGeneratorWithOutput(G1,n,LATAbits.LATA1);
+    NextEventSinglePulseTimer(T1,d);
+    NextEventBurstGenerator(G1,d);
+    return d;
+}
+#endif  // defined(RTC_ADAPTIVE)
+
 void main(void)
 {
+    uint8_t ev;
+
     DisableInterrupts();
     CLRWDT();
     Initialize();
 
+#if !defined(RTC_ADAPTIVE)
     RTClockStart();
+#else   // !defined(RTC_ADAPTIVE)
+    RTClockStartAdaptive();
+#endif  // !defined(RTC_ADAPTIVE)
     INTCONbits.PEIE = true;
     EnableInterrupts();
 
+#if !defined(RTC_ADAPTIVE)
     SetSinglePulseTimer(T1,50u*MU_001S);
+#else   // !defined(RTC_ADAPTIVE)
+    AdaptiveSet(TimersAdvance,SetSinglePulseTimerI(T1,50u*MU_001S));
+#endif  // !defined(RTC_ADAPTIVE)
     do {
         CLRWDT();
-        if (SinglePulseTimerExpired(T1) == true) {
+        WaitForTimerEvent(TimersPending,ev);
+        if ((ev & EV_T1) != 0u) {
             SinglePulseTimerExpired(T1) = false;
             LATAbits.LATA0 = highstate;
+#if !defined(RTC_ADAPTIVE)
             SetBurstGeneratorWithOutput(G1,5u,3u*MU_001S,2u*MU_001S,5u*MU_001S,LATAbits.LATA1);
+#else   // !defined(RTC_ADAPTIVE)
+            AdaptiveSet(TimersAdvance,SetBurstGeneratorIWithOutput(G1,5u,3u*MU_001S,2u*MU_001S,5u*MU_001S,LATAbits.LATA1));
+#endif  // !defined(RTC_ADAPTIVE)
         }
-        if (BurstGeneratorTick(G1) == true) {
+        if ((ev & EV_G1) != 0u) {
             BurstGeneratorTick(G1) = false;
             NOP();
         }
@@ -79,9 +131,44 @@ void __interrupt() intr(void)
     if ((TMR0IE == true) && (TMR0IF == true)) {
         TMR0IF = false;
 
+#if !defined(RTC_ADAPTIVE)
         TickSinglePulseTimer(T1);
         TickBurstGeneratorWithOutput(G1,LATAbits.LATA1);
+#else   // !defined(RTC_ADAPTIVE)
+        RTC_Base = 0u;      // the new period started at the overflow
+        AdaptiveTick(TimersAdvance);
+#endif  // !defined(RTC_ADAPTIVE)
     }
 }
 
+#if defined(RTC_ADAPTIVE)
+static uint16_t RTClockRead(void)
+{
+    uint8_t l = TMR0L;      // latches TMR0H
+
+    return ((uint16_t)TMR0H << 8) | l;
+}
+
+uint16_t RTClockCatchUp(void)
+{
+    uint16_t e = (uint16_t)(RTClockRead() - RTC_Base) / RTC_COUNTS;
+
+    RTC_Base += e * RTC_COUNTS;
+    return e;
+}
+
+// the counts since the start of the period are kept; the write clears the
+// prescaler, which loses less than one count (16us) per call
+void RTClockProgram(uint16_t d)
+{
+    uint16_t p = (uint16_t)(0u - d * RTC_COUNTS);
+    uint16_t t = (uint16_t)(RTClockRead() - RTC_Base) + p;
+
+    TMR0H = (uint8_t)(t >> 8);
+    TMR0L = (uint8_t)t;
+    RTC_Base = p;
+    TMR0IF = false;
+}
+#endif  // defined(RTC_ADAPTIVE)
+
 // End of main.c
@@ -0,0 +1,103 @@
+/* timeadapt.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if !defined(timeadapt_h_included)
+#define timeadapt_h_included
+
+// ADAPTIVE TICK RATE
+// The counters keep their unit, the RTC tick (MU_001S and the others do not
+// change), but the hardware interrupt is stretched over several ticks while no
+// armed timer needs the fine resolution. The interrupt period is the distance
+// to the nearest timer event (NextEvent*), up to TIMER_ADAPT_MAX ticks, and the
+// interrupt catches the elapsed ticks up at once with the Advance* macros. So
+// a burst generator in its pulses keeps the tick at 1, while only coarse
+// timers (seconds, minutes) let the interrupt come rarely. Every event still
+// happens at the same tick as with the fixed rate.
+//
+// When the main loop arms a timer, the current long period may end after the
+// first event of that timer. AdaptiveSet() speeds the tick up atomically: with
+// the interrupts disabled it catches up the whole ticks elapsed in the period,
+// arms the timer (a Set*I macro) and programs the period anew from the nearest
+// event. The part of the tick already elapsed is kept, exactly as when a timer
+// is set between two fixed ticks.
+//
+// The application lists its timers once, like for timefd.h:
+//
+//  static uint16_t TimersAdvance(uint16_t n)
+//  {
+//      uint16_t d = TIMER_ADAPT_MAX;
+//      AdvanceSinglePulseTimer(T1,n);
+//      AdvanceBurstGeneratorWithOutput(G1,n,LATAbits.LATA1);
+//      NextEventSinglePulseTimer(T1,d);
+//      NextEventBurstGenerator(G1,d);
+//      return d;
+//  }
+//
+//  in the tick interrupt:  AdaptiveTick(TimersAdvance);
+//  in the main loop:       AdaptiveSet(TimersAdvance,SetSinglePulseTimerI(T1,50u*MU_001S));
+//
+// The port supplies two functions of the RTC hardware:
+//  uint16_t RTClockCatchUp(void)   - whole ticks elapsed since the start of the
+//                                    current period; the start moves by them
+//  void RTClockProgram(uint16_t d) - end of the current period d ticks after
+//                                    its start (d >= 1); in the interrupt the
+//                                    period starts when the previous one ended;
+//                                    an interrupt of the old period that is
+//                                    pending is dropped
+// sample/demo.X does it with TMR0 in 16-bit mode (RTC_ADAPTIVE).
+//
+// Between the interrupts the counters are not up to date. The event flags are.
+// Timers are read by the main loop through their flags only, or after
+// AdaptiveSet(TimersAdvance,) with no Set.
+
+#include <stdint.h>
+
+#if !defined(TIMER_ADAPT_MAX)
+#define TIMER_ADAPT_MAX     (1u)        // longest period in ticks the RTC can be programmed to
+#endif  // !defined(TIMER_ADAPT_MAX)
+
+// definition of the state in a C file
+#define DEFINE_ADAPTIVE_TICK uint16_t TA_Scale = 1u;
+// declaration in a header file
+#define EXTERN_ADAPTIVE_TICK extern uint16_t TA_Scale;
+
+// ticks of the current interrupt period
+#define AdaptiveTickScale() TA_Scale
+
+// tick interrupt: the programmed period has elapsed
+#define AdaptiveTick(advance) { \
+    TA_Scale = (advance)(TA_Scale); \
+    if (TA_Scale == 0u) { \
+        TA_Scale = 1u; \
+    } \
+    RTClockProgram(TA_Scale); \
+}
+
+// main loop: set is one or more Set*I (or Stop*I) statements
+#define AdaptiveSet(advance,set) { \
+    DisableInterrupts(); \
+    (void)(advance)(RTClockCatchUp()); \
+    set; \
+    TA_Scale = (advance)(0u); \
+    if (TA_Scale == 0u) { \
+        TA_Scale = 1u; \
+    } \
+    RTClockProgram(TA_Scale); \
+    EnableInterrupts(); \
+}
+
+#endif  // !defined(timeadapt_h_included)
+
+// End of timeadapt.h
@@ -0,0 +1,185 @@
+/* timebudget.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if !defined(timebudget_h_included)
+#define timebudget_h_included
+
+// BUILD TIME BUDGET OF THE TIMERS
+// The application lists its timers once, as an X macro of entries
+// X(kind,name,(arguments of DEFINE_kind after the name)):
+//
+//  #define APP_TIMERS(X) X(SINGLE_PULSE_TIMER,T1,(uint8_t)) X(BURST_GENERATOR,G1,(uint16_t))
+//  (a long list goes on the next lines with backslashes)
+//
+//  DEFINE_TIMER_LIST(APP_TIMERS)           // DEFINE_kind(name,...) of every timer
+//  TIMER_BUDGET_CHECK(APP_TIMERS)          // fails the build over a budget
+//
+// and gets, as constant expressions,
+// - TimerBudgetTickOps(list)   - the worst path of all Tick* macros in one tick,
+//                                plus TIMER_BUDGET_ISR_OPS
+// - TimerBudgetCsOps(list)     - the longest critical section of the Set*,
+//                                Change* and Stop* macros of the timers
+// - TimerBudgetRam(list)       - the bytes of the timer variables
+// The costs are in abstract operations: a load, store, compare or arithmetic of
+// one ttype (sizeof(ttype) of them on an 8-bit target), a bit test or set, and
+// TIMER_BUDGET_DIV_OPS for a 32-bit division. They are upper bounds of the
+// macros as written, not a measurement; on the known targets an operation is
+// TIMER_BUDGET_CYCLES_PER_OP cycles (XC8: instruction cycles with the bank
+// selects and skips, x86-64: core cycles), elsewhere 1. Only the x86-64
+// figures were measured; the XC8 default of 2 is an estimate, not a
+// calibration on a PIC, and should be set for the part in use.
+// TIMER_BUDGET_CHECK compares the cycles of the tick with TIMER_BUDGET_TICK,
+// the critical section of every timer with TIMER_BUDGET_CS and the RAM with
+// TIMER_BUDGET_RAM; a failed check is a negative array size in a typedef named
+// after the budget (or the timer).
+// DEBOUNCE_BANK and BURST_BANK are costed by their tick with the raw input and
+// with output, BURST_GENERATOR with output. A LAZY_FBVSINGLE_PULSE_TIMER costs
+// nothing in the tick; its Lazy* macros do not disable the interrupts, its
+// critical section entry is the longest of them (the update and the I macro it
+// wraps) for an application that calls them under a lock. Timers of
+// timehyper.h and the other headers are not covered.
+
+#include <stdint.h>
+
+#if defined(__XC8)
+#define TIMER_BUDGET_W_(t)  (sizeof(t))             // ops of one ttype operation
+#define TIMER_BUDGET_B1_(n) (((n) + 7u) / 8u)       // bytes of n B1 of a timer
+#if !defined(TIMER_BUDGET_CYCLES_PER_OP)
+#define TIMER_BUDGET_CYCLES_PER_OP (2u)
+#endif  // !defined(TIMER_BUDGET_CYCLES_PER_OP)
+#if !defined(TIMER_BUDGET_DIV_OPS)
+#define TIMER_BUDGET_DIV_OPS (400u)
+#endif  // !defined(TIMER_BUDGET_DIV_OPS)
+#if !defined(TIMER_BUDGET_ISR_OPS)
+#define TIMER_BUDGET_ISR_OPS (12u)                  // entry, flag test and clear, retfie
+#endif  // !defined(TIMER_BUDGET_ISR_OPS)
+#else   // defined(__XC8)
+#define TIMER_BUDGET_W_(t)  (1u)
+#define TIMER_BUDGET_B1_(n) ((n) * sizeof(B1))
+#if !defined(TIMER_BUDGET_CYCLES_PER_OP)
+#define TIMER_BUDGET_CYCLES_PER_OP (1u)
+#endif  // !defined(TIMER_BUDGET_CYCLES_PER_OP)
+#if !defined(TIMER_BUDGET_DIV_OPS)
+#if defined(__x86_64__)
+#define TIMER_BUDGET_DIV_OPS (26u)
+#else   // defined(__x86_64__)
+#define TIMER_BUDGET_DIV_OPS (40u)
+#endif  // defined(__x86_64__)
+#endif  // !defined(TIMER_BUDGET_DIV_OPS)
+#if !defined(TIMER_BUDGET_ISR_OPS)
+#define TIMER_BUDGET_ISR_OPS (0u)
+#endif  // !defined(TIMER_BUDGET_ISR_OPS)
+#endif  // defined(__XC8)
+
+#if !defined(TIMER_BUDGET_TICK)
+#define TIMER_BUDGET_TICK   (0xFFFFFFFFuL)  // cycles of one tick
+#endif  // !defined(TIMER_BUDGET_TICK)
+#if !defined(TIMER_BUDGET_CS)
+#define TIMER_BUDGET_CS     (0xFFFFFFFFuL)  // cycles with the interrupts disabled
+#endif  // !defined(TIMER_BUDGET_CS)
+#if !defined(TIMER_BUDGET_RAM)
+#define TIMER_BUDGET_RAM    (0xFFFFFFFFuL)  // bytes
+#endif  // !defined(TIMER_BUDGET_RAM)
+
+#define TIMER_BUDGET_U8_    TIMER_BUDGET_W_(uint8_t)
+
+// worst path of the tick
+#define TIMER_TICK_SINGLE_PULSE_TIMER(t) (3u + 2u * TIMER_BUDGET_W_(t))
+#define TIMER_TICK_CONTINUOUS_TIMER(t) (2u + 3u * TIMER_BUDGET_W_(t))
+#define TIMER_TICK_CONST_CONTINUOUS_TIMER(t) (2u + 3u * TIMER_BUDGET_W_(t))
+#define TIMER_TICK_CONST_FREE_CONTINUOUS_TIMER(t) (1u + 3u * TIMER_BUDGET_W_(t))
+#define TIMER_TICK_TIMER_GROUP(t,m) (3u * TIMER_BUDGET_W_(t) + 2u * TIMER_BUDGET_W_(m))
+#define TIMER_TICK_FBSINGLE_PULSE_TIMER(t) (4u + 2u * TIMER_BUDGET_W_(t))
+#define TIMER_TICK_FBVSINGLE_PULSE_TIMER(t) (4u + 3u * TIMER_BUDGET_W_(t))
+#define TIMER_TICK_LAZY_FBVSINGLE_PULSE_TIMER(t) (0u)
+#define TIMER_TICK_ASYMMETRIC_CONTINUOUS_TIMER(t) (4u + 4u * TIMER_BUDGET_W_(t))
+#define TIMER_TICK_RAMP_ASYMMETRIC_CONTINUOUS_TIMER(t) (8u + 18u * TIMER_BUDGET_W_(t))
+#define TIMER_TICK_ASYMMETRIC_SINGLE_PULSE_TIMER(t) (6u + 4u * TIMER_BUDGET_W_(t))
+#define TIMER_TICK_BURST_GENERATOR(t) (5u + 3u * TIMER_BUDGET_W_(t) + 3u * TIMER_BUDGET_U8_)
+#define TIMER_TICK_BURST_BANK(t,m,edges) (4u + 3u * TIMER_BUDGET_W_(t) + 4u * TIMER_BUDGET_W_(m) + 6u * TIMER_BUDGET_U8_)
+#define TIMER_TICK_DEBOUNCE_BANK(w,words,bits) (1u + (words) * ((10u + 9u * (bits)) * TIMER_BUDGET_W_(w) + \
+    (2u + 3u * (bits)) * TIMER_BUDGET_U8_))
+
+// longest critical section of the Set*, Change* and Stop* macros
+#define TIMER_CS_SINGLE_PULSE_TIMER(t) (2u + TIMER_BUDGET_W_(t))
+#define TIMER_CS_CONTINUOUS_TIMER(t) (2u + 2u * TIMER_BUDGET_W_(t))
+#define TIMER_CS_CONST_CONTINUOUS_TIMER(t) (2u + TIMER_BUDGET_W_(t))
+#define TIMER_CS_CONST_FREE_CONTINUOUS_TIMER(t) (1u + TIMER_BUDGET_W_(t))
+#define TIMER_CS_TIMER_GROUP(t,m) (TIMER_BUDGET_W_(t) + 2u * TIMER_BUDGET_W_(m))
+#define TIMER_CS_FBSINGLE_PULSE_TIMER(t) (4u + 2u * TIMER_BUDGET_W_(t))
+#define TIMER_CS_FBVSINGLE_PULSE_TIMER(t) (4u + 4u * TIMER_BUDGET_W_(t))
+#define TIMER_CS_LAZY_FBVSINGLE_PULSE_TIMER(t) (TIMER_CS_FBVSINGLE_PULSE_TIMER(t) + \
+    3u * TIMER_BUDGET_W_(TIMER_LAZY_STAMP) + 5u + 7u * TIMER_BUDGET_W_(t) + 2u * TIMER_BUDGET_DIV_OPS)
+#define TIMER_CS_ASYMMETRIC_CONTINUOUS_TIMER(t) (3u + 4u * TIMER_BUDGET_W_(t))
+#define TIMER_CS_RAMP_ASYMMETRIC_CONTINUOUS_TIMER(t) (8u + 14u * TIMER_BUDGET_W_(t))
+#define TIMER_CS_ASYMMETRIC_SINGLE_PULSE_TIMER(t) (6u + 4u * TIMER_BUDGET_W_(t))
+#define TIMER_CS_BURST_GENERATOR(t) (4u + 4u * TIMER_BUDGET_W_(t) + 2u * TIMER_BUDGET_U8_)
+#define TIMER_CS_BURST_BANK(t,m,edges) (3u + TIMER_BUDGET_W_(t) + 2u * TIMER_BUDGET_W_(m) + 3u * TIMER_BUDGET_U8_)
+#define TIMER_CS_DEBOUNCE_BANK(w,words,bits) (2u + (words) * (((bits) + 2u) * TIMER_BUDGET_W_(w) + 2u * TIMER_BUDGET_U8_))
+
+// bytes of the variables
+#define TIMER_RAM_SINGLE_PULSE_TIMER(t) (sizeof(t) + TIMER_BUDGET_B1_(2u))
+#define TIMER_RAM_CONTINUOUS_TIMER(t) (2u * sizeof(t) + TIMER_BUDGET_B1_(2u))
+#define TIMER_RAM_CONST_CONTINUOUS_TIMER(t) (sizeof(t) + TIMER_BUDGET_B1_(2u))
+#define TIMER_RAM_CONST_FREE_CONTINUOUS_TIMER(t) (sizeof(t) + TIMER_BUDGET_B1_(1u))
+#define TIMER_RAM_TIMER_GROUP(t,m) (sizeof(t) + 2u * sizeof(m))
+#define TIMER_RAM_FBSINGLE_PULSE_TIMER(t) (2u * sizeof(t) + TIMER_BUDGET_B1_(3u))
+#define TIMER_RAM_FBVSINGLE_PULSE_TIMER(t) (4u * sizeof(t) + TIMER_BUDGET_B1_(3u))
+#define TIMER_RAM_LAZY_FBVSINGLE_PULSE_TIMER(t) (TIMER_RAM_FBVSINGLE_PULSE_TIMER(t) + sizeof(TIMER_LAZY_STAMP))
+#define TIMER_RAM_ASYMMETRIC_CONTINUOUS_TIMER(t) (3u * sizeof(t) + TIMER_BUDGET_B1_(3u))
+#define TIMER_RAM_RAMP_ASYMMETRIC_CONTINUOUS_TIMER(t) (7u * sizeof(t) + 2u * sizeof(const t *) + 2u + TIMER_BUDGET_B1_(5u))
+#define TIMER_RAM_ASYMMETRIC_SINGLE_PULSE_TIMER(t) (3u * sizeof(t) + TIMER_BUDGET_B1_(5u))
+#define TIMER_RAM_BURST_GENERATOR(t) (4u * sizeof(t) + 2u + TIMER_BUDGET_B1_(3u))
+#define TIMER_RAM_BURST_BANK(t,m,edges) (sizeof(t) + 3u + 2u * (edges) * (sizeof(t) + sizeof(m)) + 2u * sizeof(m) + TIMER_BUDGET_B1_(2u))
+#define TIMER_RAM_DEBOUNCE_BANK(w,words,bits) (((bits) + 2u) * (words) * sizeof(w) + 1u + TIMER_BUDGET_B1_(1u))
+
+// the arguments of an entry are in parentheses
+#define TIMER_BUDGET_ARGS_(...) __VA_ARGS__
+#define TIMER_BUDGET_CALL_(m,a) m a
+
+#define TIMER_LIST_DEFINE_(k,x,a) TIMER_BUDGET_CALL_(DEFINE_##k,(x,TIMER_BUDGET_ARGS_ a))
+#define TIMER_LIST_EXTERN_(k,x,a) TIMER_BUDGET_CALL_(EXTERN_##k,(x,TIMER_BUDGET_ARGS_ a))
+#define TIMER_BUDGET_TICK_(k,x,a) + TIMER_TICK_##k a
+#define TIMER_BUDGET_RAM_(k,x,a) + TIMER_RAM_##k a
+// the largest critical section is a fold of TIMER_BUDGET_MAX_ over the list:
+// every timer opens one (deferred, so that the closing parentheses of the
+// second pass are there when TIMER_BUDGET_EVAL_ scans it again)
+#define TIMER_BUDGET_EMPTY_()
+#define TIMER_BUDGET_EVAL_(e) e
+#define TIMER_BUDGET_MAX_(a,b) (((a) > (b)) ? (a) : (b))
+#define TIMER_BUDGET_CS_(k,x,a) TIMER_BUDGET_MAX_ TIMER_BUDGET_EMPTY_() ((TIMER_CS_##k a),
+#define TIMER_BUDGET_CS_END_(k,x,a) )
+#define TIMER_BUDGET_CHECK_CS_(k,x,a) typedef char TimerBudgetCs_##x[((TIMER_CS_##k a) * TIMER_BUDGET_CYCLES_PER_OP <= TIMER_BUDGET_CS) ? 1 : -1];
+
+// definition of all timers of the list in a C file
+#define DEFINE_TIMER_LIST(list) list(TIMER_LIST_DEFINE_)
+// declaration in a header file
+#define EXTERN_TIMER_LIST(list) list(TIMER_LIST_EXTERN_)
+
+#define TimerBudgetTickOps(list) (TIMER_BUDGET_ISR_OPS list(TIMER_BUDGET_TICK_))
+#define TimerBudgetCsOps(list) TIMER_BUDGET_EVAL_(list(TIMER_BUDGET_CS_) 0u list(TIMER_BUDGET_CS_END_))
+#define TimerBudgetRam(list) (0u list(TIMER_BUDGET_RAM_))
+#define TimerBudgetTickCycles(list) (TimerBudgetTickOps(list) * TIMER_BUDGET_CYCLES_PER_OP)
+#define TimerBudgetCsCycles(list) (TimerBudgetCsOps(list) * TIMER_BUDGET_CYCLES_PER_OP)
+
+// at file scope, once per list
+#define TIMER_BUDGET_CHECK(list) \
+    typedef char TimerBudgetTick_[(TimerBudgetTickCycles(list) <= TIMER_BUDGET_TICK) ? 1 : -1]; \
+    typedef char TimerBudgetRam_[(TimerBudgetRam(list) <= TIMER_BUDGET_RAM) ? 1 : -1]; \
+    list(TIMER_BUDGET_CHECK_CS_)
+
+#endif  // !defined(timebudget_h_included)
+
+// End of timebudget.h
@@ -0,0 +1,190 @@
+/* timecmd.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if !defined(timecmd_h_included)
+#define timecmd_h_included
+
+// COMMAND QUEUE (host, GCC atomics)
+// Where the timers are ticked by one thread and changed by several others,
+// DisableInterrupts()/EnableInterrupts() would have to be one global lock. The
+// Q variants of the mutating macros instead push a command to a bounded
+// lock-free queue (timering.h) and return at once; the tick thread applies the
+// queued commands in order at the start of the tick with the I variants, so only
+// the tick thread writes the timer variables. ok receives false when the queue
+// is full and the command is dropped.
+//
+// Every timer that is changed through the queue needs its command functions,
+// defined next to it. A burst generator with output is bound to its output there.
+//
+//  DEFINE_TIMER_COMMAND_QUEUE(Q1);
+//  DEFINE_CONTINUOUS_TIMER(T1,uint32_t);
+//  DEFINE_CONTINUOUS_TIMER_COMMANDS(T1);
+//  DEFINE_BURST_GENERATOR(G1,uint16_t);
+//  DEFINE_BURST_GENERATOR_WITH_OUTPUT_COMMANDS(G1,Output1);
+//
+//  any thread:                             tick thread:
+//      SetContinuousTimerQ(Q1,T1,50u,ok);      TimerCommandQueueInit(Q1);
+//      StopBurstGeneratorWithOutputQ(Q1,G1,ok);    ...
+//                                              ApplyTimerCommands(Q1);
+//                                              TickContinuousTimer(T1);
+//                                              TickBurstGeneratorWithOutput(G1,Output1);
+//
+// Reset* and Clear* stay initialization macros. The event flags are still read
+// and cleared directly by the consumer.
+
+#include "timering.h"
+
+#if !defined(TIMER_COMMAND_QUEUE)
+#define TIMER_COMMAND_QUEUE (1024u)     // power of 2
+#endif  // !defined(TIMER_COMMAND_QUEUE)
+
+typedef struct {
+    void (*Apply)(const uint32_t *arg);
+    uint32_t Arg[4];
+} TimerCommand;
+
+typedef TIMER_RING(TimerCommand,TIMER_COMMAND_QUEUE) TimerCommandQueue;
+
+#define EXTERN_TIMER_COMMAND_QUEUE(q) extern TimerCommandQueue q;
+#define DEFINE_TIMER_COMMAND_QUEUE(q) TimerCommandQueue q;
+
+// initialization before the first command
+#define TimerCommandQueueInit(q) TimerRingInit(q,TIMER_COMMAND_QUEUE)
+
+// application of the queued commands; at the start of the tick
+#define ApplyTimerCommands(q) { \
+    TimerCommand c_; \
+    bool ok_; \
+    for (;;) { \
+        TimerRingPop(q,TIMER_COMMAND_QUEUE,c_,ok_); \
+        if (ok_ == false) { \
+            break; \
+        } \
+        c_.Apply(c_.Arg); \
+    } \
+}
+
+#define TCMD_Push_(q,f,a0,a1,a2,a3,ok) { \
+    TimerCommand c_ = { (f), { (uint32_t)(a0), (uint32_t)(a1), (uint32_t)(a2), (uint32_t)(a3) } }; \
+    TimerRingPush(q,TIMER_COMMAND_QUEUE,c_,ok); \
+}
+
+// SINGLE PULSE TIMER
+#define DEFINE_SINGLE_PULSE_TIMER_COMMANDS(x) \
+    static inline void TCMD_SetST_##x(const uint32_t *a) SetSinglePulseTimerI(x,a[0]) \
+    static inline void TCMD_StopST_##x(const uint32_t *a) { (void)a; StopSinglePulseTimerI(x); } \
+    static inline void TCMD_SuspendST_##x(const uint32_t *a) { (void)a; SuspendSinglePulseTimerI(x); } \
+    static inline void TCMD_ResumeST_##x(const uint32_t *a) { (void)a; ResumeSinglePulseTimerI(x); }
+#define SetSinglePulseTimerQ(q,x,per,ok) TCMD_Push_(q,TCMD_SetST_##x,per,0u,0u,0u,ok)
+#define StopSinglePulseTimerQ(q,x,ok) TCMD_Push_(q,TCMD_StopST_##x,0u,0u,0u,0u,ok)
+#define SuspendSinglePulseTimerQ(q,x,ok) TCMD_Push_(q,TCMD_SuspendST_##x,0u,0u,0u,0u,ok)
+#define ResumeSinglePulseTimerQ(q,x,ok) TCMD_Push_(q,TCMD_ResumeST_##x,0u,0u,0u,0u,ok)
+
+// CONTINUOUS TIMER
+#define DEFINE_CONTINUOUS_TIMER_COMMANDS(x) \
+    static inline void TCMD_SetCT_##x(const uint32_t *a) SetContinuousTimerI(x,a[0]) \
+    static inline void TCMD_StopCT_##x(const uint32_t *a) { (void)a; StopContinuousTimerI(x); } \
+    static inline void TCMD_SuspendCT_##x(const uint32_t *a) { (void)a; SuspendContinuousTimerI(x); } \
+    static inline void TCMD_ResumeCT_##x(const uint32_t *a) { (void)a; ResumeContinuousTimerI(x); }
+#define SetContinuousTimerQ(q,x,per,ok) TCMD_Push_(q,TCMD_SetCT_##x,per,0u,0u,0u,ok)
+#define StopContinuousTimerQ(q,x,ok) TCMD_Push_(q,TCMD_StopCT_##x,0u,0u,0u,0u,ok)
+#define SuspendContinuousTimerQ(q,x,ok) TCMD_Push_(q,TCMD_SuspendCT_##x,0u,0u,0u,0u,ok)
+#define ResumeContinuousTimerQ(q,x,ok) TCMD_Push_(q,TCMD_ResumeCT_##x,0u,0u,0u,0u,ok)
+
+// CONST CONTINUOUS TIMER
+#define DEFINE_CONST_CONTINUOUS_TIMER_COMMANDS(x) \
+    static inline void TCMD_SetCCT_##x(const uint32_t *a) SetConstContinuousTimerI(x,a[0]) \
+    static inline void TCMD_StopCCT_##x(const uint32_t *a) { (void)a; StopConstContinuousTimerI(x); } \
+    static inline void TCMD_SuspendCCT_##x(const uint32_t *a) { (void)a; SuspendConstContinuousTimerI(x); } \
+    static inline void TCMD_ResumeCCT_##x(const uint32_t *a) { (void)a; ResumeConstContinuousTimerI(x); }
+#define SetConstContinuousTimerQ(q,x,per,ok) TCMD_Push_(q,TCMD_SetCCT_##x,per,0u,0u,0u,ok)
+#define StopConstContinuousTimerQ(q,x,ok) TCMD_Push_(q,TCMD_StopCCT_##x,0u,0u,0u,0u,ok)
+#define SuspendConstContinuousTimerQ(q,x,ok) TCMD_Push_(q,TCMD_SuspendCCT_##x,0u,0u,0u,0u,ok)
+#define ResumeConstContinuousTimerQ(q,x,ok) TCMD_Push_(q,TCMD_ResumeCCT_##x,0u,0u,0u,0u,ok)
+
+// CONST FREE CONTINUOUS TIMER
+#define DEFINE_CONST_FREE_CONTINUOUS_TIMER_COMMANDS(x) \
+    static inline void TCMD_SetCFCT_##x(const uint32_t *a) SetConstFreeContinuousTimerI(x,a[0])
+#define SetConstFreeContinuousTimerQ(q,x,per,ok) TCMD_Push_(q,TCMD_SetCFCT_##x,per,0u,0u,0u,ok)
+
+// FB SINGLE PULSE TIMER
+#define DEFINE_FBSINGLE_PULSE_TIMER_COMMANDS(x) \
+    static inline void TCMD_SetFBS_##x(const uint32_t *a) SetFBSinglePulseTimerI(x,a[0],(B1)a[1]) \
+    static inline void TCMD_StopFBS_##x(const uint32_t *a) { (void)a; StopFBSinglePulseTimerI(x); } \
+    static inline void TCMD_ReviveFBS_##x(const uint32_t *a) { (void)a; ReviveFBSinglePulseTimerI(x); } \
+    static inline void TCMD_ChangeFBS_##x(const uint32_t *a) ChangeFBSinglePulseSettingI(x,a[0]) \
+    static inline void TCMD_DirectionFBS_##x(const uint32_t *a) SetFBSinglePulseTimerDirection(x,(B1)a[0])
+#define SetFBSinglePulseTimerQ(q,x,per,direction,ok) TCMD_Push_(q,TCMD_SetFBS_##x,per,direction,0u,0u,ok)
+#define StopFBSinglePulseTimerQ(q,x,ok) TCMD_Push_(q,TCMD_StopFBS_##x,0u,0u,0u,0u,ok)
+#define ReviveFBSinglePulseTimerQ(q,x,ok) TCMD_Push_(q,TCMD_ReviveFBS_##x,0u,0u,0u,0u,ok)
+#define ChangeFBSinglePulseSettingQ(q,x,per,ok) TCMD_Push_(q,TCMD_ChangeFBS_##x,per,0u,0u,0u,ok)
+#define SetFBSinglePulseTimerDirectionQ(q,x,d,ok) TCMD_Push_(q,TCMD_DirectionFBS_##x,d,0u,0u,0u,ok)
+
+// FBV SINGLE PULSE TIMER
+#define DEFINE_FBVSINGLE_PULSE_TIMER_COMMANDS(x) \
+    static inline void TCMD_SetFBVS_##x(const uint32_t *a) SetFBVSinglePulseTimerI(x,a[0],a[1],a[2],(B1)a[3]) \
+    static inline void TCMD_StopFBVS_##x(const uint32_t *a) { (void)a; StopFBVSinglePulseTimerI(x); } \
+    static inline void TCMD_ReviveFBVS_##x(const uint32_t *a) { (void)a; ReviveFBVSinglePulseTimerI(x); } \
+    static inline void TCMD_ChangeFBVS_##x(const uint32_t *a) ChangeFBVSinglePulseTimerSettingI(x,a[0]) \
+    static inline void TCMD_DirectionFBVS_##x(const uint32_t *a) SetFBVSinglePulseTimerDirection(x,(B1)a[0]) \
+    static inline void TCMD_StepFFBVS_##x(const uint32_t *a) SetFBVSinglePulseTimerStepFI(x,a[0]) \
+    static inline void TCMD_StepBFBVS_##x(const uint32_t *a) SetFBVSinglePulseTimerStepBI(x,a[0])
+#define SetFBVSinglePulseTimerQ(q,x,per,stepF,stepB,direction,ok) TCMD_Push_(q,TCMD_SetFBVS_##x,per,stepF,stepB,direction,ok)
+#define StopFBVSinglePulseTimerQ(q,x,ok) TCMD_Push_(q,TCMD_StopFBVS_##x,0u,0u,0u,0u,ok)
+#define ReviveFBVSinglePulseTimerQ(q,x,ok) TCMD_Push_(q,TCMD_ReviveFBVS_##x,0u,0u,0u,0u,ok)
+#define ChangeFBVSinglePulseTimerSettingQ(q,x,per,ok) TCMD_Push_(q,TCMD_ChangeFBVS_##x,per,0u,0u,0u,ok)
+#define SetFBVSinglePulseTimerDirectionQ(q,x,d,ok) TCMD_Push_(q,TCMD_DirectionFBVS_##x,d,0u,0u,0u,ok)
+#define SetFBVSinglePulseTimerStepFQ(q,x,stepF,ok) TCMD_Push_(q,TCMD_StepFFBVS_##x,stepF,0u,0u,0u,ok)
+#define SetFBVSinglePulseTimerStepBQ(q,x,stepB,ok) TCMD_Push_(q,TCMD_StepBFBVS_##x,stepB,0u,0u,0u,ok)
+
+// ASYMMETRIC CONTINUOUS TIMER
+#define DEFINE_ASYMMETRIC_CONTINUOUS_TIMER_COMMANDS(x) \
+    static inline void TCMD_SetACT_##x(const uint32_t *a) SetAsymmetricContinuousTimerI(x,a[0],a[1]) \
+    static inline void TCMD_StopACT_##x(const uint32_t *a) { (void)a; StopAsymmetricContinuousTimerI(x); } \
+    static inline void TCMD_SuspendACT_##x(const uint32_t *a) { (void)a; SuspendAsymmetricContinuousTimerI(x); } \
+    static inline void TCMD_ResumeACT_##x(const uint32_t *a) { (void)a; ResumeAsymmetricContinuousTimerI(x); } \
+    static inline void TCMD_ChangeACT_##x(const uint32_t *a) ChangeAsymmetricContinuousTimerSettingI(x,a[0],a[1]) \
+    static inline void TCMD_StateACT_##x(const uint32_t *a) ChangeAsymmetricContinuousTimerStateI(x,a[0],a[1],(U1)a[2])
+#define SetAsymmetricContinuousTimerQ(q,x,perh,perl,ok) TCMD_Push_(q,TCMD_SetACT_##x,perh,perl,0u,0u,ok)
+#define StopAsymmetricContinuousTimerQ(q,x,ok) TCMD_Push_(q,TCMD_StopACT_##x,0u,0u,0u,0u,ok)
+#define SuspendAsymmetricContinuousTimerQ(q,x,ok) TCMD_Push_(q,TCMD_SuspendACT_##x,0u,0u,0u,0u,ok)
+#define ResumeAsymmetricContinuousTimerQ(q,x,ok) TCMD_Push_(q,TCMD_ResumeACT_##x,0u,0u,0u,0u,ok)
+#define ChangeAsymmetricContinuousTimerSettingQ(q,x,perh,perl,ok) TCMD_Push_(q,TCMD_ChangeACT_##x,perh,perl,0u,0u,ok)
+#define ChangeAsymmetricContinuousTimerStateQ(q,x,perh,perl,state,ok) TCMD_Push_(q,TCMD_StateACT_##x,perh,perl,state,0u,ok)
+
+// ASYMMETRIC SINGLE PULSE TIMER
+#define DEFINE_ASYMMETRIC_SINGLE_PULSE_TIMER_COMMANDS(x) \
+    static inline void TCMD_SetASP_##x(const uint32_t *a) SetAsymmetricSinglePulseTimerI(x,a[0],a[1],(U1)a[2]) \
+    static inline void TCMD_StopASP_##x(const uint32_t *a) { (void)a; StopAsymmetricSinglePulseTimerI(x); }
+#define SetAsymmetricSinglePulseTimerQ(q,x,first,second,istate,ok) TCMD_Push_(q,TCMD_SetASP_##x,first,second,istate,0u,ok)
+#define StopAsymmetricSinglePulseTimerQ(q,x,ok) TCMD_Push_(q,TCMD_StopASP_##x,0u,0u,0u,0u,ok)
+
+// BURST GENERATOR
+#define DEFINE_BURST_GENERATOR_COMMANDS(x) \
+    static inline void TCMD_SetBG_##x(const uint32_t *a) SetBurstGeneratorI(x,a[0],a[1],a[2],a[3]) \
+    static inline void TCMD_StopBG_##x(const uint32_t *a) { (void)a; StopBurstGeneratorI(x); }
+#define SetBurstGeneratorQ(q,x,pulses,ht,lt,it,ok) TCMD_Push_(q,TCMD_SetBG_##x,pulses,ht,lt,it,ok)
+#define StopBurstGeneratorQ(q,x,ok) TCMD_Push_(q,TCMD_StopBG_##x,0u,0u,0u,0u,ok)
+
+// BURST GENERATOR WITH OUTPUT
+#define DEFINE_BURST_GENERATOR_WITH_OUTPUT_COMMANDS(x,out) \
+    static inline void TCMD_SetBGO_##x(const uint32_t *a) SetBurstGeneratorIWithOutput(x,a[0],a[1],a[2],a[3],out) \
+    static inline void TCMD_StopBGO_##x(const uint32_t *a) { (void)a; StopBurstGeneratorIWithOutput(x,out); }
+#define SetBurstGeneratorWithOutputQ(q,x,pulses,ht,lt,it,ok) TCMD_Push_(q,TCMD_SetBGO_##x,pulses,ht,lt,it,ok)
+#define StopBurstGeneratorWithOutputQ(q,x,ok) TCMD_Push_(q,TCMD_StopBGO_##x,0u,0u,0u,0u,ok)
+
+#endif  // !defined(timecmd_h_included)
+
+// End of timecmd.h
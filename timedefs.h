@@ -17,6 +17,44 @@
 #if !defined(timedefs_h_included)
 #define timedefs_h_included
 
+// STORAGE LAYOUT
+// By default the variables of a timer are defined next to each other. On a
+// multi-core host, where the tick runs in its own thread, TIMER_LAYOUT_SPLIT
+// places them by writer in three linker sections, each starting on its own
+// cache line (GCC, ELF):
+//   timer_tick   - written on every tick: counters, states
+//   timer_event  - Expired/Tick flags: set by the tick, cleared by the consumer
+//   timer_config - written by the application: settings, steps, directions,
+//                  running flags (the tick clears the flag of a single pulse
+//                  timer once, at its expiration)
+// so that arming and clearing in the application threads do not invalidate the
+// lines the tick thread is writing. DEFINE_TIMER_LAYOUT is put once in a C file.
+// Timers defined inside a function (local variables) cannot be placed in
+// sections; DEFINE_LOCAL_TIMER defines them without the prefixes, for every
+// kind of DEFINE_<kind>:
+//   DEFINE_LOCAL_TIMER(FBVSINGLE_PULSE_TIMER,M,uint32_t)
+#if defined(TIMER_LAYOUT_SPLIT)
+#if !defined(TIMER_CACHE_LINE)
+#define TIMER_CACHE_LINE    (64u)
+#endif  // !defined(TIMER_CACHE_LINE)
+#define TIMER_TICK_DATA     __attribute__((section("timer_tick")))
+#define TIMER_EVENT_DATA    __attribute__((section("timer_event")))
+#define TIMER_CONFIG_DATA   __attribute__((section("timer_config")))
+// aligns the sections; the last one is padded to the end of its line
+#define DEFINE_TIMER_LAYOUT TIMER_TICK_DATA __attribute__((aligned(TIMER_CACHE_LINE))) uint8_t TimerTickLine_; \
+    TIMER_EVENT_DATA __attribute__((aligned(TIMER_CACHE_LINE))) uint8_t TimerEventLine_; \
+    TIMER_CONFIG_DATA __attribute__((aligned(TIMER_CACHE_LINE))) uint8_t TimerConfigLine_; \
+    __attribute__((section("timer_end"),aligned(TIMER_CACHE_LINE))) uint8_t TimerEndLine_[TIMER_CACHE_LINE];
+#else   // defined(TIMER_LAYOUT_SPLIT)
+#define TIMER_TICK_DATA
+#define TIMER_EVENT_DATA
+#define TIMER_CONFIG_DATA
+#define DEFINE_TIMER_LAYOUT
+#endif  // defined(TIMER_LAYOUT_SPLIT)
+// every DEFINE_<kind>(...) is DEFINE_<kind>_(tick,event,config,...) with the
+// three prefixes
+#define DEFINE_LOCAL_TIMER(kind,...) DEFINE_##kind##_(,,,__VA_ARGS__)
+
 // SINGLE PULSE TIMER
 // variables
 #define SinglePulseTimerCounter(x) ST_Counter_##x
@@ -27,9 +65,10 @@
     extern B1 ST_Expired_##x; \
     extern ttype ST_Counter_##x;
 // variables definition in a C file
-#define DEFINE_SINGLE_PULSE_TIMER(x,ttype) B1 ST_Flag_##x; \
-    B1 ST_Expired_##x; \
-    ttype ST_Counter_##x;
+#define DEFINE_SINGLE_PULSE_TIMER(x,ttype) DEFINE_SINGLE_PULSE_TIMER_(TIMER_TICK_DATA,TIMER_EVENT_DATA,TIMER_CONFIG_DATA,x,ttype)
+#define DEFINE_SINGLE_PULSE_TIMER_(tdata,edata,cdata,x,ttype) cdata B1 ST_Flag_##x; \
+    edata B1 ST_Expired_##x; \
+    tdata ttype ST_Counter_##x;
 
 // start when interrupts are enabled
 #define SetSinglePulseTimer(x,per) { \
@@ -52,6 +91,11 @@
     ST_Expired_##x = false; \
     EnableInterrupts(); \
 }
+// stop when interrupts are disabled
+#define StopSinglePulseTimerI(x) { \
+    ST_Flag_##x = false; \
+    ST_Expired_##x = false; \
+}
 // timer reset when interrupts are disabled
 #define ResetSinglePulseTimer(x) { \
     ST_Flag_##x = false; \
@@ -69,12 +113,20 @@
     ST_Flag_##x = false; \
     EnableInterrupts(); \
 }
+// suspend when interrupts are disabled
+#define SuspendSinglePulseTimerI(x) { \
+    ST_Flag_##x = false; \
+}
 // resume timer
 #define ResumeSinglePulseTimer(x) { \
     DisableInterrupts(); \
     ST_Flag_##x = true; \
     EnableInterrupts(); \
 }
+// resume when interrupts are disabled
+#define ResumeSinglePulseTimerI(x) { \
+    ST_Flag_##x = true; \
+}
 // tick
 #define TickSinglePulseTimer(x) { \
     if (ST_Flag_##x == true) { \
@@ -84,6 +136,26 @@
         } \
     } \
 }
+// advance by n ticks at once when interrupts are disabled (catch-up)
+// same result as n successive TickSinglePulseTimer(x); n is evaluated several times
+#define AdvanceSinglePulseTimer(x,n) { \
+    if ((ST_Flag_##x == true) && ((n) != 0u)) { \
+        ST_Counter_##x -= 1u; \
+        if (ST_Counter_##x < (n)) { \
+            ST_Counter_##x = 0u; \
+            ST_Flag_##x = false; \
+            ST_Expired_##x = true; \
+        } else { \
+            ST_Counter_##x -= (n) - 1u; \
+        } \
+    } \
+}
+// ticks to the next event; d receives the smaller of d and that number
+#define NextEventSinglePulseTimer(x,d) { \
+    if ((ST_Flag_##x == true) && (ST_Counter_##x < (d))) { \
+        d = ST_Counter_##x; \
+    } \
+}
 #define ClearSinglePulseTimerExpired(x) { \
     ST_Expired_##x = false; \
 }
@@ -98,10 +170,11 @@
     extern ttype CT_Setting_##x; \
     extern B1 CT_Flag_##x; \
     extern B1 CT_Tick_##x;
-#define DEFINE_CONTINUOUS_TIMER(x,ttype) ttype CT_Counter_##x; \
-    ttype CT_Setting_##x; \
-    B1 CT_Flag_##x; \
-    B1 CT_Tick_##x;
+#define DEFINE_CONTINUOUS_TIMER(x,ttype) DEFINE_CONTINUOUS_TIMER_(TIMER_TICK_DATA,TIMER_EVENT_DATA,TIMER_CONFIG_DATA,x,ttype)
+#define DEFINE_CONTINUOUS_TIMER_(tdata,edata,cdata,x,ttype) tdata ttype CT_Counter_##x; \
+    cdata ttype CT_Setting_##x; \
+    cdata B1 CT_Flag_##x; \
+    edata B1 CT_Tick_##x;
 
 // start when interrupts are enabled
 #define SetContinuousTimer(x,per) { \
@@ -126,6 +199,11 @@
     CT_Tick_##x = false; \
     EnableInterrupts(); \
 }
+// stop when interrupts are disabled
+#define StopContinuousTimerI(x) { \
+    CT_Flag_##x = false; \
+    CT_Tick_##x = false; \
+}
 // timer reset when interrupts are disabled
 #define ResetContinuousTimer(x) { \
     CT_Flag_##x = false; \
@@ -141,15 +219,23 @@
 // pause (suspend)
 #define SuspendContinuousTimer(x) { \
     DisableInterrupts(); \
-    PT_Flag_##x = false; \
+    CT_Flag_##x = false; \
     EnableInterrupts(); \
 }
+// pause (suspend) when interrupts are disabled
+#define SuspendContinuousTimerI(x) { \
+    CT_Flag_##x = false; \
+}
 // resume
 #define ResumeContinuousTimer(x) { \
     DisableInterrupts(); \
     CT_Flag_##x = true; \
     EnableInterrupts(); \
 }
+// resume when interrupts are disabled
+#define ResumeContinuousTimerI(x) { \
+    CT_Flag_##x = true; \
+}
 // tick
 #define TickContinuousTimer(x) { \
     if (CT_Flag_##x == true) { \
@@ -159,6 +245,25 @@
         } \
     } \
 }
+// advance by n ticks at once when interrupts are disabled (catch-up)
+// same result as n successive TickContinuousTimer(x) for a non-zero setting
+#define AdvanceContinuousTimer(x,n) { \
+    if ((CT_Flag_##x == true) && ((n) != 0u)) { \
+        CT_Counter_##x -= 1u; \
+        if (CT_Counter_##x < (n)) { \
+            CT_Counter_##x = CT_Setting_##x - (((n) - 1u - CT_Counter_##x) % CT_Setting_##x); \
+            CT_Tick_##x = true; \
+        } else { \
+            CT_Counter_##x -= (n) - 1u; \
+        } \
+    } \
+}
+// ticks to the next event; d receives the smaller of d and that number
+#define NextEventContinuousTimer(x,d) { \
+    if ((CT_Flag_##x == true) && (CT_Counter_##x < (d))) { \
+        d = CT_Counter_##x; \
+    } \
+}
 #define ClearContinuousTimerTick(x) { \
     CT_Tick_##x = false; \
 }
@@ -171,9 +276,10 @@
 #define EXTERN_CONST_CONTINUOUS_TIMER(x,ttype) extern ttype CCT_Counter_##x; \
     extern B1 CCT_Flag_##x; \
     extern B1 CCT_Tick_##x;
-#define DEFINE_CONST_CONTINUOUS_TIMER(x,ttype) ttype CCT_Counter_##x; \
-    B1 CCT_Flag_##x; \
-    B1 CCT_Tick_##x;
+#define DEFINE_CONST_CONTINUOUS_TIMER(x,ttype) DEFINE_CONST_CONTINUOUS_TIMER_(TIMER_TICK_DATA,TIMER_EVENT_DATA,TIMER_CONFIG_DATA,x,ttype)
+#define DEFINE_CONST_CONTINUOUS_TIMER_(tdata,edata,cdata,x,ttype) tdata ttype CCT_Counter_##x; \
+    cdata B1 CCT_Flag_##x; \
+    edata B1 CCT_Tick_##x;
 
 // start when interrupts are enabled
 #define SetConstContinuousTimer(x,per) { \
@@ -196,6 +302,11 @@
     CCT_Tick_##x = false; \
     EnableInterrupts(); \
 }
+// stop when interrupts are disabled
+#define StopConstContinuousTimerI(x) { \
+    CCT_Flag_##x = false; \
+    CCT_Tick_##x = false; \
+}
 // timer reset when interrupts are disabled
 #define ResetConstContinuousTimer(x) { \
     CCT_Flag_##x = false; \
@@ -213,12 +324,20 @@
     CCT_Flag_##x = false; \
     EnableInterrupts(); \
 }
+// pause (suspend) when interrupts are disabled
+#define SuspendConstContinuousTimerI(x) { \
+    CCT_Flag_##x = false; \
+}
 // resume
 #define ResumeConstContinuousTimer(x) { \
     DisableInterrupts(); \
     CCT_Flag_##x = true; \
     EnableInterrupts(); \
 }
+// resume when interrupts are disabled
+#define ResumeConstContinuousTimerI(x) { \
+    CCT_Flag_##x = true; \
+}
 // tick
 #define TickConstContinuousTimer(x,per) { \
     if (CCT_Flag_##x == true) { \
@@ -228,6 +347,24 @@
         } \
     } \
 }
+// advance by n ticks at once when interrupts are disabled (catch-up)
+#define AdvanceConstContinuousTimer(x,per,n) { \
+    if ((CCT_Flag_##x == true) && ((n) != 0u)) { \
+        CCT_Counter_##x -= 1u; \
+        if (CCT_Counter_##x < (n)) { \
+            CCT_Counter_##x = (per) - (((n) - 1u - CCT_Counter_##x) % (per)); \
+            CCT_Tick_##x = true; \
+        } else { \
+            CCT_Counter_##x -= (n) - 1u; \
+        } \
+    } \
+}
+// ticks to the next event; d receives the smaller of d and that number
+#define NextEventConstContinuousTimer(x,d) { \
+    if ((CCT_Flag_##x == true) && (CCT_Counter_##x < (d))) { \
+        d = CCT_Counter_##x; \
+    } \
+}
 #define ClearConstContinuousTick(x) { \
     CCT_Tick_##x = false; \
 }
@@ -238,8 +375,9 @@
 #define ConstFreeContinuousTimerTick(x) CFCT_Tick_##x
 #define EXTERN_CONST_FREE_CONTINUOUS_TIMER(x,ttype) extern ttype CFCT_Counter_##x; \
     extern B1 CFCT_Tick_##x;
-#define DEFINE_CONST_FREE_CONTINUOUS_TIMER(x,ttype) ttype CFCT_Counter_##x; \
-    B1 CFCT_Tick_##x;
+#define DEFINE_CONST_FREE_CONTINUOUS_TIMER(x,ttype) DEFINE_CONST_FREE_CONTINUOUS_TIMER_(TIMER_TICK_DATA,TIMER_EVENT_DATA,TIMER_CONFIG_DATA,x,ttype)
+#define DEFINE_CONST_FREE_CONTINUOUS_TIMER_(tdata,edata,cdata,x,ttype) tdata ttype CFCT_Counter_##x; \
+    edata B1 CFCT_Tick_##x;
 
 // start when interrupts are enabled
 #define SetConstFreeContinuousTimer(x,per) { \
@@ -270,10 +408,135 @@
         CFCT_Tick_##x = true; \
     } \
 }
+// advance by n ticks at once when interrupts are disabled (catch-up)
+#define AdvanceConstFreeContinuousTimer(x,per,n) { \
+    if ((n) != 0u) { \
+        CFCT_Counter_##x -= 1u; \
+        if (CFCT_Counter_##x < (n)) { \
+            CFCT_Counter_##x = (per) - (((n) - 1u - CFCT_Counter_##x) % (per)); \
+            CFCT_Tick_##x = true; \
+        } else { \
+            CFCT_Counter_##x -= (n) - 1u; \
+        } \
+    } \
+}
+// ticks to the next event; d receives the smaller of d and that number
+#define NextEventConstFreeContinuousTimer(x,d) { \
+    if (CFCT_Counter_##x < (d)) { \
+        d = CFCT_Counter_##x; \
+    } \
+}
 #define ClearConstFreeContinuousTimerTick(x) { \
     CFCT_Tick_##x = false; \
 }
 
+// TIMER_GROUP
+// Const continuous timers with the same period and phase sharing one counter.
+// The members are bits of a mask type (uint8_t .. uint32_t) chosen by the
+// application, e.g. #define TG_LED (0x01u). On the group tick the Tick flags of
+// all running members are set with one write of the Ticks mask, so a tick costs
+// one decrement per group instead of one per timer. The counter runs while the
+// group is set, whether members run or not: a member joins in the phase of the
+// group. A member that is always in Members is a CONST_FREE_CONTINUOUS_TIMER.
+// variables
+#define TimerGroupCounter(x) TG_Counter_##x
+#define TimerGroupMembers(x) TG_Members_##x
+#define TimerGroupTicks(x) TG_Ticks_##x
+#define TimerGroupTick(x,m) ((TG_Ticks_##x & (m)) != 0u)
+// declaration in a header file
+#define EXTERN_TIMER_GROUP(x,ttype,mtype) extern ttype TG_Counter_##x; \
+    extern mtype TG_Members_##x; \
+    extern mtype TG_Ticks_##x;
+// definition in a C file
+#define DEFINE_TIMER_GROUP(x,ttype,mtype) DEFINE_TIMER_GROUP_(TIMER_TICK_DATA,TIMER_EVENT_DATA,TIMER_CONFIG_DATA,x,ttype,mtype)
+#define DEFINE_TIMER_GROUP_(tdata,edata,cdata,x,ttype,mtype) tdata ttype TG_Counter_##x; \
+    cdata mtype TG_Members_##x; \
+    edata mtype TG_Ticks_##x;
+
+// start of the group period with the members m running when interrupts are enabled
+#define SetTimerGroup(x,per,m) { \
+    DisableInterrupts(); \
+    TG_Counter_##x = (per); \
+    TG_Members_##x = (m); \
+    TG_Ticks_##x = 0u; \
+    EnableInterrupts(); \
+}
+// start of the group period when interrupts are disabled
+#define SetTimerGroupI(x,per,m) { \
+    TG_Counter_##x = (per); \
+    TG_Members_##x = (m); \
+    TG_Ticks_##x = 0u; \
+}
+// timer reset when interrupts are disabled
+#define ResetTimerGroup(x) { \
+    TG_Members_##x = 0u; \
+    TG_Ticks_##x = 0u; \
+}
+// clear timer
+#define ClearTimerGroup(x) { \
+    TG_Members_##x = 0u; \
+    TG_Ticks_##x = 0u; \
+    TG_Counter_##x = 0u; \
+}
+// members m start running (resume)
+#define JoinTimerGroup(x,m) { \
+    DisableInterrupts(); \
+    TG_Members_##x |= (m); \
+    EnableInterrupts(); \
+}
+// members m start running when interrupts are disabled
+#define JoinTimerGroupI(x,m) { \
+    TG_Members_##x |= (m); \
+}
+// members m stop running (suspend); their pending ticks are dropped
+// the complement is taken of v & m, at the width of mtype also for a narrower m
+#define LeaveTimerGroup(x,m) { \
+    DisableInterrupts(); \
+    TG_Members_##x &= ~(TG_Members_##x & (m)); \
+    TG_Ticks_##x &= ~(TG_Ticks_##x & (m)); \
+    EnableInterrupts(); \
+}
+// members m stop running when interrupts are disabled
+#define LeaveTimerGroupI(x,m) { \
+    TG_Members_##x &= ~(TG_Members_##x & (m)); \
+    TG_Ticks_##x &= ~(TG_Ticks_##x & (m)); \
+}
+// tick
+#define TickTimerGroup(x,per) { \
+    if (--TG_Counter_##x == 0u) { \
+        TG_Counter_##x = (per); \
+        TG_Ticks_##x |= TG_Members_##x; \
+    } \
+}
+// advance by n ticks at once when interrupts are disabled (catch-up)
+#define AdvanceTimerGroup(x,per,n) { \
+    if ((n) != 0u) { \
+        TG_Counter_##x -= 1u; \
+        if (TG_Counter_##x < (n)) { \
+            TG_Counter_##x = (per) - (((n) - 1u - TG_Counter_##x) % (per)); \
+            TG_Ticks_##x |= TG_Members_##x; \
+        } else { \
+            TG_Counter_##x -= (n) - 1u; \
+        } \
+    } \
+}
+// ticks to the next event; d receives the smaller of d and that number
+#define NextEventTimerGroup(x,d) { \
+    if ((TG_Members_##x != 0u) && (TG_Counter_##x < (d))) { \
+        d = TG_Counter_##x; \
+    } \
+}
+// clear of the tick flags m; the tick writes the same mask
+#define ClearTimerGroupTick(x,m) { \
+    DisableInterrupts(); \
+    TG_Ticks_##x &= ~(TG_Ticks_##x & (m)); \
+    EnableInterrupts(); \
+}
+// clear when interrupts are disabled
+#define ClearTimerGroupTickI(x,m) { \
+    TG_Ticks_##x &= ~(TG_Ticks_##x & (m)); \
+}
+
 // forward/backward single pulse timers
 
 #define FBS_FORWARD (true)
@@ -293,11 +556,12 @@
     extern ttype FBS_Counter_##x; \
     extern ttype FBS_Setting_##x;
 // variables definition in C file
-#define DEFINE_FBSINGLE_PULSE_TIMER(x,ttype) B1 FBS_Flag_##x; \
-    B1 FBS_Expired_##x; \
-    B1 FBS_Direction_##x; \
-    ttype FBS_Counter_##x; \
-    ttype FBS_Setting_##x;
+#define DEFINE_FBSINGLE_PULSE_TIMER(x,ttype) DEFINE_FBSINGLE_PULSE_TIMER_(TIMER_TICK_DATA,TIMER_EVENT_DATA,TIMER_CONFIG_DATA,x,ttype)
+#define DEFINE_FBSINGLE_PULSE_TIMER_(tdata,edata,cdata,x,ttype) cdata B1 FBS_Flag_##x; \
+    edata B1 FBS_Expired_##x; \
+    cdata B1 FBS_Direction_##x; \
+    tdata ttype FBS_Counter_##x; \
+    cdata ttype FBS_Setting_##x;
 
 // start when interrupts are enabled
 #define SetFBSinglePulseTimer(x,per,direction) { \
@@ -332,12 +596,52 @@
         } \
     } \
 }
+// advance by n ticks at once when interrupts are disabled (catch-up)
+// same result as n successive TickFBSinglePulseTimer(x)
+#define AdvanceFBSinglePulseTimer(x,n) { \
+    if ((FBS_Flag_##x == true) && ((n) != 0u)) { \
+        if (FBS_Direction_##x == FBS_FORWARD) { \
+            if (FBS_Counter_##x >= FBS_Setting_##x) { \
+                FBS_Counter_##x++; \
+                FBS_Flag_##x = false; \
+                FBS_Expired_##x = true; \
+            } else if ((n) >= (uint32_t)FBS_Setting_##x - FBS_Counter_##x) { \
+                FBS_Counter_##x = FBS_Setting_##x; \
+                FBS_Flag_##x = false; \
+                FBS_Expired_##x = true; \
+            } else { \
+                FBS_Counter_##x += (n); \
+            } \
+        } else { \
+            if (FBS_Counter_##x > (n)) { \
+                FBS_Counter_##x -= (n); \
+            } else { \
+                FBS_Counter_##x = 0u; \
+            } \
+        } \
+    } \
+}
+// ticks to the expiration (forward direction only); d receives the smaller of d and that number
+#define NextEventFBSinglePulseTimer(x,d) { \
+    if ((FBS_Flag_##x == true) && (FBS_Direction_##x == FBS_FORWARD)) { \
+        if (FBS_Counter_##x >= FBS_Setting_##x) { \
+            d = 1u; \
+        } else if ((uint32_t)FBS_Setting_##x - FBS_Counter_##x < (d)) { \
+            d = FBS_Setting_##x - FBS_Counter_##x; \
+        } \
+    } \
+}
 #define StopFBSinglePulseTimer(x) { \
     DisableInterrupts(); \
     FBS_Flag_##x = false; \
     FBS_Expired_##x = false; \
     EnableInterrupts(); \
 }
+// stop when interrupts are disabled
+#define StopFBSinglePulseTimerI(x) { \
+    FBS_Flag_##x = false; \
+    FBS_Expired_##x = false; \
+}
 // timer reset when interrupts are disabled
 #define ResetFBSinglePulseTimer(x) { \
     FBS_Flag_##x = false; \
@@ -361,6 +665,12 @@
     FBS_Direction_##x = FBS_BACKWARD; \
     EnableInterrupts(); \
 }
+// revive when interrupts are disabled
+#define ReviveFBSinglePulseTimerI(x) { \
+    FBS_Expired_##x = false; \
+    FBS_Flag_##x = true; \
+    FBS_Direction_##x = FBS_BACKWARD; \
+}
 #define ChangeFBSinglePulseSetting(x,per) { \
     DisableInterrupts(); \
     FBS_Setting_##x = (per); \
@@ -372,6 +682,16 @@
     } \
     EnableInterrupts(); \
 }
+// setting change when interrupts are disabled
+#define ChangeFBSinglePulseSettingI(x,per) { \
+    FBS_Setting_##x = (per); \
+    if (FBS_Direction_##x == FBS_FORWARD) { \
+        if (FBS_Counter_##x >= FBS_Setting_##x) { \
+            FBS_Flag_##x = false; \
+            FBS_Expired_##x = true; \
+        } \
+    } \
+}
 #define SetFBSinglePulseTimerDirection(x,d) { \
     FBS_Direction_##x = (d); \
 }
@@ -394,13 +714,14 @@
     extern ttype FBVS_StepF_##x; \
     extern ttype FBVS_StepB_##x;
 // variables definition in C file
-#define DEFINE_FBVSINGLE_PULSE_TIMER(x,ttype) B1 FBVET_Flag_##x; \
-    B1 FBVS_Expired_##x; \
-    B1 FBVS_Direction_##x; \
-    ttype FBVS_Counter_##x; \
-    ttype FBVS_Setting_##x; \
-    ttype FBVS_StepF_##x; \
-    ttype FBVS_StepB_##x;
+#define DEFINE_FBVSINGLE_PULSE_TIMER(x,ttype) DEFINE_FBVSINGLE_PULSE_TIMER_(TIMER_TICK_DATA,TIMER_EVENT_DATA,TIMER_CONFIG_DATA,x,ttype)
+#define DEFINE_FBVSINGLE_PULSE_TIMER_(tdata,edata,cdata,x,ttype) cdata B1 FBVS_Flag_##x; \
+    edata B1 FBVS_Expired_##x; \
+    cdata B1 FBVS_Direction_##x; \
+    tdata ttype FBVS_Counter_##x; \
+    cdata ttype FBVS_Setting_##x; \
+    cdata ttype FBVS_StepF_##x; \
+    cdata ttype FBVS_StepB_##x;
 
 // start when interrupts are enabled
 // per+step should be in ttype domain
@@ -443,12 +764,57 @@
         } \
     } \
 }
+// advance by n ticks at once when interrupts are disabled (catch-up)
+// same result as n successive TickFBVSinglePulseTimer(x) while per+step stays in ttype domain
+#define AdvanceFBVSinglePulseTimer(x,n) { \
+    if ((FBVS_Flag_##x == true) && ((n) != 0u)) { \
+        if (FBVS_Direction_##x == FBS_FORWARD) { \
+            if (FBVS_Counter_##x >= FBVS_Setting_##x) { \
+                FBVS_Counter_##x += FBVS_StepF_##x; \
+                FBVS_Flag_##x = false; \
+                FBVS_Expired_##x = true; \
+            } else if (FBVS_StepF_##x != 0u) { \
+                if ((n) > ((FBVS_Setting_##x - FBVS_Counter_##x - 1u) / FBVS_StepF_##x)) { \
+                    FBVS_Counter_##x += ((FBVS_Setting_##x - FBVS_Counter_##x - 1u) / FBVS_StepF_##x + 1u) * FBVS_StepF_##x; \
+                    FBVS_Flag_##x = false; \
+                    FBVS_Expired_##x = true; \
+                } else { \
+                    FBVS_Counter_##x += (n) * FBVS_StepF_##x; \
+                } \
+            } \
+        } else { \
+            if (FBVS_StepB_##x != 0u) { \
+                if ((FBVS_Counter_##x != 0u) && (((FBVS_Counter_##x - 1u) / FBVS_StepB_##x) >= (n))) { \
+                    FBVS_Counter_##x -= (n) * FBVS_StepB_##x; \
+                } else { \
+                    FBVS_Counter_##x = 0u; \
+                } \
+            } \
+        } \
+    } \
+}
+// ticks to the expiration (forward direction only); d receives the smaller of d and that number
+#define NextEventFBVSinglePulseTimer(x,d) { \
+    if ((FBVS_Flag_##x == true) && (FBVS_Direction_##x == FBS_FORWARD)) { \
+        if (FBVS_Counter_##x >= FBVS_Setting_##x) { \
+            d = 1u; \
+        } else if ((FBVS_StepF_##x != 0u) && \
+            ((FBVS_Setting_##x - FBVS_Counter_##x - 1u) / FBVS_StepF_##x + 1u < (d))) { \
+            d = (FBVS_Setting_##x - FBVS_Counter_##x - 1u) / FBVS_StepF_##x + 1u; \
+        } \
+    } \
+}
 #define StopFBVSinglePulseTimer(x) { \
     DisableInterrupts(); \
     FBVS_Flag_##x = false; \
     FBVS_Expired_##x = false; \
     EnableInterrupts(); \
 }
+// stop when interrupts are disabled
+#define StopFBVSinglePulseTimerI(x) { \
+    FBVS_Flag_##x = false; \
+    FBVS_Expired_##x = false; \
+}
 // timer reset when interrupts are disabled
 #define ResetFBVSinglePulseTimer(x) { \
     FBVS_Flag_##x = false; \
@@ -477,6 +843,12 @@
     FBVS_Direction_##x = FBS_BACKWARD; \
     EnableInterrupts(); \
 }
+// revive when interrupts are disabled
+#define ReviveFBVSinglePulseTimerI(x) { \
+    FBVS_Expired_##x = false; \
+    FBVS_Flag_##x = true; \
+    FBVS_Direction_##x = FBS_BACKWARD; \
+}
 #define ChangeFBVSinglePulseTimerSetting(x,per) { \
     DisableInterrupts(); \
     FBVS_Setting_##x = (per); \
@@ -488,16 +860,135 @@
     } \
     EnableInterrupts(); \
 }
+// setting change when interrupts are disabled
+#define ChangeFBVSinglePulseTimerSettingI(x,per) { \
+    FBVS_Setting_##x = (per); \
+    if (FBVS_Direction_##x == FBS_FORWARD) { \
+        if (FBVS_Counter_##x >= FBVS_Setting_##x) { \
+            FBVS_Flag_##x = false; \
+            FBVS_Expired_##x = true; \
+        } \
+    } \
+}
 #define SetFBVSinglePulseTimerStepF(x,stepF) { \
     DisableInterrupts(); \
     FBVS_StepF_##x = (stepF); \
     EnableInterrupts(); \
 }
+// forward step change when interrupts are disabled
+#define SetFBVSinglePulseTimerStepFI(x,stepF) { \
+    FBVS_StepF_##x = (stepF); \
+}
 #define SetFBVSinglePulseTimerStepB(x,stepB) { \
     DisableInterrupts(); \
     FBVS_StepB_##x = (stepB); \
     EnableInterrupts(); \
 }
+// backward step change when interrupts are disabled
+#define SetFBVSinglePulseTimerStepBI(x,stepB) { \
+    FBVS_StepB_##x = (stepB); \
+}
+
+// LAZY_FBV_SINGLE_PULSE_TIMER
+// FBV_SINGLE_PULSE_TIMER that is not ticked. Between two changes of direction,
+// steps or setting the counter moves linearly and stops at 0 or at the
+// expiration, so only the tick of the last change (Base) is kept and the counter
+// is computed when it is needed: every Lazy* macro first brings the timer to the
+// tick now with AdvanceFBVSinglePulseTimer and then does its work. The timer
+// costs nothing per tick; the expiration tick is known in advance and a
+// deadline scheduler (timeadapt.h, timefd.h, a wheel) arms it with
+// NextEventLazyFBVSinglePulseTimer or LazyFBVSinglePulseTimerDeadline and calls
+// UpdateLazyFBVSinglePulseTimer when it comes. A FB_SINGLE_PULSE_TIMER is the
+// case stepF = stepB = 1 (SetLazyFBSinglePulseTimer).
+//
+//  DEFINE_LAZY_FBVSINGLE_PULSE_TIMER(Heat,uint16_t)
+//  SetLazyFBVSinglePulseTimer(Heat,now,900u,3u,1u,FBS_FORWARD);
+//  SetLazyFBVSinglePulseTimerDirection(Heat,now,FBS_BACKWARD);
+//  UpdateLazyFBVSinglePulseTimer(Heat,now);
+//  if (FBVSinglePulseTimerExpired(Heat) == true) { ... }
+//
+// now is a tick counter of the application of type TIMER_LAZY_STAMP, read once
+// by the caller. The fields are those of the FBV_SINGLE_PULSE_TIMER, so its
+// variable macros, Stop*I, Reset* and Clear*Expired apply; its Tick, Advance
+// and the macros that disable the interrupts do not: the tick does not touch
+// the timer, so it is used by the application only, without interrupt locks. An
+// armed timer has to be updated at least once in TIMER_LAZY_GAP ticks, which
+// NextEventLazyFBVSinglePulseTimer takes care of.
+#if !defined(TIMER_LAZY_STAMP)
+#define TIMER_LAZY_STAMP    uint16_t    // type of the tick stamps
+#define TIMER_LAZY_GAP      (0x7FFFu)   // longest time between the updates of an armed timer
+#endif  // !defined(TIMER_LAZY_STAMP)
+// variables
+#define LazyFBVSinglePulseTimerBase(x) FBVS_Base_##x
+// declaration in a header file
+#define EXTERN_LAZY_FBVSINGLE_PULSE_TIMER(x,ttype) EXTERN_FBVSINGLE_PULSE_TIMER(x,ttype) \
+    extern TIMER_LAZY_STAMP FBVS_Base_##x;
+// variables definition in C file
+#define DEFINE_LAZY_FBVSINGLE_PULSE_TIMER(x,ttype) DEFINE_LAZY_FBVSINGLE_PULSE_TIMER_(TIMER_TICK_DATA,TIMER_EVENT_DATA,TIMER_CONFIG_DATA,x,ttype)
+#define DEFINE_LAZY_FBVSINGLE_PULSE_TIMER_(tdata,edata,cdata,x,ttype) DEFINE_FBVSINGLE_PULSE_TIMER_(tdata,edata,cdata,x,ttype) \
+    cdata TIMER_LAZY_STAMP FBVS_Base_##x;
+
+// the counter and the flags at tick now
+#define UpdateLazyFBVSinglePulseTimer(x,now) { \
+    TIMER_LAZY_STAMP n_ = (TIMER_LAZY_STAMP)((now) - FBVS_Base_##x); \
+    FBVS_Base_##x = (now); \
+    AdvanceFBVSinglePulseTimer(x,n_); \
+}
+// start
+#define SetLazyFBVSinglePulseTimer(x,now,per,stepF,stepB,direction) { \
+    SetFBVSinglePulseTimerI(x,per,stepF,stepB,direction); \
+    FBVS_Base_##x = (now); \
+}
+// start with unit steps (FB_SINGLE_PULSE_TIMER)
+#define SetLazyFBSinglePulseTimer(x,now,per,direction) { \
+    SetFBVSinglePulseTimerI(x,per,1u,1u,direction); \
+    FBVS_Base_##x = (now); \
+}
+#define SetLazyFBVSinglePulseTimerDirection(x,now,d) { \
+    UpdateLazyFBVSinglePulseTimer(x,now); \
+    FBVS_Direction_##x = (d); \
+}
+#define ReviveLazyFBVSinglePulseTimer(x,now) { \
+    UpdateLazyFBVSinglePulseTimer(x,now); \
+    ReviveFBVSinglePulseTimerI(x); \
+}
+#define ChangeLazyFBVSinglePulseTimerSetting(x,now,per) { \
+    UpdateLazyFBVSinglePulseTimer(x,now); \
+    ChangeFBVSinglePulseTimerSettingI(x,per); \
+}
+#define SetLazyFBVSinglePulseTimerStepF(x,now,stepF) { \
+    UpdateLazyFBVSinglePulseTimer(x,now); \
+    FBVS_StepF_##x = (stepF); \
+}
+#define SetLazyFBVSinglePulseTimerStepB(x,now,stepB) { \
+    UpdateLazyFBVSinglePulseTimer(x,now); \
+    FBVS_StepB_##x = (stepB); \
+}
+// counter at tick now into c
+#define LazyFBVSinglePulseTimerCounter(x,now,c) { \
+    UpdateLazyFBVSinglePulseTimer(x,now); \
+    c = FBVS_Counter_##x; \
+}
+// ticks from now to the next event; d receives the smaller of d and that number;
+// an armed timer asks for an update at least every TIMER_LAZY_GAP ticks
+#define NextEventLazyFBVSinglePulseTimer(x,now,d) { \
+    UpdateLazyFBVSinglePulseTimer(x,now); \
+    NextEventFBVSinglePulseTimer(x,d); \
+    if ((FBVS_Flag_##x == true) && ((d) > TIMER_LAZY_GAP)) { \
+        d = TIMER_LAZY_GAP; \
+    } \
+}
+// tick of the expiration into t, when the timer runs forward (when it is farther
+// than TIMER_LAZY_GAP or never, the tick of the next update); t is not changed
+// otherwise
+#define LazyFBVSinglePulseTimerDeadline(x,now,t) { \
+    TIMER_LAZY_STAMP d_ = TIMER_LAZY_GAP; \
+    UpdateLazyFBVSinglePulseTimer(x,now); \
+    if ((FBVS_Flag_##x == true) && (FBVS_Direction_##x == FBS_FORWARD)) { \
+        NextEventFBVSinglePulseTimer(x,d_); \
+        t = (TIMER_LAZY_STAMP)((now) + d_); \
+    } \
+}
 
 // asymmetric continuous timers
 // generation of asymmetric sequences
@@ -523,12 +1014,13 @@
     extern B1 ACT_Flag_##x; \
     extern B1 ACT_State_##x; \
     extern B1 ACT_Tick_##x;
-#define DEFINE_ASYMMETRIC_CONTINUOUS_TIMER(x,ttype) ttype ACT_Counter_##x; \
-    ttype ACT_SettingHigh_##x; \
-    ttype ACT_SettingLow_##x; \
-    B1 ACT_Flag_##x; \
-    B1 ACT_State_##x; \
-    B1 ACT_Tick_##x;
+#define DEFINE_ASYMMETRIC_CONTINUOUS_TIMER(x,ttype) DEFINE_ASYMMETRIC_CONTINUOUS_TIMER_(TIMER_TICK_DATA,TIMER_EVENT_DATA,TIMER_CONFIG_DATA,x,ttype)
+#define DEFINE_ASYMMETRIC_CONTINUOUS_TIMER_(tdata,edata,cdata,x,ttype) tdata ttype ACT_Counter_##x; \
+    cdata ttype ACT_SettingHigh_##x; \
+    cdata ttype ACT_SettingLow_##x; \
+    cdata B1 ACT_Flag_##x; \
+    tdata B1 ACT_State_##x; \
+    edata B1 ACT_Tick_##x;
 
 // start when interrupts are enabled
 #define SetAsymmetricContinuousTimer(x,perh, perl) { \
@@ -557,6 +1049,11 @@
     ACT_Tick_##x = false; \
     EnableInterrupts(); \
 }
+// stop when interrupts are disabled
+#define StopAsymmetricContinuousTimerI(x) { \
+    ACT_Flag_##x = false; \
+    ACT_Tick_##x = false; \
+}
 // timer reset when interrupts are disabled
 #define ResetAsymmetricContinuousTimer(x) { \
     ACT_Flag_##x = false; \
@@ -574,21 +1071,34 @@
 // pause (suspend)
 #define SuspendAsymmetricContinuousTimer(x) { \
     DisableInterrupts(); \
-    PeriodTimerFlag_##x = false; \
+    ACT_Flag_##x = false; \
     EnableInterrupts(); \
 }
+// pause (suspend) when interrupts are disabled
+#define SuspendAsymmetricContinuousTimerI(x) { \
+    ACT_Flag_##x = false; \
+}
 // resume
 #define ResumeAsymmetricContinuousTimer(x) { \
     DisableInterrupts(); \
-    PeriodTimerFlag_##x = true; \
+    ACT_Flag_##x = true; \
     EnableInterrupts(); \
 }
+// resume when interrupts are disabled
+#define ResumeAsymmetricContinuousTimerI(x) { \
+    ACT_Flag_##x = true; \
+}
 #define ChangeAsymmetricContinuousTimerSetting(x,perh,perl) { \
     DisableInterrupts(); \
     ACT_SettingHigh_##x = (perh); \
     ACT_SettingLow_##x = (perl); \
     EnableInterrupts(); \
 }
+// settings change when interrupts are disabled
+#define ChangeAsymmetricContinuousTimerSettingI(x,perh,perl) { \
+    ACT_SettingHigh_##x = (perh); \
+    ACT_SettingLow_##x = (perl); \
+}
 #define ChangeAsymmetricContinuousTimerState(x,perh,perl,state) { \
     DisableInterrupts(); \
     ACT_State_##x = (state); \
@@ -596,6 +1106,12 @@
     ACT_SettingLow_##x = (perl); \
     EnableInterrupts(); \
 }
+// state and settings change when interrupts are disabled
+#define ChangeAsymmetricContinuousTimerStateI(x,perh,perl,state) { \
+    ACT_State_##x = (state); \
+    ACT_SettingHigh_##x = (perh); \
+    ACT_SettingLow_##x = (perl); \
+}
 // tick
 #define TickAsymmetricContinuousTimer(x) { \
     if (ACT_Flag_##x == true) { \
@@ -619,10 +1135,271 @@
         } \
     } \
 }
+// advance by n ticks at once when interrupts are disabled (catch-up)
+// every elapsed phase costs one TickAsymmetricContinuousTimer(x), whole periods
+// are skipped; the period is the sum of the settings, also when one of them is 0
+#define AdvanceAsymmetricContinuousTimer(x,n) { \
+    if (ACT_Flag_##x == true) { \
+        uint32_t m_ = (n); \
+        while ((ACT_Counter_##x != 0u) && (m_ >= ACT_Counter_##x)) { \
+            m_ -= ACT_Counter_##x; \
+            ACT_Counter_##x = 1u; \
+            TickAsymmetricContinuousTimer(x); \
+            if (((uint32_t)ACT_SettingHigh_##x + ACT_SettingLow_##x) != 0u) { \
+                m_ %= (uint32_t)ACT_SettingHigh_##x + ACT_SettingLow_##x; \
+            } \
+        } \
+        ACT_Counter_##x -= m_; \
+    } \
+}
+// ticks to the next event; d receives the smaller of d and that number
+#define NextEventAsymmetricContinuousTimer(x,d) { \
+    if ((ACT_Flag_##x == true) && (ACT_Counter_##x < (d))) { \
+        d = ACT_Counter_##x; \
+    } \
+}
 #define ClearAsymmetricContinuousTimerTick(x) { \
     ACT_Tick_##x = false; \
 }
 
+// RAMP_ASYMMETRIC_CONTINUOUS_TIMER
+// ASYMMETRIC_CONTINUOUS_TIMER whose settings change by themselves at the start
+// of every period (soft start, frequency or duty cycle sweeps):
+// - linear: from the start settings towards the end settings by the steps, the
+//   last step is clipped to the end
+// - profile: the high and low times of the periods are read from two tables of
+//   n entries (const tables may be in ROM)
+// After the last change the timer runs on with the final settings and sets
+// RampDone; Tick is set on every phase change like for the ACT timer. A period
+// starts when the high phase begins, or when the low phase is reloaded while the
+// high time is 0. The settings must not reach 0 for both phases. RampDone is
+// set at the start already when there is nothing to ramp (start equal to the
+// end, a profile of 1 period). A linear ramp with a step of 0 for a setting that
+// differs from its end, or a profile of 0 periods, does not start.
+// variables
+#define RampAsymmetricContinuousTimerCounter(x) RACT_Counter_##x
+#define RampAsymmetricContinuousTimerSettingHigh(x) RACT_SettingHigh_##x
+#define RampAsymmetricContinuousTimerSettingLow(x) RACT_SettingLow_##x
+#define RampAsymmetricContinuousTimerFlag(x) RACT_Flag_##x
+#define RampAsymmetricContinuousTimerState(x) RACT_State_##x
+#define RampAsymmetricContinuousTimerRamping(x) RACT_Ramping_##x
+#define RampAsymmetricContinuousTimerTick(x) RACT_Tick_##x
+#define RampAsymmetricContinuousTimerRampDone(x) RACT_RampDone_##x
+#define EXTERN_RAMP_ASYMMETRIC_CONTINUOUS_TIMER(x,ttype) extern ttype RACT_Counter_##x; \
+    extern ttype RACT_SettingHigh_##x; \
+    extern ttype RACT_SettingLow_##x; \
+    extern ttype RACT_EndHigh_##x; \
+    extern ttype RACT_EndLow_##x; \
+    extern ttype RACT_StepHigh_##x; \
+    extern ttype RACT_StepLow_##x; \
+    extern const ttype *RACT_ProfileHigh_##x; \
+    extern const ttype *RACT_ProfileLow_##x; \
+    extern uint8_t RACT_Index_##x; \
+    extern uint8_t RACT_Length_##x; \
+    extern B1 RACT_Flag_##x; \
+    extern B1 RACT_State_##x; \
+    extern B1 RACT_Ramping_##x; \
+    extern B1 RACT_Tick_##x; \
+    extern B1 RACT_RampDone_##x;
+#define DEFINE_RAMP_ASYMMETRIC_CONTINUOUS_TIMER(x,ttype) DEFINE_RAMP_ASYMMETRIC_CONTINUOUS_TIMER_(TIMER_TICK_DATA,TIMER_EVENT_DATA,TIMER_CONFIG_DATA,x,ttype)
+#define DEFINE_RAMP_ASYMMETRIC_CONTINUOUS_TIMER_(tdata,edata,cdata,x,ttype) tdata ttype RACT_Counter_##x; \
+    tdata ttype RACT_SettingHigh_##x; \
+    tdata ttype RACT_SettingLow_##x; \
+    cdata ttype RACT_EndHigh_##x; \
+    cdata ttype RACT_EndLow_##x; \
+    cdata ttype RACT_StepHigh_##x; \
+    cdata ttype RACT_StepLow_##x; \
+    cdata const ttype *RACT_ProfileHigh_##x; \
+    cdata const ttype *RACT_ProfileLow_##x; \
+    tdata uint8_t RACT_Index_##x; \
+    cdata uint8_t RACT_Length_##x; \
+    cdata B1 RACT_Flag_##x; \
+    tdata B1 RACT_State_##x; \
+    tdata B1 RACT_Ramping_##x; \
+    edata B1 RACT_Tick_##x; \
+    edata B1 RACT_RampDone_##x;
+
+// start of a linear ramp when interrupts are disabled
+#define SetRampAsymmetricContinuousTimerI(x,starth,startl,endh,endl,steph,stepl) { \
+    RACT_SettingHigh_##x = (starth); \
+    RACT_SettingLow_##x = (startl); \
+    RACT_EndHigh_##x = (endh); \
+    RACT_EndLow_##x = (endl); \
+    RACT_StepHigh_##x = (steph); \
+    RACT_StepLow_##x = (stepl); \
+    RACT_Length_##x = 0u; \
+    RACT_Ramping_##x = ((RACT_SettingHigh_##x != RACT_EndHigh_##x) || (RACT_SettingLow_##x != RACT_EndLow_##x)); \
+    RACT_Tick_##x = false; \
+    if (((RACT_StepHigh_##x == 0u) && (RACT_SettingHigh_##x != RACT_EndHigh_##x)) || \
+            ((RACT_StepLow_##x == 0u) && (RACT_SettingLow_##x != RACT_EndLow_##x))) { \
+        RACT_Ramping_##x = false; \
+        RACT_RampDone_##x = false; \
+        RACT_Flag_##x = false; \
+    } else { \
+        if (RACT_SettingHigh_##x != 0u) { \
+            RACT_State_##x = ACT_STATE_HIGH; \
+            RACT_Counter_##x = RACT_SettingHigh_##x; \
+        } else { \
+            RACT_State_##x = ACT_STATE_LOW; \
+            RACT_Counter_##x = RACT_SettingLow_##x; \
+        } \
+        RACT_RampDone_##x = (RACT_Ramping_##x == false); \
+        RACT_Flag_##x = true; \
+    } \
+}
+// start of a linear ramp when interrupts are enabled
+#define SetRampAsymmetricContinuousTimer(x,starth,startl,endh,endl,steph,stepl) { \
+    DisableInterrupts(); \
+    SetRampAsymmetricContinuousTimerI(x,starth,startl,endh,endl,steph,stepl); \
+    EnableInterrupts(); \
+}
+// start of a profile of n (1..255) periods when interrupts are disabled
+#define SetRampAsymmetricContinuousTimerProfileI(x,ph,pl,n) { \
+    RACT_Tick_##x = false; \
+    if ((n) != 0u) { \
+        RACT_ProfileHigh_##x = (ph); \
+        RACT_ProfileLow_##x = (pl); \
+        RACT_Length_##x = (n); \
+        RACT_Index_##x = 1u; \
+        RACT_SettingHigh_##x = (ph)[0]; \
+        RACT_SettingLow_##x = (pl)[0]; \
+        RACT_Ramping_##x = (RACT_Length_##x > 1u); \
+        if (RACT_SettingHigh_##x != 0u) { \
+            RACT_State_##x = ACT_STATE_HIGH; \
+            RACT_Counter_##x = RACT_SettingHigh_##x; \
+        } else { \
+            RACT_State_##x = ACT_STATE_LOW; \
+            RACT_Counter_##x = RACT_SettingLow_##x; \
+        } \
+        RACT_RampDone_##x = (RACT_Ramping_##x == false); \
+        RACT_Flag_##x = true; \
+    } else { \
+        RACT_Ramping_##x = false; \
+        RACT_RampDone_##x = false; \
+        RACT_Flag_##x = false; \
+    } \
+}
+// start of a profile when interrupts are enabled
+#define SetRampAsymmetricContinuousTimerProfile(x,ph,pl,n) { \
+    DisableInterrupts(); \
+    SetRampAsymmetricContinuousTimerProfileI(x,ph,pl,n); \
+    EnableInterrupts(); \
+}
+// stop when interrupts are enabled
+#define StopRampAsymmetricContinuousTimer(x) { \
+    DisableInterrupts(); \
+    RACT_Flag_##x = false; \
+    RACT_Tick_##x = false; \
+    EnableInterrupts(); \
+}
+// stop when interrupts are disabled
+#define StopRampAsymmetricContinuousTimerI(x) { \
+    RACT_Flag_##x = false; \
+    RACT_Tick_##x = false; \
+}
+// timer reset when interrupts are disabled
+#define ResetRampAsymmetricContinuousTimer(x) { \
+    RACT_Flag_##x = false; \
+    RACT_Ramping_##x = false; \
+    RACT_Tick_##x = false; \
+    RACT_RampDone_##x = false; \
+}
+// pause (suspend)
+#define SuspendRampAsymmetricContinuousTimer(x) { \
+    DisableInterrupts(); \
+    RACT_Flag_##x = false; \
+    EnableInterrupts(); \
+}
+// pause (suspend) when interrupts are disabled
+#define SuspendRampAsymmetricContinuousTimerI(x) { \
+    RACT_Flag_##x = false; \
+}
+// resume
+#define ResumeRampAsymmetricContinuousTimer(x) { \
+    DisableInterrupts(); \
+    RACT_Flag_##x = true; \
+    EnableInterrupts(); \
+}
+// resume when interrupts are disabled
+#define ResumeRampAsymmetricContinuousTimerI(x) { \
+    RACT_Flag_##x = true; \
+}
+// next settings at the start of a period
+#define RampAsymmetricContinuousTimerStep_(x) { \
+    if (RACT_Ramping_##x == true) { \
+        if (RACT_Length_##x != 0u) { \
+            RACT_SettingHigh_##x = RACT_ProfileHigh_##x[RACT_Index_##x]; \
+            RACT_SettingLow_##x = RACT_ProfileLow_##x[RACT_Index_##x]; \
+            RACT_Ramping_##x = (++RACT_Index_##x < RACT_Length_##x); \
+        } else { \
+            if (RACT_SettingHigh_##x < RACT_EndHigh_##x) { \
+                RACT_SettingHigh_##x = ((RACT_EndHigh_##x - RACT_SettingHigh_##x) > RACT_StepHigh_##x) ? RACT_SettingHigh_##x + RACT_StepHigh_##x : RACT_EndHigh_##x; \
+            } else if (RACT_SettingHigh_##x > RACT_EndHigh_##x) { \
+                RACT_SettingHigh_##x = ((RACT_SettingHigh_##x - RACT_EndHigh_##x) > RACT_StepHigh_##x) ? RACT_SettingHigh_##x - RACT_StepHigh_##x : RACT_EndHigh_##x; \
+            } \
+            if (RACT_SettingLow_##x < RACT_EndLow_##x) { \
+                RACT_SettingLow_##x = ((RACT_EndLow_##x - RACT_SettingLow_##x) > RACT_StepLow_##x) ? RACT_SettingLow_##x + RACT_StepLow_##x : RACT_EndLow_##x; \
+            } else if (RACT_SettingLow_##x > RACT_EndLow_##x) { \
+                RACT_SettingLow_##x = ((RACT_SettingLow_##x - RACT_EndLow_##x) > RACT_StepLow_##x) ? RACT_SettingLow_##x - RACT_StepLow_##x : RACT_EndLow_##x; \
+            } \
+            RACT_Ramping_##x = ((RACT_SettingHigh_##x != RACT_EndHigh_##x) || (RACT_SettingLow_##x != RACT_EndLow_##x)); \
+        } \
+        if (RACT_Ramping_##x == false) { \
+            RACT_RampDone_##x = true; \
+        } \
+    } \
+}
+// tick
+#define TickRampAsymmetricContinuousTimer(x) { \
+    if (RACT_Flag_##x == true) { \
+        if (--RACT_Counter_##x == 0u) { \
+            if ((RACT_State_##x == ACT_STATE_HIGH) && (RACT_SettingLow_##x != 0u)) { \
+                RACT_State_##x = ACT_STATE_LOW; \
+                RACT_Counter_##x = RACT_SettingLow_##x; \
+            } else { \
+                RampAsymmetricContinuousTimerStep_(x); \
+                if (RACT_SettingHigh_##x != 0u) { \
+                    RACT_State_##x = ACT_STATE_HIGH; \
+                    RACT_Counter_##x = RACT_SettingHigh_##x; \
+                } else { \
+                    RACT_State_##x = ACT_STATE_LOW; \
+                    RACT_Counter_##x = RACT_SettingLow_##x; \
+                } \
+            } \
+            RACT_Tick_##x = true; \
+        } \
+    } \
+}
+// advance by n ticks at once when interrupts are disabled (catch-up)
+// phase by phase while ramping, whole periods are skipped after the ramp; the
+// period is the sum of the settings, also when one of them is 0
+#define AdvanceRampAsymmetricContinuousTimer(x,n) { \
+    if (RACT_Flag_##x == true) { \
+        uint32_t m_ = (n); \
+        while ((RACT_Counter_##x != 0u) && (m_ >= RACT_Counter_##x)) { \
+            m_ -= RACT_Counter_##x; \
+            RACT_Counter_##x = 1u; \
+            TickRampAsymmetricContinuousTimer(x); \
+            if ((RACT_Ramping_##x == false) && (((uint32_t)RACT_SettingHigh_##x + RACT_SettingLow_##x) != 0u)) { \
+                m_ %= (uint32_t)RACT_SettingHigh_##x + RACT_SettingLow_##x; \
+            } \
+        } \
+        RACT_Counter_##x -= m_; \
+    } \
+}
+// ticks to the next event; d receives the smaller of d and that number
+#define NextEventRampAsymmetricContinuousTimer(x,d) { \
+    if ((RACT_Flag_##x == true) && (RACT_Counter_##x < (d))) { \
+        d = RACT_Counter_##x; \
+    } \
+}
+#define ClearRampAsymmetricContinuousTimerTick(x) { \
+    RACT_Tick_##x = false; \
+}
+#define ClearRampAsymmetricContinuousTimerRampDone(x) { \
+    RACT_RampDone_##x = false; \
+}
+
 // ASYMMETRIC SINGLE PULSE TIMER
 //
 //          +--------+
@@ -653,14 +1430,15 @@
     extern B1 ASP_State_##x; \
     extern B1 ASP_SemiPeriod_Expired_##x; \
     extern B1 ASP_Expired_##x;
-#define DEFINE_ASYMMETRIC_SINGLE_PULSE_TIMER(x,ttype) ttype ASP_Counter_##x; \
-    ttype ASP_SettingFirst_##x; \
-    ttype ASP_SettingSecond_##x; \
-    B1 ASP_Flag_##x; \
-    B1 ASP_sp_##x; \
-    B1 ASP_State_##x; \
-    B1 ASP_SemiPeriod_Expired_##x; \
-    B1 ASP_Expired_##x;
+#define DEFINE_ASYMMETRIC_SINGLE_PULSE_TIMER(x,ttype) DEFINE_ASYMMETRIC_SINGLE_PULSE_TIMER_(TIMER_TICK_DATA,TIMER_EVENT_DATA,TIMER_CONFIG_DATA,x,ttype)
+#define DEFINE_ASYMMETRIC_SINGLE_PULSE_TIMER_(tdata,edata,cdata,x,ttype) tdata ttype ASP_Counter_##x; \
+    cdata ttype ASP_SettingFirst_##x; \
+    cdata ttype ASP_SettingSecond_##x; \
+    cdata B1 ASP_Flag_##x; \
+    tdata B1 ASP_sp_##x; \
+    tdata B1 ASP_State_##x; \
+    edata B1 ASP_SemiPeriod_Expired_##x; \
+    edata B1 ASP_Expired_##x;
 
 // start when interrupts are enabled
 #define SetAsymmetricSinglePulseTimer(x,first,second,istate) { \
@@ -724,6 +1502,14 @@
     ASP_Expired_##x = false; \
     EnableInterrupts(); \
 }
+// stop when interrupts are disabled
+#define StopAsymmetricSinglePulseTimerI(x) { \
+    ASP_Flag_##x = false; \
+    ASP_sp_##x = false; \
+    ASP_State_##x = ASPT_STATE_LOW; \
+    ASP_SemiPeriod_Expired_##x = false; \
+    ASP_Expired_##x = false; \
+}
 // timer reset when interrupts are disabled
 #define ResetAsymmetricSinglePulseTimer(x) { \
     ASP_Flag_##x = false; \
@@ -764,6 +1550,46 @@
         } \
     } \
 }
+// tick without data-dependent branches; same result as TickAsymmetricSinglePulseTimer(x)
+// on an expiration (e) the transition depends on two conditions:
+//   sp  second  counter  State  sp  SemiPeriod_Expired  Flag   Expired
+//   0   != 0    second   !      1   1                   -      -
+//   0   0       0        -      -   1                   false  1
+//   1   x       0        -      -   -                   false  1
+// the rows are applied with masks, so the same instructions run on every tick
+#define TickAsymmetricSinglePulseTimerBranchless(x) { \
+    uint8_t e_ = (uint8_t)((uint8_t)ASP_Flag_##x & (uint8_t)(ASP_Counter_##x == 1u)); \
+    uint8_t h_ = (uint8_t)(e_ & (uint8_t)((uint8_t)ASP_sp_##x ^ 1u)); \
+    uint8_t a_ = (uint8_t)(h_ & (uint8_t)(ASP_SettingSecond_##x != 0u)); \
+    uint8_t f_ = (uint8_t)(e_ ^ a_); \
+    ASP_Counter_##x -= (uint8_t)ASP_Flag_##x; \
+    ASP_Counter_##x ^= (ASP_Counter_##x ^ ASP_SettingSecond_##x) & -(int)a_; \
+    ASP_SemiPeriod_Expired_##x = (B1)((uint8_t)ASP_SemiPeriod_Expired_##x | h_); \
+    ASP_State_##x = (U1)((uint8_t)ASP_State_##x ^ a_); \
+    ASP_sp_##x = (B1)((uint8_t)ASP_sp_##x | a_); \
+    ASP_Flag_##x = (B1)((uint8_t)ASP_Flag_##x & (uint8_t)(f_ ^ 1u)); \
+    ASP_Expired_##x = (B1)((uint8_t)ASP_Expired_##x | f_); \
+}
+
+// advance by n ticks at once when interrupts are disabled (catch-up)
+#define AdvanceAsymmetricSinglePulseTimer(x,n) { \
+    uint32_t m_ = (n); \
+    while ((ASP_Flag_##x == true) && (ASP_Counter_##x != 0u) && (m_ >= ASP_Counter_##x)) { \
+        m_ -= ASP_Counter_##x; \
+        ASP_Counter_##x = 1u; \
+        TickAsymmetricSinglePulseTimer(x); \
+    } \
+    if (ASP_Flag_##x == true) { \
+        ASP_Counter_##x -= m_; \
+    } \
+}
+
+// ticks to the next event; d receives the smaller of d and that number
+#define NextEventAsymmetricSinglePulseTimer(x,d) { \
+    if ((ASP_Flag_##x == true) && (ASP_Counter_##x < (d))) { \
+        d = ASP_Counter_##x; \
+    } \
+}
 
 // BURST GENERATOR
 
@@ -790,6 +1616,14 @@
 #define BurstGeneratorState(x) BG_state_##x
 #define BurstGeneratorFlag(x) BG_Flag_##x
 #define BurstGeneratorTick(x) BG_Tick_##x
+// low between two bursts: true after the tick that ended the last pulse of a
+// burst until the next burst starts, but also after Set before the first pulse;
+// the end of a burst is the tick that sets BurstGeneratorTick(x) while it holds
+// (the first edge after Set is a rising one, where it does not hold)
+#define BurstGeneratorBurstEnd(x) ((BG_state_##x == BG_STATE_LOW) && (BG_pc_##x == 0u))
+// ticks from the start of one idle time to the start of the next one
+#define BurstGeneratorPackagePeriod(x) ((uint32_t)BG_pulses_##x * BG_ht_##x + \
+    (uint32_t)(BG_pulses_##x - 1u) * BG_lt_##x + BG_it_##x)
 #define EXTERN_BURST_GENERATOR(x,ttype) extern ttype BG_Counter_##x; \
     extern uint8_t BG_pulses_##x; \
     extern ttype BG_ht_##x; \
@@ -799,15 +1633,16 @@
     extern B1 BG_state_##x; \
     extern B1 BG_Flag_##x; \
     extern B1 BG_Tick_##x;
-#define DEFINE_BURST_GENERATOR(x,ttype) ttype BG_Counter_##x; \
-    uint8_t BG_pulses_##x; \
-    ttype BG_ht_##x; \
-    ttype BG_lt_##x; \
-    ttype BG_it_##x; \
-    uint8_t BG_pc_##x; \
-    B1 BG_state_##x; \
-    B1 BG_Flag_##x; \
-    B1 BG_Tick_##x;
+#define DEFINE_BURST_GENERATOR(x,ttype) DEFINE_BURST_GENERATOR_(TIMER_TICK_DATA,TIMER_EVENT_DATA,TIMER_CONFIG_DATA,x,ttype)
+#define DEFINE_BURST_GENERATOR_(tdata,edata,cdata,x,ttype) tdata ttype BG_Counter_##x; \
+    cdata uint8_t BG_pulses_##x; \
+    cdata ttype BG_ht_##x; \
+    cdata ttype BG_lt_##x; \
+    cdata ttype BG_it_##x; \
+    tdata uint8_t BG_pc_##x; \
+    tdata B1 BG_state_##x; \
+    cdata B1 BG_Flag_##x; \
+    edata B1 BG_Tick_##x;
 
 // start when interrupts are enabled
 #define SetBurstGenerator(x,pulses,ht,lt,it) { \
@@ -859,6 +1694,12 @@
     BG_Tick_##x = true; \
     EnableInterrupts(); \
 }
+// stop when interrupts are disabled
+#define StopBurstGeneratorI(x) { \
+    BG_state_##x = BG_STATE_LOW; \
+    BG_Flag_##x = false; \
+    BG_Tick_##x = true; \
+}
 // tick
 #define TickBurstGenerator(x) { \
     if (BG_Flag_##x == true) { \
@@ -881,6 +1722,49 @@
         } \
     } \
 }
+// tick without data-dependent branches; same result as TickBurstGenerator(x)
+// on an edge (e) the transition is chosen by the state and c = (pc == state):
+//   state  c  next state  counter  pc
+//   LOW    0  HIGH        ht       pc
+//   LOW    1  HIGH        ht       pulses
+//   HIGH   0  LOW         lt       pc - 1
+//   HIGH   1  LOW         it       pc - 1
+// the rows are applied with masks, so the same instructions run on every tick
+#define TickBurstGeneratorBranchless(x) { \
+    uint8_t e_ = (uint8_t)((uint8_t)BG_Flag_##x & (uint8_t)(BG_Counter_##x == 1u)); \
+    uint8_t s_ = (uint8_t)BG_state_##x; \
+    uint8_t c_ = (uint8_t)(BG_pc_##x == s_); \
+    BG_Counter_##x -= (uint8_t)BG_Flag_##x; \
+    BG_Counter_##x ^= (BG_Counter_##x ^ (BG_ht_##x ^ ((BG_ht_##x ^ (BG_lt_##x ^ ((BG_lt_##x ^ BG_it_##x) & -(int)c_))) & -(int)s_))) & -(int)e_; \
+    BG_pc_##x = (uint8_t)(BG_pc_##x - (s_ & e_) + ((uint8_t)(BG_pulses_##x - BG_pc_##x) & -(int)(e_ & c_ & (uint8_t)(s_ ^ 1u)))); \
+    BG_state_##x = (B1)(s_ ^ e_); \
+    BG_Tick_##x = (B1)((uint8_t)BG_Tick_##x | e_); \
+}
+
+// advance by n ticks at once when interrupts are disabled (catch-up)
+// every elapsed phase costs one TickBurstGenerator(x), whole packages are skipped
+#define AdvanceBurstGenerator(x,n) { \
+    if (BG_Flag_##x == true) { \
+        uint32_t m_ = (n); \
+        while ((BG_Counter_##x != 0u) && (m_ >= BG_Counter_##x)) { \
+            m_ -= BG_Counter_##x; \
+            BG_Counter_##x = 1u; \
+            TickBurstGenerator(x); \
+            if ((BG_state_##x == BG_STATE_LOW) && (BG_pc_##x == 0u)) { \
+                m_ %= BurstGeneratorPackagePeriod(x); \
+            } \
+        } \
+        BG_Counter_##x -= m_; \
+    } \
+}
+
+// ticks to the next event, also for the generators with output
+// d receives the smaller of d and that number
+#define NextEventBurstGenerator(x,d) { \
+    if ((BG_Flag_##x == true) && (BG_Counter_##x < (d))) { \
+        d = BG_Counter_##x; \
+    } \
+}
 
 // with output
 
@@ -938,6 +1822,13 @@
     BG_Tick_##x = true; \
     EnableInterrupts(); \
 }
+// stop when interrupts are disabled
+#define StopBurstGeneratorIWithOutput(x,out) { \
+    out = lowstate; \
+    BG_state_##x = BG_STATE_LOW; \
+    BG_Flag_##x = false; \
+    BG_Tick_##x = true; \
+}
 // tick with output
 #define TickBurstGeneratorWithOutput(x,out) { \
     if (BG_Flag_##x == true) { \
@@ -962,6 +1853,427 @@
         } \
     } \
 }
+// tick with output without data-dependent branches; the output is written on every tick
+#define TickBurstGeneratorBranchlessWithOutput(x,out) { \
+    uint8_t e_ = (uint8_t)((uint8_t)BG_Flag_##x & (uint8_t)(BG_Counter_##x == 1u)); \
+    uint8_t s_ = (uint8_t)BG_state_##x; \
+    uint8_t c_ = (uint8_t)(BG_pc_##x == s_); \
+    BG_Counter_##x -= (uint8_t)BG_Flag_##x; \
+    BG_Counter_##x ^= (BG_Counter_##x ^ (BG_ht_##x ^ ((BG_ht_##x ^ (BG_lt_##x ^ ((BG_lt_##x ^ BG_it_##x) & -(int)c_))) & -(int)s_))) & -(int)e_; \
+    BG_pc_##x = (uint8_t)(BG_pc_##x - (s_ & e_) + ((uint8_t)(BG_pulses_##x - BG_pc_##x) & -(int)(e_ & c_ & (uint8_t)(s_ ^ 1u)))); \
+    out = (U1)(((uint8_t)out & (uint8_t)(e_ ^ 1u)) | (uint8_t)((s_ ^ 1u) & e_)); \
+    BG_state_##x = (B1)(s_ ^ e_); \
+    BG_Tick_##x = (B1)((uint8_t)BG_Tick_##x | e_); \
+}
+
+// advance with output by n ticks at once when interrupts are disabled (catch-up)
+#define AdvanceBurstGeneratorWithOutput(x,n,out) { \
+    if (BG_Flag_##x == true) { \
+        uint32_t m_ = (n); \
+        while ((BG_Counter_##x != 0u) && (m_ >= BG_Counter_##x)) { \
+            m_ -= BG_Counter_##x; \
+            BG_Counter_##x = 1u; \
+            TickBurstGeneratorWithOutput(x,out); \
+            if ((BG_state_##x == BG_STATE_LOW) && (BG_pc_##x == 0u)) { \
+                m_ %= BurstGeneratorPackagePeriod(x); \
+            } \
+        } \
+        BG_Counter_##x -= m_; \
+    } \
+}
+
+// DEBOUNCE_BANK
+// Debouncing (qualification) of many digital inputs with the semantics of the
+// FB_SINGLE_PULSE_TIMER, one lane per input: while the input differs from its
+// debounced state the counter of the lane counts forward, otherwise backward
+// down to 0. When it reaches the setting the debounced state takes the input
+// value, the bit of the input is set in Changed and the counter starts again
+// from 0. A short glitch is thus forgotten at the speed it came.
+// The counters are bit-sliced (vertical): bit j of the counters of all inputs of
+// a word is in DB_Count[j][word], so a tick is a few bitwise operations per
+// counter bit and word, for 8, 16, 32 or 64 inputs at once (wtype). The setting
+// is 1 .. 2^bits - 1. The inputs are sampled by the tick, so the bank takes no
+// part in a catch-up (Advance).
+//
+//  DEFINE_DEBOUNCE_BANK(Keys,uint32_t,8u,3u)   // 256 inputs, 3-bit counters
+//  SetDebounceBankI(Keys,uint32_t,5u,raw);     // debounced states = raw
+//  TickDebounceBank(Keys,uint32_t,raw);        // raw: array of 8 words read from the ports
+//  if (DebounceBankChanged(Keys,w) != 0u) { ... }
+// variables
+#define DebounceBankState(x,w) DB_State_##x[w]
+#define DebounceBankChanged(x,w) DB_Changed_##x[w]
+#define DebounceBankSetting(x) DB_Setting_##x
+#define DebounceBankFlag(x) DB_Flag_##x
+#define DebounceBankInput(x,i) (((DB_State_##x[(i) / (8u * sizeof(DB_State_##x[0]))] >> ((i) % (8u * sizeof(DB_State_##x[0])))) & 1u) != 0u)
+#define DebounceBankWords_(x) (sizeof(DB_State_##x) / sizeof(DB_State_##x[0]))
+#define DebounceBankBits_(x) (sizeof(DB_Count_##x) / sizeof(DB_Count_##x[0]))
+// declaration in a header file
+#define EXTERN_DEBOUNCE_BANK(x,wtype,words,bits) extern wtype DB_Count_##x[bits][words]; \
+    extern wtype DB_State_##x[words]; \
+    extern wtype DB_Changed_##x[words]; \
+    extern uint8_t DB_Setting_##x; \
+    extern B1 DB_Flag_##x;
+// definition in a C file; words <= 255
+#define DEFINE_DEBOUNCE_BANK(x,wtype,words,bits) DEFINE_DEBOUNCE_BANK_(TIMER_TICK_DATA,TIMER_EVENT_DATA,TIMER_CONFIG_DATA,x,wtype,words,bits)
+#define DEFINE_DEBOUNCE_BANK_(tdata,edata,cdata,x,wtype,words,bits) tdata wtype DB_Count_##x[bits][words]; \
+    tdata wtype DB_State_##x[words]; \
+    edata wtype DB_Changed_##x[words]; \
+    cdata uint8_t DB_Setting_##x; \
+    cdata B1 DB_Flag_##x;
+
+// start when interrupts are disabled; the debounced states are taken from raw
+#define SetDebounceBankI(x,wtype,setting,raw) { \
+    uint8_t w_, j_; \
+    for (w_ = 0u; w_ < DebounceBankWords_(x); w_++) { \
+        for (j_ = 0u; j_ < DebounceBankBits_(x); j_++) { \
+            DB_Count_##x[j_][w_] = 0u; \
+        } \
+        DB_State_##x[w_] = (wtype)(raw)[w_]; \
+        DB_Changed_##x[w_] = 0u; \
+    } \
+    DB_Setting_##x = (setting); \
+    DB_Flag_##x = true; \
+}
+// start when interrupts are enabled
+#define SetDebounceBank(x,wtype,setting,raw) { \
+    DisableInterrupts(); \
+    SetDebounceBankI(x,wtype,setting,raw); \
+    EnableInterrupts(); \
+}
+// stop when interrupts are enabled; the states are kept
+#define StopDebounceBank(x) { \
+    DisableInterrupts(); \
+    DB_Flag_##x = false; \
+    EnableInterrupts(); \
+}
+// stop when interrupts are disabled
+#define StopDebounceBankI(x) { \
+    DB_Flag_##x = false; \
+}
+// timer reset when interrupts are disabled
+#define ResetDebounceBank(x) { \
+    DB_Flag_##x = false; \
+}
+// tick; up_ and dn_ are the carry and the borrow of the lanes counting forward
+// and backward, e_ the lanes equal to the setting
+#define TickDebounceBank(x,wtype,raw) { \
+    if (DB_Flag_##x == true) { \
+        uint8_t w_, j_; \
+        wtype f_, up_, dn_, c_, e_; \
+        for (w_ = 0u; w_ < DebounceBankWords_(x); w_++) { \
+            f_ = (wtype)((raw)[w_] ^ DB_State_##x[w_]); \
+            dn_ = 0u; \
+            for (j_ = 0u; j_ < DebounceBankBits_(x); j_++) { \
+                dn_ |= DB_Count_##x[j_][w_]; \
+            } \
+            dn_ &= (wtype)~f_; \
+            up_ = f_; \
+            e_ = f_; \
+            for (j_ = 0u; j_ < DebounceBankBits_(x); j_++) { \
+                c_ = DB_Count_##x[j_][w_]; \
+                DB_Count_##x[j_][w_] = (wtype)(c_ ^ (up_ | dn_)); \
+                up_ &= c_; \
+                dn_ &= (wtype)~c_; \
+                c_ = DB_Count_##x[j_][w_]; \
+                e_ &= (((DB_Setting_##x >> j_) & 1u) != 0u) ? c_ : (wtype)~c_; \
+            } \
+            if (e_ != 0u) { \
+                DB_State_##x[w_] ^= e_; \
+                DB_Changed_##x[w_] |= e_; \
+                for (j_ = 0u; j_ < DebounceBankBits_(x); j_++) { \
+                    DB_Count_##x[j_][w_] &= (wtype)~e_; \
+                } \
+            } \
+        } \
+    } \
+}
+// clear of the changed bits m of word w; the tick writes the same word
+// the complement is taken of Changed & m, at the width of wtype also for a
+// narrower m
+#define ClearDebounceBankChanged(x,w,m) { \
+    DisableInterrupts(); \
+    DB_Changed_##x[w] &= ~(DB_Changed_##x[w] & (m)); \
+    EnableInterrupts(); \
+}
+// clear when interrupts are disabled
+#define ClearDebounceBankChangedI(x,w,m) { \
+    DB_Changed_##x[w] &= ~(DB_Changed_##x[w] & (m)); \
+}
+
+// BURST_BANK
+// Channels (bits 0.. of a mask type) that output the same burst pattern as a
+// BURST_GENERATOR, each delayed by its own phase offset. SetBurstBank builds the
+// table of the output edges of all channels within one package period, sorted,
+// with the levels of all channels after every edge. The tick is then one
+// decrement, and on an edge one table read and one write of all outputs, so
+// the channels can never slip against each other. Channel c is the pattern
+// delayed by phase[c] ticks (phase[c] < the package period), periodic from the
+// Set: a channel whose offset is longer than the idle time starts inside a
+// burst. edges (the size of the table) must be at least 2 * pulses * channels,
+// pulses, ht and channels must not be 0, channels must not exceed the bits of
+// mtype (at most 32), and the package period must fit ttype; otherwise the bank
+// does not start. The table has two pages: a Set builds the
+// new table into the page the tick does not read, with the interrupts enabled,
+// and switches to it in a short critical section.
+// variables
+#define BurstBankCounter(x) BB_Counter_##x
+#define BurstBankFlag(x) BB_Flag_##x
+#define BurstBankTick(x) BB_Tick_##x
+#define BurstBankLevel(x) BB_Out_##x
+#define BurstBankMask(x) BB_Mask_##x
+// declaration in a header file
+#define EXTERN_BURST_BANK(x,ttype,mtype,edges) extern ttype BB_Counter_##x; \
+    extern uint8_t BB_Index_##x; \
+    extern uint8_t BB_Page_##x; \
+    extern uint8_t BB_Edges_##x; \
+    extern ttype BB_Delta_##x[2][edges]; \
+    extern mtype BB_Level_##x[2][edges]; \
+    extern mtype BB_Out_##x; \
+    extern mtype BB_Mask_##x; \
+    extern B1 BB_Flag_##x; \
+    extern B1 BB_Tick_##x;
+// definition in a C file; edges <= 255
+#define DEFINE_BURST_BANK(x,ttype,mtype,edges) DEFINE_BURST_BANK_(TIMER_TICK_DATA,TIMER_EVENT_DATA,TIMER_CONFIG_DATA,x,ttype,mtype,edges)
+#define DEFINE_BURST_BANK_(tdata,edata,cdata,x,ttype,mtype,edges) tdata ttype BB_Counter_##x; \
+    tdata uint8_t BB_Index_##x; \
+    cdata uint8_t BB_Page_##x; \
+    cdata uint8_t BB_Edges_##x; \
+    cdata ttype BB_Delta_##x[2][edges]; \
+    cdata mtype BB_Level_##x[2][edges]; \
+    tdata mtype BB_Out_##x; \
+    cdata mtype BB_Mask_##x; \
+    cdata B1 BB_Flag_##x; \
+    edata B1 BB_Tick_##x;
+
+// builds the table into the free page, then switches to it between cs_begin
+// and cs_end and does output; phase is an array of n offsets
+// the edge keys (tick - 1 within the period) are kept sorted in BB_Delta while
+// the table is built, then they are turned into the distances between edges
+#define SetBurstBank_(x,pulses,ht,lt,it,phase,n,cs_begin,cs_end,output) { \
+    uint32_t p_ = (uint32_t)(pulses) * ((uint32_t)(ht) + (lt)) - (lt) + (it); \
+    uint32_t k_, f_, last_, o_ = 0u, m_ = 0u; \
+    uint8_t c_, i_, e_ = 0u, j_, h_, g_ = BB_Page_##x ^ 1u; \
+    B1 ok_ = false; \
+    if (((pulses) != 0u) && ((ht) != 0u) && ((n) != 0u) && \
+            ((n) <= 8u * sizeof(BB_Mask_##x)) && ((n) <= 32u) && \
+            ((uint32_t)2u * (pulses) * (n) <= sizeof(BB_Delta_##x[0]) / sizeof(BB_Delta_##x[0][0])) && \
+            ((sizeof(BB_Delta_##x[0][0]) >= 4u) || (p_ < (1uL << (8u * sizeof(BB_Delta_##x[0][0])))))) { \
+        for (c_ = 0u; c_ < (n); c_++) { \
+            m_ |= 1uL << c_; \
+            f_ = (p_ - 1u - (phase)[c_] % p_) % p_; \
+            if (((f_ / ((uint32_t)(ht) + (lt))) < (pulses)) && ((f_ % ((uint32_t)(ht) + (lt))) < (ht))) { \
+                o_ |= 1uL << c_; \
+            } \
+            for (i_ = 0u; i_ < 2u * (pulses); i_++) { \
+                k_ = ((phase)[c_] + (uint32_t)(i_ >> 1) * ((uint32_t)(ht) + (lt)) + (((i_ & 1u) != 0u) ? (ht) : 0u)) % p_; \
+                for (j_ = 0u; (j_ < e_) && (BB_Delta_##x[g_][j_] < k_); j_++) { \
+                } \
+                if ((j_ < e_) && (BB_Delta_##x[g_][j_] == k_)) { \
+                    BB_Level_##x[g_][j_] ^= 1uL << c_; \
+                } else { \
+                    for (h_ = e_; h_ > j_; h_--) { \
+                        BB_Delta_##x[g_][h_] = BB_Delta_##x[g_][h_ - 1u]; \
+                        BB_Level_##x[g_][h_] = BB_Level_##x[g_][h_ - 1u]; \
+                    } \
+                    BB_Delta_##x[g_][j_] = k_; \
+                    BB_Level_##x[g_][j_] = 1uL << c_; \
+                    e_++; \
+                } \
+            } \
+        } \
+        BB_Level_##x[g_][0] ^= o_; \
+        for (j_ = 1u; j_ < e_; j_++) { \
+            BB_Level_##x[g_][j_] ^= BB_Level_##x[g_][j_ - 1u]; \
+        } \
+        last_ = BB_Delta_##x[g_][e_ - 1u]; \
+        for (j_ = e_ - 1u; j_ > 0u; j_--) { \
+            BB_Delta_##x[g_][j_] -= BB_Delta_##x[g_][j_ - 1u]; \
+        } \
+        k_ = BB_Delta_##x[g_][0] + 1u; \
+        BB_Delta_##x[g_][0] = BB_Delta_##x[g_][0] + p_ - last_; \
+        ok_ = true; \
+    } \
+    cs_begin; \
+    BB_Tick_##x = false; \
+    if (ok_ == true) { \
+        BB_Page_##x = g_; \
+        BB_Counter_##x = k_; \
+        BB_Index_##x = 0u; \
+        BB_Edges_##x = e_; \
+        BB_Out_##x = o_; \
+        BB_Mask_##x = m_; \
+        BB_Flag_##x = true; \
+        output; \
+    } else { \
+        BB_Flag_##x = false; \
+        BB_Out_##x = 0u; \
+        BB_Mask_##x = 0u; \
+        BB_Edges_##x = 0u; \
+    } \
+    cs_end; \
+}
+// start when interrupts are disabled
+#define SetBurstBankI(x,pulses,ht,lt,it,phase,n) SetBurstBank_(x,pulses,ht,lt,it,phase,n,,,)
+// start with output when interrupts are disabled; out receives the levels of
+// the channels at once
+#define SetBurstBankIWithOutput(x,pulses,ht,lt,it,phase,n,out) SetBurstBank_(x,pulses,ht,lt,it,phase,n,,, \
+    out = (out & ~BB_Mask_##x) | BB_Out_##x)
+// start when interrupts are enabled; they are disabled only for the switch
+#define SetBurstBank(x,pulses,ht,lt,it,phase,n) SetBurstBank_(x,pulses,ht,lt,it,phase,n, \
+    DisableInterrupts(),EnableInterrupts(),)
+// start with output when interrupts are enabled
+#define SetBurstBankWithOutput(x,pulses,ht,lt,it,phase,n,out) SetBurstBank_(x,pulses,ht,lt,it,phase,n, \
+    DisableInterrupts(),EnableInterrupts(),out = (out & ~BB_Mask_##x) | BB_Out_##x)
+// stop when interrupts are disabled
+#define StopBurstBankI(x) { \
+    BB_Flag_##x = false; \
+    BB_Out_##x = 0u; \
+}
+// stop; the outputs go low
+#define StopBurstBankIWithOutput(x,out) { \
+    StopBurstBankI(x); \
+    out &= ~BB_Mask_##x; \
+}
+#define StopBurstBank(x) { \
+    DisableInterrupts(); \
+    StopBurstBankI(x); \
+    EnableInterrupts(); \
+}
+#define StopBurstBankWithOutput(x,out) { \
+    DisableInterrupts(); \
+    StopBurstBankIWithOutput(x,out); \
+    EnableInterrupts(); \
+}
+// timer reset when interrupts are disabled
+#define ResetBurstBank(x) { \
+    BB_Flag_##x = false; \
+    BB_Tick_##x = false; \
+    BB_Out_##x = 0u; \
+    BB_Mask_##x = 0u; \
+}
+// tick
+#define TickBurstBank(x) { \
+    if (BB_Flag_##x == true) { \
+        if (--BB_Counter_##x == 0u) { \
+            BB_Out_##x = BB_Level_##x[BB_Page_##x][BB_Index_##x]; \
+            if (++BB_Index_##x == BB_Edges_##x) { \
+                BB_Index_##x = 0u; \
+            } \
+            BB_Counter_##x = BB_Delta_##x[BB_Page_##x][BB_Index_##x]; \
+            BB_Tick_##x = true; \
+        } \
+    } \
+}
+// tick with output: all channels are written at once
+#define TickBurstBankWithOutput(x,out) { \
+    if (BB_Flag_##x == true) { \
+        if (--BB_Counter_##x == 0u) { \
+            BB_Out_##x = BB_Level_##x[BB_Page_##x][BB_Index_##x]; \
+            out = (out & ~BB_Mask_##x) | BB_Out_##x; \
+            if (++BB_Index_##x == BB_Edges_##x) { \
+                BB_Index_##x = 0u; \
+            } \
+            BB_Counter_##x = BB_Delta_##x[BB_Page_##x][BB_Index_##x]; \
+            BB_Tick_##x = true; \
+        } \
+    } \
+}
+// advance by n ticks at once when interrupts are disabled (catch-up)
+// every elapsed edge costs one tick; after the first one whole package periods
+// (the sum of the distances in the table) are skipped
+#define AdvanceBurstBank_(x,n,tick) { \
+    if (BB_Flag_##x == true) { \
+        uint32_t m_ = (n), p_ = 0u; \
+        uint8_t j_; \
+        while (m_ >= BB_Counter_##x) { \
+            m_ -= BB_Counter_##x; \
+            BB_Counter_##x = 1u; \
+            tick; \
+            if ((p_ == 0u) && (m_ >= BB_Counter_##x)) { \
+                for (j_ = 0u; j_ < BB_Edges_##x; j_++) { \
+                    p_ += BB_Delta_##x[BB_Page_##x][j_]; \
+                } \
+                m_ %= p_; \
+            } \
+        } \
+        BB_Counter_##x -= m_; \
+    } \
+}
+#define AdvanceBurstBank(x,n) AdvanceBurstBank_(x,n,TickBurstBank(x))
+// advance with output; out is written on the last edge
+#define AdvanceBurstBankWithOutput(x,n,out) AdvanceBurstBank_(x,n,TickBurstBankWithOutput(x,out))
+// ticks to the next edge; d receives the smaller of d and that number
+#define NextEventBurstBank(x,d) { \
+    if ((BB_Flag_##x == true) && (BB_Counter_##x < (d))) { \
+        d = BB_Counter_##x; \
+    } \
+}
+#define ClearBurstBankTick(x) { \
+    BB_Tick_##x = false; \
+}
+
+// CHAINS
+// Triggers evaluated in the tick: when the tick statement of timer A sets its
+// event flag, action runs in the same tick. The action is one or more of the I
+// macros of other timers (Set*I, Stop*I, Change*I), so a stage of a sequence
+// starts exactly on the tick the previous one ends, with no main loop round trip
+// and no critical sections.
+//
+//  tick routine: T1 starts a burst of G1, the end of the burst starts T2
+//      TickSinglePulseTimer(T2);
+//      TickAndChainIf(BurstGeneratorTick(G1),BurstGeneratorBurstEnd(G1),
+//          TickBurstGeneratorWithOutput(G1,LATAbits.LATA1),
+//          StopBurstGeneratorI(G1); SetSinglePulseTimerI(T2,MU_1S));
+//      TickAndChain(SinglePulseTimerExpired(T1),TickSinglePulseTimer(T1),
+//          SetBurstGeneratorIWithOutput(G1,5u,3u*MU_001S,2u*MU_001S,5u*MU_001S,LATAbits.LATA1));
+//
+// A timer started by an action counts from the next tick, as if the main loop
+// had started it right after this one. So it has to be ticked before the
+// timer that starts it (T2 before G1 before T1 above); ticked after it, it
+// would be ticked once already in this tick. A cyclic chain (T1 starts T2, T2
+// starts T1) cannot keep this order on every link: on the link whose target is
+// ticked after its source the started timer ends one tick early, which a
+// setting one tick longer on that link makes up. The chains are for Tick, not
+// for a catch-up with Advance, where the action would run at the end of the n
+// ticks.
+// The flag must be a B1 variable.
+
+// the event stays set for the consumer
+#define TickAndChain(flag,tick,action) { \
+    B1 was_ = (flag); \
+    flag = false; \
+    tick; \
+    if ((flag) == true) { \
+        action; \
+        flag = true; \
+    } else { \
+        flag = was_; \
+    } \
+}
+// the event is consumed by the chain; the consumer does not see it
+#define TickAndChainConsume(flag,tick,action) { \
+    B1 was_ = (flag); \
+    flag = false; \
+    tick; \
+    if ((flag) == true) { \
+        action; \
+    } \
+    flag = was_; \
+}
+// action only for the events after which cond holds, e.g. BurstGeneratorBurstEnd(x)
+#define TickAndChainIf(flag,cond,tick,action) { \
+    B1 was_ = (flag); \
+    flag = false; \
+    tick; \
+    if ((flag) == true) { \
+        if (cond) { \
+            action; \
+        } \
+        flag = true; \
+    } else { \
+        flag = was_; \
+    } \
+}
 
 #endif  // !defined(timedefs_h_included)
 
@@ -0,0 +1,203 @@
+/* timedispatch.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if !defined(timedispatch_h_included)
+#define timedispatch_h_included
+
+// BUDGETED DISPATCH OF TIMER EVENTS
+// The main loop hands the mask of the pending events (as for WaitForTimerEvent)
+// to the dispatcher, which calls their handlers by priority and then by the
+// nearest soft deadline, until the budget of the pass is spent. The rest waits
+// for the next pass, so a burst of low priority events delays a critical one by
+// one handler at most. Every entry of the table has
+// - Event      - its bit in the pending mask
+// - Priority   - 0 is the highest
+// - Deadline   - soft deadline in ticks from the event
+// - Cost       - budget units the handler takes at most
+// - Handler    - clears the event flag and does the work
+//
+//  static const TimerDispatchEntry Events[] = {
+//      { EV_T1, 0u, 2u, 40u, OnT1 },
+//      { EV_G1, 1u, 10u, 200u, OnG1 },
+//  };
+//  DEFINE_TIMER_DISPATCH(Disp,Events)
+//
+//  do {
+//      WaitForTimerEvent(TimersPending,ev);
+//      TimerDispatchRun(&Disp,ev,now,300u);
+//  } while (1);
+//
+// now is a tick counter of the application (TIMER_STATS_TABLE.Now with
+// timestats.h). An event waits from the first pass that sees it; it is late when
+// it is handled more than Deadline ticks after that. A handler is started only
+// when its Cost fits the rest of the budget, except the first one of a pass, so
+// every pass makes progress. With TIMER_DISPATCH_CLOCK() (a free running counter
+// in budget units) the budget is charged the measured time of the handlers
+// instead of their Cost.
+// The record of every entry counts the passes that deferred it (Deferrals), the
+// missed deadlines (Missed) and the worst lateness (MaxLate); Passes and
+// Overloads (passes that deferred something) are in the dispatcher.
+
+#include <stdint.h>
+
+#if !defined(TIMER_DISPATCH_MASK)
+#define TIMER_DISPATCH_MASK uint8_t     // type of the pending mask
+#endif  // !defined(TIMER_DISPATCH_MASK)
+#if !defined(TIMER_DISPATCH_STAMP)
+#define TIMER_DISPATCH_STAMP uint16_t   // type of the tick stamps; deadlines are modulo half its range
+#define TIMER_DISPATCH_SSTAMP int16_t   // its signed counterpart
+#endif  // !defined(TIMER_DISPATCH_STAMP)
+#if !defined(TIMER_DISPATCH_COUNT)
+#define TIMER_DISPATCH_COUNT uint16_t   // type of the counters, they saturate at TIMER_DISPATCH_COUNT_MAX
+#define TIMER_DISPATCH_COUNT_MAX (0xFFFFu)
+#endif  // !defined(TIMER_DISPATCH_COUNT)
+
+#define TIMER_DISPATCH_UNLIMITED (0xFFFFu)  // budget of a pass that runs all pending handlers
+
+typedef void (*TimerDispatchHandler)(void);
+
+typedef struct {
+    TIMER_DISPATCH_MASK Event;
+    uint8_t Priority;
+    TIMER_DISPATCH_STAMP Deadline;
+    uint16_t Cost;
+    TimerDispatchHandler Handler;
+} TimerDispatchEntry;
+
+typedef struct {
+    TIMER_DISPATCH_STAMP Since;     // tick the event was seen first
+    uint8_t Waiting;
+    TIMER_DISPATCH_COUNT Deferrals;
+    TIMER_DISPATCH_COUNT Missed;
+    TIMER_DISPATCH_STAMP MaxLate;   // ticks past the deadline
+} TimerDispatchRecord;
+
+typedef struct {
+    const TimerDispatchEntry *Entry;
+    TimerDispatchRecord *Record;
+    uint8_t Entries;
+    TIMER_DISPATCH_COUNT Passes;
+    TIMER_DISPATCH_COUNT Overloads;
+} TimerDispatch;
+
+// definition in a C file; table is a const array of TimerDispatchEntry
+#define DEFINE_TIMER_DISPATCH(d,table) TimerDispatchRecord TD_Record_##d[sizeof(table) / sizeof(table[0])]; \
+    TimerDispatch d = { table, TD_Record_##d, (uint8_t)(sizeof(table) / sizeof(table[0])), 0u, 0u };
+// declaration in a header file
+#define EXTERN_TIMER_DISPATCH(d) extern TimerDispatch d;
+
+#define TimerDispatchInc_(c) { \
+    if ((c) != TIMER_DISPATCH_COUNT_MAX) { \
+        (c)++; \
+    } \
+}
+
+// handles the events of pending by priority and deadline within budget;
+// returns the events that were deferred
+static inline TIMER_DISPATCH_MASK TimerDispatchRun(TimerDispatch *d, TIMER_DISPATCH_MASK pending, TIMER_DISPATCH_STAMP now, uint16_t budget)
+{
+    const TimerDispatchEntry *e;
+    TimerDispatchRecord *r;
+    TIMER_DISPATCH_MASK left = 0u;
+    TIMER_DISPATCH_STAMP waited;
+    uint16_t used = 0u;
+    uint8_t i, best, ran = 0u;
+#if defined(TIMER_DISPATCH_CLOCK)
+    uint16_t start = TIMER_DISPATCH_CLOCK();
+#endif  // defined(TIMER_DISPATCH_CLOCK)
+
+    for (i = 0u; i < d->Entries; i++) {
+        r = &d->Record[i];
+        if ((pending & d->Entry[i].Event) != 0u) {
+            if (r->Waiting == 0u) {
+                r->Waiting = 1u;
+                r->Since = now;
+            }
+            left |= d->Entry[i].Event;
+        } else {
+            r->Waiting = 0u;
+        }
+    }
+    TimerDispatchInc_(d->Passes);
+
+    while (left != 0u) {
+        best = d->Entries;
+        for (i = 0u; i < d->Entries; i++) {
+            if ((left & d->Entry[i].Event) == 0u) {
+                continue;
+            }
+            if (best == d->Entries) {
+                best = i;
+            } else if (d->Entry[i].Priority != d->Entry[best].Priority) {
+                if (d->Entry[i].Priority < d->Entry[best].Priority) {
+                    best = i;
+                }
+            } else if ((TIMER_DISPATCH_SSTAMP)((TIMER_DISPATCH_STAMP)(d->Record[i].Since + d->Entry[i].Deadline) -
+                    (TIMER_DISPATCH_STAMP)(d->Record[best].Since + d->Entry[best].Deadline)) < 0) {
+                best = i;
+            }
+        }
+        e = &d->Entry[best];
+        r = &d->Record[best];
+        if ((ran != 0u) && (budget != TIMER_DISPATCH_UNLIMITED) &&
+                ((used > budget) || (e->Cost > (uint16_t)(budget - used)))) {
+            break;
+        }
+        waited = (TIMER_DISPATCH_STAMP)(now - r->Since);
+        if (waited > e->Deadline) {
+            TimerDispatchInc_(r->Missed);
+            if ((TIMER_DISPATCH_STAMP)(waited - e->Deadline) > r->MaxLate) {
+                r->MaxLate = (TIMER_DISPATCH_STAMP)(waited - e->Deadline);
+            }
+        }
+        r->Waiting = 0u;
+        left &= (TIMER_DISPATCH_MASK)~e->Event;
+        ran = 1u;
+        e->Handler();
+#if defined(TIMER_DISPATCH_CLOCK)
+        used = (uint16_t)(TIMER_DISPATCH_CLOCK() - start);
+#else   // defined(TIMER_DISPATCH_CLOCK)
+        used += e->Cost;
+#endif  // defined(TIMER_DISPATCH_CLOCK)
+    }
+
+    if (left != 0u) {
+        TimerDispatchInc_(d->Overloads);
+        for (i = 0u; i < d->Entries; i++) {
+            if ((left & d->Entry[i].Event) != 0u) {
+                TimerDispatchInc_(d->Record[i].Deferrals);
+            }
+        }
+    }
+    return left;
+}
+
+// zeroes the counters; the waiting events stay
+static inline void TimerDispatchResetStats(TimerDispatch *d)
+{
+    uint8_t i;
+
+    for (i = 0u; i < d->Entries; i++) {
+        d->Record[i].Deferrals = 0u;
+        d->Record[i].Missed = 0u;
+        d->Record[i].MaxLate = 0u;
+    }
+    d->Passes = 0u;
+    d->Overloads = 0u;
+}
+
+#endif  // !defined(timedispatch_h_included)
+
+// End of timedispatch.h
@@ -0,0 +1,146 @@
+/* timefd.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if !defined(timefd_h_included)
+#define timefd_h_included
+
+// TIMERFD INTEGRATION (Linux)
+// The whole set of DEFINE_* timers of an event loop application is exposed as
+// one pollable file descriptor. The descriptor is a timerfd armed at the nearest
+// deadline only, so nothing runs between the events. When it becomes readable
+// the elapsed ticks are caught up at once with the Advance* macros and the
+// expired timers are handed back as a batch of ids. Re-arming the timerfd also
+// clears its readable state, so a batch costs one system call (clock_gettime
+// goes through the vDSO).
+//
+// The descriptor can be added to epoll (EPOLLIN) or polled by io_uring
+// (IORING_OP_POLL_ADD) as it is.
+//
+// The timers are ticked in the thread of the event loop, so this header must be
+// included before cdefs.h to make EnableInterrupts()/DisableInterrupts() empty.
+//
+// The application lists its timers once, like it does in the tick interrupt:
+//
+//  static uint32_t TimersAdvance(uint32_t n)
+//  {
+//      uint32_t d = TIMERFD_IDLE;
+//      AdvanceSinglePulseTimer(T1,n);
+//      AdvanceBurstGenerator(G1,n);
+//      NextEventSinglePulseTimer(T1,d);
+//      NextEventBurstGenerator(G1,d);
+//      return d;
+//  }
+//
+//  on EPOLLIN and after every Set* call of the application:
+//      d = TimersAdvance(TimerFdElapsed(&tf));
+//      n = 0u;
+//      TimerFdCollect(SinglePulseTimerExpired(T1),ID_T1,ids,n);
+//      TimerFdCollect(BurstGeneratorTick(G1),ID_G1,ids,n);
+//      TimerFdArm(&tf,d);
+//
+// Before a Set* call TimerFdElapsed() has to be caught up too, so that the new
+// timer counts from the present tick.
+
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#if !defined(EnableInterrupts) && !defined(DisableInterrupts)
+#define EnableInterrupts()
+#define DisableInterrupts()
+#endif  // !defined(EnableInterrupts) && !defined(DisableInterrupts)
+
+#define TIMERFD_IDLE    (0xFFFFFFFFuL)  // no pending deadline
+
+typedef struct {
+    int Fd;
+    uint64_t TickNs;        // tick period in nanoseconds
+    uint64_t Start;         // CLOCK_MONOTONIC time of tick 0
+    uint64_t Ticks;         // ticks already handed to the timers
+} TimerFd;
+
+static inline uint64_t TimerFdNow_(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (uint64_t)ts.tv_sec * 1000000000uLL + (uint64_t)ts.tv_nsec;
+}
+
+// opening; returns the descriptor to poll or -1
+static inline int TimerFdOpen(TimerFd *t, uint64_t tick_ns)
+{
+    t->Fd = timerfd_create(CLOCK_MONOTONIC,TFD_NONBLOCK | TFD_CLOEXEC);
+    t->TickNs = tick_ns;
+    t->Start = TimerFdNow_();
+    t->Ticks = 0u;
+    return t->Fd;
+}
+
+static inline void TimerFdClose(TimerFd *t)
+{
+    if (t->Fd >= 0) {
+        close(t->Fd);
+        t->Fd = -1;
+    }
+}
+
+// ticks elapsed since the previous call; they are considered handed to the timers
+static inline uint32_t TimerFdElapsed(TimerFd *t)
+{
+    uint64_t due = (TimerFdNow_() - t->Start) / t->TickNs;
+    uint32_t n = (uint32_t)(due - t->Ticks);
+
+    t->Ticks = due;
+    return n;
+}
+
+// arming at d ticks after the last handed tick, or disarming with TIMERFD_IDLE
+// d is 1 at least: NextEvent* gives 0 for an armed timer whose counter is 0
+// (set to 0), and an immediate deadline would wake the loop without a tick
+// passing, again and again
+static inline int TimerFdArm(TimerFd *t, uint32_t d)
+{
+    struct itimerspec its;
+    uint64_t at;
+
+    its.it_interval.tv_sec = 0;
+    its.it_interval.tv_nsec = 0;
+    if (d == TIMERFD_IDLE) {
+        its.it_value.tv_sec = 0;
+        its.it_value.tv_nsec = 0;
+        return timerfd_settime(t->Fd,0,&its,NULL);
+    }
+    if (d == 0u) {
+        d = 1u;
+    }
+    at = t->Start + (t->Ticks + d) * t->TickNs;
+    its.it_value.tv_sec = (time_t)(at / 1000000000uLL);
+    its.it_value.tv_nsec = (long)(at % 1000000000uLL);
+    return timerfd_settime(t->Fd,TFD_TIMER_ABSTIME,&its,NULL);
+}
+
+// adds id to the batch when the event flag is set and clears the flag
+#define TimerFdCollect(flag,id,ids,n) { \
+    if ((flag) == true) { \
+        flag = false; \
+        (ids)[(n)++] = (id); \
+    } \
+}
+
+#endif  // !defined(timefd_h_included)
+
+// End of timefd.h
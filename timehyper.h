@@ -0,0 +1,164 @@
+/* timehyper.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if !defined(timehyper_h_included)
+#define timehyper_h_included
+
+// HYPERPERIOD SCHEDULE
+// Const continuous timers with periods known at build time fire in a pattern
+// that repeats after the least common multiple of the periods (the
+// hyperperiod). tools/timehyper.c computes that pattern once and writes it as a
+// header of const tables: for every tick of the hyperperiod on which some timer
+// fires, the ticks since the previous such tick and the mask of the timers that
+// fire. The tick of a schedule is then one decrement, and on the ticks that
+// fire one table read and one OR of the mask, whatever the number of timers.
+//
+//  tools/timehyper Blink LED=50 BEEP=30 WDOG=100+7 > blink.h
+//
+//  #include "timehyper.h"
+//  #include "blink.h"                      // in the C file of the tick only
+//
+//  DEFINE_HYPER_SCHEDULE(Blink)
+//  SetHyperSchedule(Blink);
+//  TickHyperSchedule(Blink);               // in the tick interrupt
+//  if (HyperScheduleTick(Blink,HYPER_Blink_LED) == true) { ... }
+//
+// A timer fires every per ticks, first at tick per, or at tick offset when
+// +offset (1..per) is given. The masks are like those of TIMER_GROUP: the Tick
+// flag of a timer is its bit in the Ticks mask. The generated header fails the
+// build when its tables are larger than TIMER_HYPER_ROM bytes.
+
+#if !defined(TIMER_HYPER_ROM)
+#define TIMER_HYPER_ROM     (512u)      // ROM budget of the tables of one schedule in bytes
+#endif  // !defined(TIMER_HYPER_ROM)
+
+// HYPER_SCHEDULE
+// variables
+#define HyperScheduleCounter(x) HS_Counter_##x
+#define HyperScheduleFlag(x) HS_Flag_##x
+#define HyperScheduleTicks(x) HS_Ticks_##x
+#define HyperScheduleTick(x,m) ((HS_Ticks_##x & (m)) != 0u)
+// declaration in a header file
+#define EXTERN_HYPER_SCHEDULE(x) extern HyperDelta_##x HS_Counter_##x; \
+    extern HyperIndex_##x HS_Index_##x; \
+    extern B1 HS_Flag_##x; \
+    extern HyperMask_##x HS_Ticks_##x;
+// definition in a C file
+#define DEFINE_HYPER_SCHEDULE(x) DEFINE_HYPER_SCHEDULE_(TIMER_TICK_DATA,TIMER_EVENT_DATA,TIMER_CONFIG_DATA,x)
+#define DEFINE_HYPER_SCHEDULE_(tdata,edata,cdata,x) tdata HyperDelta_##x HS_Counter_##x; \
+    tdata HyperIndex_##x HS_Index_##x; \
+    cdata B1 HS_Flag_##x; \
+    edata HyperMask_##x HS_Ticks_##x;
+
+// start at tick 0 of the hyperperiod when interrupts are enabled
+#define SetHyperSchedule(x) { \
+    DisableInterrupts(); \
+    HS_Counter_##x = HYPER_FIRST_##x; \
+    HS_Index_##x = 0u; \
+    HS_Ticks_##x = 0u; \
+    HS_Flag_##x = true; \
+    EnableInterrupts(); \
+}
+// start when interrupts are disabled
+#define SetHyperScheduleI(x) { \
+    HS_Counter_##x = HYPER_FIRST_##x; \
+    HS_Index_##x = 0u; \
+    HS_Ticks_##x = 0u; \
+    HS_Flag_##x = true; \
+}
+// timer reset when interrupts are disabled
+#define ResetHyperSchedule(x) { \
+    HS_Flag_##x = false; \
+    HS_Ticks_##x = 0u; \
+}
+// clear timer
+#define ClearHyperSchedule(x) { \
+    HS_Flag_##x = false; \
+    HS_Ticks_##x = 0u; \
+    HS_Counter_##x = 0u; \
+    HS_Index_##x = 0u; \
+}
+// pause (suspend)
+#define SuspendHyperSchedule(x) { \
+    DisableInterrupts(); \
+    HS_Flag_##x = false; \
+    EnableInterrupts(); \
+}
+// pause (suspend) when interrupts are disabled
+#define SuspendHyperScheduleI(x) { \
+    HS_Flag_##x = false; \
+}
+// resume
+#define ResumeHyperSchedule(x) { \
+    DisableInterrupts(); \
+    HS_Flag_##x = true; \
+    EnableInterrupts(); \
+}
+// resume when interrupts are disabled
+#define ResumeHyperScheduleI(x) { \
+    HS_Flag_##x = true; \
+}
+// tick
+#define TickHyperSchedule(x) { \
+    if (HS_Flag_##x == true) { \
+        if (--HS_Counter_##x == 0u) { \
+            HS_Ticks_##x |= HyperMasks_##x[HS_Index_##x]; \
+            if (++HS_Index_##x == HYPER_ENTRIES_##x) { \
+                HS_Index_##x = 0u; \
+            } \
+            HS_Counter_##x = HyperDeltas_##x[HS_Index_##x]; \
+        } \
+    } \
+}
+// advance by n ticks at once when interrupts are disabled (catch-up); every
+// timer fires within a hyperperiod
+#define AdvanceHyperSchedule(x,n) { \
+    uint32_t n_ = (n); \
+    if (HS_Flag_##x == true) { \
+        if (n_ >= HYPER_PERIOD_##x) { \
+            HS_Ticks_##x |= HYPER_ALL_##x; \
+            n_ %= HYPER_PERIOD_##x; \
+        } \
+        while (n_ >= HS_Counter_##x) { \
+            n_ -= HS_Counter_##x; \
+            HS_Ticks_##x |= HyperMasks_##x[HS_Index_##x]; \
+            if (++HS_Index_##x == HYPER_ENTRIES_##x) { \
+                HS_Index_##x = 0u; \
+            } \
+            HS_Counter_##x = HyperDeltas_##x[HS_Index_##x]; \
+        } \
+        HS_Counter_##x -= (HyperDelta_##x)n_; \
+    } \
+}
+// ticks to the next event; d receives the smaller of d and that number
+#define NextEventHyperSchedule(x,d) { \
+    if ((HS_Flag_##x == true) && (HS_Counter_##x < (d))) { \
+        d = HS_Counter_##x; \
+    } \
+}
+// clear of the tick flags m; the tick writes the same mask
+#define ClearHyperScheduleTick(x,m) { \
+    DisableInterrupts(); \
+    HS_Ticks_##x &= ~(HS_Ticks_##x & (m)); \
+    EnableInterrupts(); \
+}
+// clear when interrupts are disabled
+#define ClearHyperScheduleTickI(x,m) { \
+    HS_Ticks_##x &= ~(HS_Ticks_##x & (m)); \
+}
+
+#endif  // !defined(timehyper_h_included)
+
+// End of timehyper.h
@@ -0,0 +1,311 @@
+/* timemc.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if !defined(timemc_h_included)
+#define timemc_h_included
+
+// MONTE CARLO RUNNER FOR FBV SCENARIOS (host, POSIX threads)
+// Tuning of the setting and steps of an FBV_SINGLE_PULSE_TIMER that models the
+// heating (forward) and cooling (backward) of a unit. A run starts cold and
+// heating, and switches the direction at random: the heating and cooling
+// phases have geometric lengths with the given means, as if the direction
+// switched with probability 1/mean on every tick. After an expiration (the
+// unit trips) the run ends, or with Revive the timer is revived and cools.
+//
+// Every run has its own timer (the DEFINE macro inside the runner function) and
+// its own random generator seeded from Seed and the run number, so the results
+// do not depend on the order of the runs. The runs are split among Threads
+// workers. The phases are not ticked one by one: NextEvent and Advance move the
+// timer over a whole phase, or up to the expiration inside it.
+//
+//  TimerMcScenario sc = TIMER_MC_SCENARIO;
+//  TimerMcResult r;
+//
+//  TimerMcParse(&sc,"setting=6000 stepf=3 stepb=2 heat=500 cool=400 horizon=100000 runs=1000000");
+//  TimerMcRun(&sc,&r);
+//
+// The statistics are of the tick of the first expiration of a run. cdefs.h and
+// timedefs.h are included before this header.
+
+#include <math.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#if !defined(TIMER_MC_BINS)
+#define TIMER_MC_BINS       (64u)       // histogram bins; the last one collects the rest
+#endif  // !defined(TIMER_MC_BINS)
+#if !defined(TIMER_MC_MAX_THREADS)
+#define TIMER_MC_MAX_THREADS (256u)
+#endif  // !defined(TIMER_MC_MAX_THREADS)
+
+typedef struct {
+    uint32_t Setting;       // parameters of SetFBVSinglePulseTimer
+    uint32_t StepF;
+    uint32_t StepB;
+    uint32_t HeatMean;      // mean length of a heating phase in ticks
+    uint32_t CoolMean;      // mean length of a cooling phase in ticks
+    uint32_t Horizon;       // ticks of a run
+    uint32_t Revive;        // 0: a run ends at its first expiration
+    uint32_t BinTicks;      // width of a histogram bin in ticks
+    uint64_t Runs;
+    uint64_t Seed;
+    uint32_t Threads;       // 0: one per online processor
+} TimerMcScenario;
+
+#define TIMER_MC_SCENARIO { 1000u, 1u, 1u, 100u, 100u, 100000u, 0u, 1000u, 10000u, 1u, 0u }
+
+typedef struct {
+    uint64_t Runs;
+    uint64_t Tripped;       // runs with an expiration
+    uint64_t Expirations;
+    uint64_t ModelTicks;    // ticks simulated by all runs
+    double Mean;            // of the first expiration tick of the tripped runs
+    double M2;              // sum of squared deviations (Welford)
+    uint32_t Min;
+    uint32_t Max;
+    uint64_t Histogram[TIMER_MC_BINS];
+    double Seconds;         // wall time of TimerMcRun
+} TimerMcResult;
+
+typedef struct {
+    const TimerMcScenario *Scenario;
+    uint64_t First;
+    uint64_t Last;
+    TimerMcResult Result;
+} TimerMcWork;
+
+static inline uint64_t TimerMcSplitMix_(uint64_t *s)
+{
+    uint64_t z = (*s += 0x9E3779B97F4A7C15uLL);
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9uLL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBuLL;
+    return z ^ (z >> 31);
+}
+
+// geometric phase length 1.. with the given mean
+static inline uint32_t TimerMcPhase_(uint64_t *s, uint32_t mean)
+{
+    double u, l;
+
+    if (mean <= 1u) {
+        return 1u;
+    }
+    u = ((double)(TimerMcSplitMix_(s) >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+    l = floor(log(u) / log1p(-1.0 / (double)mean)) + 1.0;
+    return (l >= 4294967295.0) ? 0xFFFFFFFFu : (uint32_t)l;
+}
+
+static inline void TimerMcAdd_(TimerMcResult *r, uint32_t t, uint32_t bin)
+{
+    double d = (double)t - r->Mean;
+
+    r->Tripped++;
+    r->Mean += d / (double)r->Tripped;
+    r->M2 += d * ((double)t - r->Mean);
+    if (t < r->Min) {
+        r->Min = t;
+    }
+    if (t > r->Max) {
+        r->Max = t;
+    }
+    r->Histogram[(t / bin < TIMER_MC_BINS) ? t / bin : TIMER_MC_BINS - 1u]++;
+}
+
+// runs First..Last-1
+static inline void *TimerMcWorker_(void *p)
+{
+    TimerMcWork *w = (TimerMcWork *)p;
+    const TimerMcScenario *sc = w->Scenario;
+    TimerMcResult *r = &w->Result;
+    DEFINE_LOCAL_TIMER(FBVSINGLE_PULSE_TIMER,M,uint32_t)
+    uint64_t run, s;
+    uint32_t t, l, d;
+    B1 tripped;
+
+    memset(r,0,sizeof(*r));
+    r->Min = 0xFFFFFFFFu;
+    for (run = w->First; run < w->Last; run++) {
+        s = sc->Seed ^ (run * 0xD1B54A32D192ED03uLL);
+        SetFBVSinglePulseTimerI(M,sc->Setting,sc->StepF,sc->StepB,FBS_FORWARD);
+        tripped = false;
+        t = 0u;
+        while (t < sc->Horizon) {
+            l = TimerMcPhase_(&s,(FBVS_Direction_M == FBS_FORWARD) ? sc->HeatMean : sc->CoolMean);
+            if (l > sc->Horizon - t) {
+                l = sc->Horizon - t;
+            }
+            d = l;
+            NextEventFBVSinglePulseTimer(M,d);
+            AdvanceFBVSinglePulseTimer(M,d);
+            t += d;
+            if (FBVS_Expired_M == true) {
+                r->Expirations++;
+                if (tripped == false) {
+                    tripped = true;
+                    TimerMcAdd_(r,t,sc->BinTicks);
+                }
+                if (sc->Revive == 0u) {
+                    break;
+                }
+                ReviveFBVSinglePulseTimerI(M);
+            } else {
+                SetFBVSinglePulseTimerDirection(M,(FBVS_Direction_M == FBS_FORWARD) ? FBS_BACKWARD : FBS_FORWARD);
+            }
+        }
+        r->ModelTicks += t;
+        r->Runs++;
+    }
+    return NULL;
+}
+
+// statistics of all runs of the scenario; false when the memory cannot be allocated
+static inline bool TimerMcRun(const TimerMcScenario *sc, TimerMcResult *r)
+{
+    TimerMcWork *w;
+    pthread_t *th;
+    struct timespec t0, t1;
+    uint32_t n = sc->Threads, k, i;
+    double d, na, nb;
+    bool ok = true;
+
+    if (n == 0u) {
+        n = (uint32_t)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (n == 0u) {
+        n = 1u;
+    } else if (n > TIMER_MC_MAX_THREADS) {
+        n = TIMER_MC_MAX_THREADS;
+    }
+    w = (TimerMcWork *)calloc(n,sizeof(TimerMcWork));
+    th = (pthread_t *)calloc(n,sizeof(pthread_t));
+    if ((w == NULL) || (th == NULL)) {
+        free(w);
+        free(th);
+        return false;
+    }
+    clock_gettime(CLOCK_MONOTONIC,&t0);
+    for (k = 0u; k < n; k++) {
+        w[k].Scenario = sc;
+        w[k].First = sc->Runs * k / n;
+        w[k].Last = sc->Runs * (k + 1u) / n;
+        if (pthread_create(&th[k],NULL,TimerMcWorker_,&w[k]) != 0) {
+            TimerMcWorker_(&w[k]);
+            th[k] = pthread_self();
+        }
+    }
+    // merge in the order of the runs (Chan et al. for the variance)
+    memset(r,0,sizeof(*r));
+    r->Min = 0xFFFFFFFFu;
+    for (k = 0u; k < n; k++) {
+        if (pthread_equal(th[k],pthread_self()) == 0) {
+            ok = (pthread_join(th[k],NULL) == 0) && ok;
+        }
+        if (w[k].Result.Tripped != 0u) {
+            na = (double)r->Tripped;
+            nb = (double)w[k].Result.Tripped;
+            d = w[k].Result.Mean - r->Mean;
+            r->Mean += d * nb / (na + nb);
+            r->M2 += w[k].Result.M2 + d * d * na * nb / (na + nb);
+            r->Tripped += w[k].Result.Tripped;
+            if (w[k].Result.Min < r->Min) {
+                r->Min = w[k].Result.Min;
+            }
+            if (w[k].Result.Max > r->Max) {
+                r->Max = w[k].Result.Max;
+            }
+        }
+        r->Runs += w[k].Result.Runs;
+        r->Expirations += w[k].Result.Expirations;
+        r->ModelTicks += w[k].Result.ModelTicks;
+        for (i = 0u; i < TIMER_MC_BINS; i++) {
+            r->Histogram[i] += w[k].Result.Histogram[i];
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC,&t1);
+    r->Seconds = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) * 1e-9;
+    free(w);
+    free(th);
+    return ok;
+}
+
+#define TimerMcStdDev(r) (((r)->Tripped > 1u) ? sqrt((r)->M2 / (double)((r)->Tripped - 1u)) : 0.0)
+
+// scenario from "key=value" words (setting, stepf, stepb, heat, cool, horizon,
+// revive, bin, runs, seed, threads) separated by spaces or commas; keys not
+// given keep their values; false at an unknown key
+static inline bool TimerMcParse(TimerMcScenario *sc, const char *text)
+{
+    static const struct {
+        const char *Key;
+        size_t Offset;
+        uint8_t Wide;
+    } keys[] = {
+        { "setting", offsetof(TimerMcScenario,Setting), 0u },
+        { "stepf", offsetof(TimerMcScenario,StepF), 0u },
+        { "stepb", offsetof(TimerMcScenario,StepB), 0u },
+        { "heat", offsetof(TimerMcScenario,HeatMean), 0u },
+        { "cool", offsetof(TimerMcScenario,CoolMean), 0u },
+        { "horizon", offsetof(TimerMcScenario,Horizon), 0u },
+        { "revive", offsetof(TimerMcScenario,Revive), 0u },
+        { "bin", offsetof(TimerMcScenario,BinTicks), 0u },
+        { "runs", offsetof(TimerMcScenario,Runs), 1u },
+        { "seed", offsetof(TimerMcScenario,Seed), 1u },
+        { "threads", offsetof(TimerMcScenario,Threads), 0u },
+    };
+    const char *p = text, *e;
+    unsigned long long v;
+    size_t len, i;
+    char *end;
+
+    for (;;) {
+        p += strspn(p," ,\t\n");
+        if (*p == '\0') {
+            break;
+        }
+        e = strchr(p,'=');
+        if (e == NULL) {
+            return false;
+        }
+        len = (size_t)(e - p);
+        v = strtoull(e + 1,&end,0);
+        for (i = 0u; i < sizeof(keys) / sizeof(keys[0]); i++) {
+            if ((strlen(keys[i].Key) == len) && (strncmp(keys[i].Key,p,len) == 0)) {
+                break;
+            }
+        }
+        if ((i == sizeof(keys) / sizeof(keys[0])) || (end == e + 1)) {
+            return false;
+        }
+        if (keys[i].Wide != 0u) {
+            *(uint64_t *)((char *)sc + keys[i].Offset) = (uint64_t)v;
+        } else {
+            *(uint32_t *)((char *)sc + keys[i].Offset) = (uint32_t)v;
+        }
+        p = end;
+    }
+    if (sc->BinTicks == 0u) {
+        sc->BinTicks = 1u;
+    }
+    return true;
+}
+
+#endif  // !defined(timemc_h_included)
+
+// End of timemc.h
@@ -0,0 +1,303 @@
+/* timepool.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if !defined(timepool_h_included)
+#define timepool_h_included
+
+// DYNAMIC TIMER POOL
+// Timers created and destroyed at run time from a fixed array of 16-byte records
+// defined with DEFINE_TIMER_POOL. Nothing is allocated: creation takes a record
+// from a FIFO free list, destruction returns it. A timer is referred to by a
+// handle that carries the generation of its record; the generation changes when
+// the record is released, so operations on a stale handle are detected in O(1)
+// and do nothing.
+//
+// The timers have the semantics of SINGLE_PULSE_TIMER and CONTINUOUS_TIMER with
+// 32-bit counters. TimerPoolTick() visits only the armed timers. Expired timers
+// are queued in expiration order and read with TimerPoolNextExpired(); like the
+// Expired/Tick flags, repeated expirations before reading are merged.
+//
+// The functions do not touch the interrupts. Where the tick runs in an interrupt,
+// the main loop calls them between DisableInterrupts() and EnableInterrupts();
+// the tick context calls them directly.
+//
+//  DEFINE_TIMER_POOL(Connections,100000u);
+//
+//  TimerPoolInit(&Connections);
+//  h = TimerPoolCreate(&Connections);
+//  TimerPoolSetSinglePulse(&Connections,h,30u*MU_1S);
+//  ...
+//  while ((e = TimerPoolNextExpired(&Connections)) != TIMER_HANDLE_NULL) { ... }
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint64_t TimerHandle;       // generation << 32 | record index
+#define TIMER_HANDLE_NULL   ((TimerHandle)0u)
+
+// record states
+#define TIMER_POOL_FREE     (0u)
+#define TIMER_POOL_IDLE     (1u)    // created, not running
+#define TIMER_POOL_ARMED    (2u)
+
+// event bits
+#define TIMER_POOL_EXPIRED  (0x01u) // expired (single pulse) or ticked (continuous)
+#define TIMER_POOL_QUEUED   (0x02u) // the index is in the expired queue
+
+typedef struct {
+    uint32_t Counter;
+    uint32_t Setting;       // period of a continuous timer, 0 for a single pulse one
+    uint32_t Link;          // next free record, or position in the active list
+    uint16_t Gen;           // generation; never 0
+    uint8_t State;
+    uint8_t Event;
+} TimerPoolRecord;
+
+typedef struct {
+    TimerPoolRecord *Record;
+    uint32_t *Active;       // indexes of the armed timers
+    uint32_t *Expired;      // queue of expired indexes
+    uint32_t Size;
+    uint32_t NActive;
+    uint32_t FreeHead;
+    uint32_t FreeTail;
+    uint32_t NFree;
+    uint32_t ExpiredHead;
+    uint32_t NExpired;
+} TimerPool;
+
+// definition of a pool of size timers in a C file
+#define DEFINE_TIMER_POOL(p,size) TimerPoolRecord TP_Record_##p[size]; \
+    uint32_t TP_Active_##p[size]; \
+    uint32_t TP_Expired_##p[size]; \
+    TimerPool p = { TP_Record_##p, TP_Active_##p, TP_Expired_##p, (size), 0u, 0u, 0u, 0u, 0u, 0u };
+// declaration in a header file
+#define EXTERN_TIMER_POOL(p) extern TimerPool p;
+
+#define TimerPoolIndex_(h) ((uint32_t)(h))
+#define TimerPoolGen_(h) ((uint16_t)((h) >> 32))
+#define TimerPoolHandle_(t,i) (((TimerHandle)(t)->Record[i].Gen << 32) | (i))
+
+static inline void TimerPoolInit(TimerPool *t)
+{
+    uint32_t i;
+
+    for (i = 0u; i < t->Size; i++) {
+        t->Record[i].State = TIMER_POOL_FREE;
+        t->Record[i].Event = 0u;
+        t->Record[i].Gen = 1u;
+        t->Record[i].Link = i + 1u;
+    }
+    t->NActive = 0u;
+    t->FreeHead = 0u;
+    t->FreeTail = t->Size - 1u;
+    t->NFree = t->Size;
+    t->ExpiredHead = 0u;
+    t->NExpired = 0u;
+}
+
+// record of a valid handle or NULL for a stale one
+static inline TimerPoolRecord *TimerPoolRecordOf(TimerPool *t, TimerHandle h)
+{
+    uint32_t i = TimerPoolIndex_(h);
+
+    if ((i < t->Size) && (t->Record[i].Gen == TimerPoolGen_(h)) && (t->Record[i].State != TIMER_POOL_FREE)) {
+        return &t->Record[i];
+    }
+    return NULL;
+}
+
+static inline bool TimerPoolValid(TimerPool *t, TimerHandle h)
+{
+    return TimerPoolRecordOf(t,h) != NULL;
+}
+
+static inline void TimerPoolDisarm_(TimerPool *t, TimerPoolRecord *r)
+{
+    uint32_t last;
+
+    last = t->Active[--t->NActive];
+    t->Active[r->Link] = last;
+    t->Record[last].Link = r->Link;
+    r->State = TIMER_POOL_IDLE;
+}
+
+// new stopped timer; TIMER_HANDLE_NULL when the pool is exhausted
+static inline TimerHandle TimerPoolCreate(TimerPool *t)
+{
+    uint32_t i;
+
+    if (t->NFree == 0u) {
+        return TIMER_HANDLE_NULL;
+    }
+    i = t->FreeHead;
+    t->FreeHead = t->Record[i].Link;
+    t->NFree--;
+    t->Record[i].State = TIMER_POOL_IDLE;
+    t->Record[i].Event &= TIMER_POOL_QUEUED;
+    return TimerPoolHandle_(t,i);
+}
+
+// release of the timer; false for a stale handle
+static inline bool TimerPoolDestroy(TimerPool *t, TimerHandle h)
+{
+    TimerPoolRecord *r = TimerPoolRecordOf(t,h);
+    uint32_t i = TimerPoolIndex_(h);
+
+    if (r == NULL) {
+        return false;
+    }
+    if (r->State == TIMER_POOL_ARMED) {
+        TimerPoolDisarm_(t,r);
+    }
+    r->State = TIMER_POOL_FREE;
+    r->Event &= TIMER_POOL_QUEUED;
+    if (++r->Gen == 0u) {
+        r->Gen = 1u;
+    }
+    if (t->NFree == 0u) {
+        t->FreeHead = i;
+    } else {
+        t->Record[t->FreeTail].Link = i;
+    }
+    t->FreeTail = i;
+    t->NFree++;
+    return true;
+}
+
+static inline bool TimerPoolSet_(TimerPool *t, TimerHandle h, uint32_t per, uint32_t setting)
+{
+    TimerPoolRecord *r = TimerPoolRecordOf(t,h);
+
+    if ((r == NULL) || (per == 0u)) {
+        return false;
+    }
+    r->Counter = per;
+    r->Setting = setting;
+    r->Event &= TIMER_POOL_QUEUED;
+    if (r->State != TIMER_POOL_ARMED) {
+        r->Link = t->NActive;
+        t->Active[t->NActive++] = TimerPoolIndex_(h);
+        r->State = TIMER_POOL_ARMED;
+    }
+    return true;
+}
+
+// start (or restart) as a single pulse timer; false for a stale handle or per 0
+static inline bool TimerPoolSetSinglePulse(TimerPool *t, TimerHandle h, uint32_t per)
+{
+    return TimerPoolSet_(t,h,per,0u);
+}
+
+// start (or restart) as a continuous timer; false for a stale handle or per 0
+static inline bool TimerPoolSetContinuous(TimerPool *t, TimerHandle h, uint32_t per)
+{
+    return TimerPoolSet_(t,h,per,per);
+}
+
+// stop and forget a pending expiration; false for a stale handle
+static inline bool TimerPoolStop(TimerPool *t, TimerHandle h)
+{
+    TimerPoolRecord *r = TimerPoolRecordOf(t,h);
+
+    if (r == NULL) {
+        return false;
+    }
+    if (r->State == TIMER_POOL_ARMED) {
+        TimerPoolDisarm_(t,r);
+    }
+    r->Event &= TIMER_POOL_QUEUED;
+    return true;
+}
+
+// true when the timer has expired (ticked) and it was not read yet
+static inline bool TimerPoolExpired(TimerPool *t, TimerHandle h)
+{
+    TimerPoolRecord *r = TimerPoolRecordOf(t,h);
+
+    return (r != NULL) && ((r->Event & TIMER_POOL_EXPIRED) != 0u);
+}
+
+static inline void TimerPoolFire_(TimerPool *t, uint32_t i)
+{
+    TimerPoolRecord *r = &t->Record[i];
+
+    r->Event |= TIMER_POOL_EXPIRED;
+    if ((r->Event & TIMER_POOL_QUEUED) == 0u) {
+        r->Event |= TIMER_POOL_QUEUED;
+        t->Expired[(t->ExpiredHead + t->NExpired++) % t->Size] = i;
+    }
+}
+
+// tick
+static inline void TimerPoolTick(TimerPool *t)
+{
+    TimerPoolRecord *r;
+    uint32_t k = 0u, i;
+
+    while (k < t->NActive) {
+        i = t->Active[k];
+        r = &t->Record[i];
+        if (--r->Counter != 0u) {
+            k++;
+        } else {
+            TimerPoolFire_(t,i);
+            if (r->Setting != 0u) {
+                r->Counter = r->Setting;
+                k++;
+            } else {
+                TimerPoolDisarm_(t,r);      // the last active one moves to k
+            }
+        }
+    }
+}
+
+// next expired timer in order of expiration, or TIMER_HANDLE_NULL; the
+// expiration is consumed
+static inline TimerHandle TimerPoolNextExpired(TimerPool *t)
+{
+    TimerPoolRecord *r;
+    uint32_t i;
+
+    while (t->NExpired != 0u) {
+        i = t->Expired[t->ExpiredHead];
+        t->ExpiredHead = (t->ExpiredHead + 1u) % t->Size;
+        t->NExpired--;
+        r = &t->Record[i];
+        r->Event &= (uint8_t)~TIMER_POOL_QUEUED;
+        if ((r->State != TIMER_POOL_FREE) && ((r->Event & TIMER_POOL_EXPIRED) != 0u)) {
+            r->Event &= (uint8_t)~TIMER_POOL_EXPIRED;
+            return TimerPoolHandle_(t,i);
+        }
+    }
+    return TIMER_HANDLE_NULL;
+}
+
+// ticks to the next expiration; d receives the smaller of d and that number
+static inline void TimerPoolNextEvent(TimerPool *t, uint32_t *d)
+{
+    uint32_t k;
+
+    for (k = 0u; k < t->NActive; k++) {
+        if (t->Record[t->Active[k]].Counter < *d) {
+            *d = t->Record[t->Active[k]].Counter;
+        }
+    }
+}
+
+#endif  // !defined(timepool_h_included)
+
+// End of timepool.h
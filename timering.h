@@ -0,0 +1,95 @@
+/* timering.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if !defined(timering_h_included)
+#define timering_h_included
+
+// LOCK-FREE RING (host only, GCC atomics)
+// Bounded multi-producer / single-consumer queue. Every slot carries a sequence
+// number, producers reserve a position with one CAS on Tail, the consumer
+// never writes Tail. The ring holds no pointers, so it may live in shared memory.
+//
+// size must be a power of 2.
+
+#if !defined(TIMER_CACHE_LINE)
+#define TIMER_CACHE_LINE    (64u)
+#endif  // !defined(TIMER_CACHE_LINE)
+
+// ring type; Head and Tail are on separate cache lines
+#define TIMER_RING(etype,size) struct { \
+    uint32_t Head; \
+    uint8_t HeadPad_[TIMER_CACHE_LINE - sizeof(uint32_t)]; \
+    uint32_t Tail; \
+    uint8_t TailPad_[TIMER_CACHE_LINE - sizeof(uint32_t)]; \
+    struct { \
+        uint32_t Seq; \
+        etype Data; \
+    } Slot[size]; \
+}
+
+// initialization before first use
+#define TimerRingInit(r,size) { \
+    uint32_t i_; \
+    for (i_ = 0u; i_ < (size); i_++) { \
+        (r).Slot[i_].Seq = i_; \
+    } \
+    (r).Head = 0u; \
+    __atomic_store_n(&(r).Tail,0u,__ATOMIC_RELEASE); \
+}
+
+// push from any thread or process; ok receives false if the ring is full
+#define TimerRingPush(r,size,v,ok) { \
+    uint32_t pos_ = __atomic_load_n(&(r).Tail,__ATOMIC_RELAXED); \
+    uint32_t i_; \
+    int32_t d_; \
+    ok = false; \
+    for (;;) { \
+        i_ = pos_ & ((size) - 1u); \
+        d_ = (int32_t)(__atomic_load_n(&(r).Slot[i_].Seq,__ATOMIC_ACQUIRE) - pos_); \
+        if (d_ == 0) { \
+            if (__atomic_compare_exchange_n(&(r).Tail,&pos_,pos_ + 1u,true,__ATOMIC_RELAXED,__ATOMIC_RELAXED)) { \
+                (r).Slot[i_].Data = (v); \
+                __atomic_store_n(&(r).Slot[i_].Seq,pos_ + 1u,__ATOMIC_RELEASE); \
+                ok = true; \
+                break; \
+            } \
+        } else if (d_ < 0) { \
+            break; \
+        } else { \
+            pos_ = __atomic_load_n(&(r).Tail,__ATOMIC_RELAXED); \
+        } \
+    } \
+}
+
+// pop from the single consumer; ok receives false if the ring is empty
+#define TimerRingPop(r,size,v,ok) { \
+    uint32_t pos_ = (r).Head; \
+    uint32_t i_ = pos_ & ((size) - 1u); \
+    ok = false; \
+    if (__atomic_load_n(&(r).Slot[i_].Seq,__ATOMIC_ACQUIRE) == pos_ + 1u) { \
+        (v) = (r).Slot[i_].Data; \
+        __atomic_store_n(&(r).Slot[i_].Seq,pos_ + (size),__ATOMIC_RELEASE); \
+        (r).Head = pos_ + 1u; \
+        ok = true; \
+    } \
+}
+
+// true when the ring has no elements; from the consumer
+#define TimerRingEmpty(r,size) \
+    (__atomic_load_n(&(r).Slot[(r).Head & ((size) - 1u)].Seq,__ATOMIC_ACQUIRE) != (r).Head + 1u)
+
+#endif  // !defined(timering_h_included)
+
+// End of timering.h
@@ -0,0 +1,209 @@
+/* timeseq.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if !defined(timeseq_h_included)
+#define timeseq_h_included
+
+// SEQUENCES
+// Straight-line sequencing code that waits for timer events instead of a hand
+// written state machine in the main loop. A sequence is a void function; when it
+// waits, it registers itself as the waiter of the event it waits for and
+// returns, and the next call continues right after the wait. The only state of
+// a suspended sequence is its resume point (two bytes, defined by
+// DEFINE_SEQUENCE) and its slot in the waiter table, so no stack frame is kept
+// and nothing is allocated. Variables that live across a wait must be static.
+//
+// The events are the bits of the pending mask of timewait.h (EV_T1, EV_G1, ..).
+// SequenceDispatch() calls only the waiters of the events that are set, so a
+// suspended sequence costs nothing on the passes of the main loop that do not
+// concern it. Every event has one waiter slot: one sequence at a time waits for
+// a given event. A woken sequence consumes the event flag (the waits below
+// clear it).
+//
+//  DEFINE_SEQUENCE_WAITERS
+//  DEFINE_SEQUENCE(S1,Sequence1)
+//
+//  void Sequence1(void)
+//  {
+//      SequenceBegin(S1);
+//      SequenceAfter(S1,T1,50u*MU_001S,EV_T1);
+//      LATAbits.LATA0 = highstate;
+//      SetBurstGeneratorWithOutput(G1,5u,3u*MU_001S,2u*MU_001S,5u*MU_001S,LATAbits.LATA1);
+//      SequenceBurstDone(S1,G1,EV_G1);
+//      StopBurstGeneratorWithOutput(G1,LATAbits.LATA1);
+//      SequenceEnd(S1);
+//  }
+//
+//  StartSequence(S1);
+//  do {
+//      WaitForTimerEvent(TimersPending,ev);
+//      ev = SequenceDispatch(ev);      // the events no sequence waited for
+//      ...
+//  } while (1);
+//
+// The waits are single statements. Only one wait may be written on a source
+// line. switch statements cannot enclose a wait.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if !defined(SEQ_MASK)
+#define SEQ_MASK uint8_t        // type of the event mask
+#define SEQ_EVENTS (8u)         // its bits
+#endif  // !defined(SEQ_MASK)
+
+#define SEQ_DONE    (0xFFFFu)
+
+typedef void (*SequenceFunction)(void);
+
+// waiter of every event bit; defined once in a C file
+extern SequenceFunction SEQ_Waiter[SEQ_EVENTS];
+#define DEFINE_SEQUENCE_WAITERS SequenceFunction SEQ_Waiter[SEQ_EVENTS];
+
+#define SequenceLine(s) SEQ_Line_##s
+#define EXTERN_SEQUENCE(s) extern uint16_t SEQ_Line_##s; \
+    extern const SequenceFunction SEQ_Function_##s;
+// fn is the function of the sequence
+#define DEFINE_SEQUENCE(s,fn) void fn(void); \
+    uint16_t SEQ_Line_##s; \
+    const SequenceFunction SEQ_Function_##s = fn;
+
+// registers f as the waiter of the event ev (one bit)
+static inline void SequenceWaitOn_(SequenceFunction f, SEQ_MASK ev)
+{
+    uint8_t i = 0u;
+
+    while ((ev >>= 1) != 0u) {
+        i++;
+    }
+    SEQ_Waiter[i] = f;
+}
+
+// calls the waiters of the events of ev, each once; returns the events of ev
+// that had no waiter
+static inline SEQ_MASK SequenceDispatch(SEQ_MASK ev)
+{
+    SequenceFunction f;
+    SEQ_MASK left = 0u;
+    uint8_t i;
+
+    for (i = 0u; (i < SEQ_EVENTS) && ((ev >> i) != 0u); i++) {
+        if (((ev >> i) & 1u) != 0u) {
+            f = SEQ_Waiter[i];
+            if (f != NULL) {
+                SEQ_Waiter[i] = NULL;
+                f();
+            } else {
+                left |= (SEQ_MASK)(1u << i);
+            }
+        }
+    }
+    return left;
+}
+
+// start again from the beginning (also the initialization); the sequence runs
+// to its first wait
+#define StartSequence(s) do { \
+    StopSequence(s); \
+    SEQ_Line_##s = 0u; \
+    SEQ_Function_##s(); \
+} while (0)
+// the sequence does not run any more
+#define StopSequence(s) do { \
+    uint8_t i_; \
+    for (i_ = 0u; i_ < SEQ_EVENTS; i_++) { \
+        if (SEQ_Waiter[i_] == SEQ_Function_##s) { \
+            SEQ_Waiter[i_] = NULL; \
+        } \
+    } \
+    SEQ_Line_##s = SEQ_DONE; \
+} while (0)
+#define SequenceFinished(s) (SEQ_Line_##s == SEQ_DONE)
+
+// first and last statement of the sequence function
+#define SequenceBegin(s) switch (SEQ_Line_##s) { case 0u:
+#define SequenceEnd(s) SEQ_Line_##s = SEQ_DONE; case SEQ_DONE: ; }
+
+// resume points; k distinguishes the waits of one macro expansion; cond is
+// tested at once and then whenever ev is dispatched
+#define SEQ_Wait_(s,cond,ev,k) SEQ_Line_##s = (uint16_t)(__LINE__ * 4u + (k)); \
+    case (__LINE__ * 4u + (k)): if (!(cond)) { \
+        SequenceWaitOn_(SEQ_Function_##s,ev); \
+        return; \
+    }
+
+// wait until cond is true, tested when ev is dispatched; cond or the sequence
+// clears the flag of ev
+#define SequenceWaitUntil(s,cond,ev) do { \
+    SEQ_Wait_(s,cond,ev,0u); \
+} while (0)
+// give way until the next dispatch of ev
+#define SequenceYield(s,ev) do { \
+    SEQ_Line_##s = (uint16_t)(__LINE__ * 4u); \
+    SequenceWaitOn_(SEQ_Function_##s,ev); \
+    return; \
+    case (__LINE__ * 4u): ; \
+} while (0)
+// finish now
+#define SequenceExit(s) do { \
+    SEQ_Line_##s = SEQ_DONE; \
+    return; \
+} while (0)
+
+// arm a SINGLE_PULSE_TIMER and wait for its expiration (event ev)
+#define SequenceAfter(s,x,per,ev) do { \
+    SetSinglePulseTimer(x,per); \
+    SEQ_Wait_(s,ST_Expired_##x == true,ev,0u); \
+    ClearSinglePulseTimerExpired(x); \
+} while (0)
+// wait for the next tick of a running CONTINUOUS_TIMER
+#define SequenceNextTick(s,x,ev) do { \
+    SEQ_Wait_(s,CT_Tick_##x == true,ev,0u); \
+    ClearContinuousTimerTick(x); \
+} while (0)
+// wait for the next tick of a running CONST_CONTINUOUS_TIMER
+#define SequenceNextConstTick(s,x,ev) do { \
+    SEQ_Wait_(s,CCT_Tick_##x == true,ev,0u); \
+    ClearConstContinuousTick(x); \
+} while (0)
+// wait for the next tick of a CONST_FREE_CONTINUOUS_TIMER
+#define SequenceNextConstFreeTick(s,x,ev) do { \
+    SEQ_Wait_(s,CFCT_Tick_##x == true,ev,0u); \
+    ClearConstFreeContinuousTimerTick(x); \
+} while (0)
+// wait for the next edge of a running ASYMMETRIC_CONTINUOUS_TIMER
+#define SequenceNextAsymmetricTick(s,x,ev) do { \
+    SEQ_Wait_(s,ACT_Tick_##x == true,ev,0u); \
+    ClearAsymmetricContinuousTimerTick(x); \
+} while (0)
+// wait for the expiration of a running FB or FBV timer
+#define SequenceFBExpired(s,x,ev) do { \
+    SEQ_Wait_(s,FBS_Expired_##x == true,ev,0u); \
+    ClearFBSinglePulseTimerExpired(x); \
+} while (0)
+#define SequenceFBVExpired(s,x,ev) do { \
+    SEQ_Wait_(s,FBVS_Expired_##x == true,ev,0u); \
+    ClearFBVSinglePulseTimerExpired(x); \
+} while (0)
+// wait for the end of the current package of a running BURST_GENERATOR
+// (or for its stop); ev is its Tick, consumed on every edge
+#define SequenceBurstDone(s,x,ev) do { \
+    SEQ_Wait_(s,(BG_Tick_##x = false, (BG_pc_##x != 0u) || (BG_Flag_##x == false)),ev,1u); \
+    SEQ_Wait_(s,(BG_Tick_##x = false, (BG_pc_##x == 0u) || (BG_Flag_##x == false)),ev,2u); \
+} while (0)
+
+#endif  // !defined(timeseq_h_included)
+
+// End of timeseq.h
@@ -0,0 +1,410 @@
+/* timeshard.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if !defined(timeshard_h_included)
+#define timeshard_h_included
+
+// SHARDED TIMER ENGINE (host, POSIX threads)
+// The timers are split into shards; every shard is a timewheel.h wheel owned by
+// one worker thread, which alone ticks it and changes it. Nothing is shared
+// between the shards but the clock, so the engine scales with the workers.
+// - Set/Stop/Destroy from the owner thread (the poller of the shard and the
+//   handlers it runs) go to the wheel directly, without locks or atomics.
+// - From any other thread they are pushed to the command ring of the shard
+//   (timering.h) and applied by the owner before its next tick.
+// - Expired timers are pushed to a work-stealing deque of the shard. The owner
+//   takes them from one end; idle workers steal from the other end, so the
+//   handlers of a busy shard run on all workers.
+// Timers are created by the owner of their shard, or by any thread before
+// TimerShardRun(). A handle carries the shard number in its upper 16 bits.
+//
+//  static void Expired(TimerHandle h, void *arg) { ... TimerShardSet(&e,h,30000u); }
+//  static bool Poll(uint32_t shard, void *arg) { ... return busy; }
+//
+//  TimerShardInit(&e,8u,1000000u,65536u,1000000u,Expired,Poll,NULL);
+//  h = TimerShardCreate(&e,k);
+//  TimerShardRun(&e);
+//  ...
+//  TimerShardShutdown(&e);
+//
+// With _GNU_SOURCE defined, worker k is pinned to CPU k.
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "timering.h"
+#include "timewheel.h"
+
+#if !defined(TSHARD_COMMAND_RING)
+#define TSHARD_COMMAND_RING (4096u)     // power of 2
+#endif  // !defined(TSHARD_COMMAND_RING)
+#if !defined(TSHARD_DEQUE)
+#define TSHARD_DEQUE        (4096u)     // power of 2
+#endif  // !defined(TSHARD_DEQUE)
+#if !defined(TSHARD_BATCH)
+#define TSHARD_BATCH        (64u)       // handlers run between polls of the rings
+#endif  // !defined(TSHARD_BATCH)
+
+// commands
+#define TSHARD_CMD_SET      (1u)
+#define TSHARD_CMD_STOP     (2u)
+#define TSHARD_CMD_DESTROY  (3u)
+
+// engine states
+#define TSHARD_IDLE         (0u)        // before TimerShardRun(); any thread owns the shards
+#define TSHARD_RUNNING      (1u)
+#define TSHARD_STOPPING     (2u)
+
+#define TimerShardOf(h) ((uint32_t)((h) >> 48))
+
+typedef void (*TimerShardHandler)(TimerHandle h, void *arg);
+// called in every pass of a worker; returns true when it did some work
+typedef bool (*TimerShardPoller)(uint32_t shard, void *arg);
+
+typedef struct {
+    TimerHandle H;
+    uint32_t Op;
+    uint32_t Per;
+} TimerShardCommand;
+
+typedef struct TimerShardEngine_ TimerShardEngine;
+
+typedef struct {
+    TimerWheel Wheel;       // owner only
+    uint64_t Ticks;
+    uint32_t Id;
+    TimerShardEngine *Engine;
+    pthread_t Thread;
+    // statistics, written by the owner
+    uint64_t Arms;
+    uint64_t Expirations;   // handlers run by this worker
+    uint64_t Stolen;        // of them, taken from other shards
+    TIMER_RING(TimerShardCommand,TSHARD_COMMAND_RING) Commands;
+    // work-stealing deque of expired handles; the owner pushes and takes at
+    // Bottom, the other workers steal at Top
+    int64_t Top __attribute__((aligned(TIMER_CACHE_LINE)));
+    int64_t Bottom __attribute__((aligned(TIMER_CACHE_LINE)));
+    TimerHandle Deque[TSHARD_DEQUE];
+} __attribute__((aligned(TIMER_CACHE_LINE))) TimerShard;
+
+struct TimerShardEngine_ {
+    TimerShard *Shard;
+    uint32_t NShards;
+    uint32_t State;
+    uint64_t TickNs;
+    uint64_t Start;         // CLOCK_MONOTONIC time of tick 0
+    TimerShardHandler Handler;
+    TimerShardPoller Poller;
+    void *Arg;
+};
+
+static inline uint64_t TimerShardNow_(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (uint64_t)ts.tv_sec * 1000000000uLL + (uint64_t)ts.tv_nsec;
+}
+
+// initialization of nshards shards of size timers and slots (power of 2) wheel
+// slots; false when the memory cannot be allocated
+static inline bool TimerShardInit(TimerShardEngine *e, uint32_t nshards, uint32_t size, uint32_t slots,
+        uint64_t tick_ns, TimerShardHandler handler, TimerShardPoller poller, void *arg)
+{
+    TimerShard *s;
+    uint32_t k;
+
+    e->Shard = (TimerShard *)aligned_alloc(TIMER_CACHE_LINE,nshards * sizeof(TimerShard));
+    if (e->Shard == NULL) {
+        return false;
+    }
+    memset(e->Shard,0,nshards * sizeof(TimerShard));
+    e->NShards = nshards;
+    e->State = TSHARD_IDLE;
+    e->TickNs = tick_ns;
+    e->Handler = handler;
+    e->Poller = poller;
+    e->Arg = arg;
+    for (k = 0u; k < nshards; k++) {
+        s = &e->Shard[k];
+        s->Id = k;
+        s->Engine = e;
+        s->Wheel.Record = (TimerWheelRecord *)malloc(size * sizeof(TimerWheelRecord));
+        s->Wheel.Slot = (uint32_t *)malloc(slots * sizeof(uint32_t));
+        s->Wheel.Expired = (uint32_t *)malloc(size * sizeof(uint32_t));
+        if ((s->Wheel.Record == NULL) || (s->Wheel.Slot == NULL) || (s->Wheel.Expired == NULL)) {
+            e->NShards = k + 1u;
+            return false;
+        }
+        s->Wheel.Size = size;
+        s->Wheel.Mask = slots - 1u;
+        TimerWheelInit(&s->Wheel);
+        TimerRingInit(s->Commands,TSHARD_COMMAND_RING);
+    }
+    return true;
+}
+
+// release of the memory; after TimerShardShutdown() or a failed TimerShardInit()
+static inline void TimerShardFree(TimerShardEngine *e)
+{
+    uint32_t k;
+
+    for (k = 0u; k < e->NShards; k++) {
+        free(e->Shard[k].Wheel.Record);
+        free(e->Shard[k].Wheel.Slot);
+        free(e->Shard[k].Wheel.Expired);
+    }
+    free(e->Shard);
+    e->Shard = NULL;
+    e->NShards = 0u;
+}
+
+static inline bool TimerShardOwner_(TimerShard *s)
+{
+    return (__atomic_load_n(&s->Engine->State,__ATOMIC_ACQUIRE) == TSHARD_IDLE) || pthread_equal(pthread_self(),s->Thread);
+}
+
+// new stopped timer of the shard; from its owner or before TimerShardRun()
+static inline TimerHandle TimerShardCreate(TimerShardEngine *e, uint32_t shard)
+{
+    TimerHandle h = TimerWheelCreate(&e->Shard[shard].Wheel);
+
+    return (h == TIMER_HANDLE_NULL) ? h : (h | ((TimerHandle)shard << 48));
+}
+
+static inline bool TimerShardApply_(TimerShard *s, TimerHandle h, uint32_t op, uint32_t per)
+{
+    switch (op) {
+    case TSHARD_CMD_SET:
+        s->Arms++;
+        return TimerWheelSet(&s->Wheel,h,per);
+    case TSHARD_CMD_STOP:
+        return TimerWheelStop(&s->Wheel,h);
+    default:
+        return TimerWheelDestroy(&s->Wheel,h);
+    }
+}
+
+// from the owner: false for a stale handle; from other threads: false when the
+// command ring of the shard is full (a stale handle is ignored later)
+static inline bool TimerShardCommand_(TimerShardEngine *e, TimerHandle h, uint32_t op, uint32_t per)
+{
+    TimerShard *s = &e->Shard[TimerShardOf(h)];
+    TimerShardCommand c;
+    bool ok;
+
+    if (TimerShardOwner_(s)) {
+        return TimerShardApply_(s,h,op,per);
+    }
+    c.H = h;
+    c.Op = op;
+    c.Per = per;
+    TimerRingPush(s->Commands,TSHARD_COMMAND_RING,c,ok);
+    return ok;
+}
+
+// start (or restart) to expire per ticks from now (from the next tick of the
+// shard for other threads)
+static inline bool TimerShardSet(TimerShardEngine *e, TimerHandle h, uint32_t per)
+{
+    return TimerShardCommand_(e,h,TSHARD_CMD_SET,per);
+}
+
+static inline bool TimerShardStop(TimerShardEngine *e, TimerHandle h)
+{
+    return TimerShardCommand_(e,h,TSHARD_CMD_STOP,0u);
+}
+
+static inline bool TimerShardDestroy(TimerShardEngine *e, TimerHandle h)
+{
+    return TimerShardCommand_(e,h,TSHARD_CMD_DESTROY,0u);
+}
+
+// deque of the owner; false when full
+static inline bool TimerShardPush_(TimerShard *s, TimerHandle h)
+{
+    int64_t b = __atomic_load_n(&s->Bottom,__ATOMIC_RELAXED);
+    int64_t t = __atomic_load_n(&s->Top,__ATOMIC_ACQUIRE);
+
+    if (b - t >= (int64_t)TSHARD_DEQUE) {
+        return false;
+    }
+    __atomic_store_n(&s->Deque[b & (TSHARD_DEQUE - 1u)],h,__ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&s->Bottom,b + 1,__ATOMIC_RELAXED);
+    return true;
+}
+
+static inline bool TimerShardTake_(TimerShard *s, TimerHandle *h)
+{
+    int64_t b = __atomic_load_n(&s->Bottom,__ATOMIC_RELAXED) - 1;
+    int64_t t;
+    bool ok = true;
+
+    __atomic_store_n(&s->Bottom,b,__ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    t = __atomic_load_n(&s->Top,__ATOMIC_RELAXED);
+    if (t > b) {
+        __atomic_store_n(&s->Bottom,b + 1,__ATOMIC_RELAXED);
+        return false;
+    }
+    *h = __atomic_load_n(&s->Deque[b & (TSHARD_DEQUE - 1u)],__ATOMIC_RELAXED);
+    if (t == b) {
+        // the last one; race with the thieves
+        ok = __atomic_compare_exchange_n(&s->Top,&t,t + 1,false,__ATOMIC_SEQ_CST,__ATOMIC_RELAXED);
+        __atomic_store_n(&s->Bottom,b + 1,__ATOMIC_RELAXED);
+    }
+    return ok;
+}
+
+// from the other workers
+static inline bool TimerShardSteal_(TimerShard *s, TimerHandle *h)
+{
+    int64_t t = __atomic_load_n(&s->Top,__ATOMIC_ACQUIRE);
+    int64_t b;
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    b = __atomic_load_n(&s->Bottom,__ATOMIC_ACQUIRE);
+    if (t >= b) {
+        return false;
+    }
+    *h = __atomic_load_n(&s->Deque[t & (TSHARD_DEQUE - 1u)],__ATOMIC_RELAXED);
+    return __atomic_compare_exchange_n(&s->Top,&t,t + 1,false,__ATOMIC_SEQ_CST,__ATOMIC_RELAXED);
+}
+
+// commands of the other threads and the due ticks; true when there was work
+static inline bool TimerShardTick_(TimerShard *s)
+{
+    TimerShardEngine *e = s->Engine;
+    TimerShardCommand c;
+    TimerHandle h;
+    uint64_t due;
+    bool ok, busy = false;
+
+    for (;;) {
+        TimerRingPop(s->Commands,TSHARD_COMMAND_RING,c,ok);
+        if (ok == false) {
+            break;
+        }
+        TimerShardApply_(s,c.H,c.Op,c.Per);
+        busy = true;
+    }
+    due = (TimerShardNow_() - e->Start) / e->TickNs;
+    while (s->Ticks < due) {
+        s->Ticks++;
+        TimerWheelTick(&s->Wheel);
+        while ((h = TimerWheelNextExpired(&s->Wheel)) != TIMER_HANDLE_NULL) {
+            h |= (TimerHandle)s->Id << 48;
+            if (TimerShardPush_(s,h) == false) {
+                s->Expirations++;
+                e->Handler(h,e->Arg);
+            }
+            busy = true;
+        }
+    }
+    return busy;
+}
+
+static inline void *TimerShardWorker_(void *p)
+{
+    TimerShard *s = (TimerShard *)p;
+    TimerShardEngine *e = s->Engine;
+    TimerHandle h;
+    struct timespec ts;
+    uint64_t at;
+    uint32_t n, k, victim = s->Id;
+    bool busy;
+
+#if defined(_GNU_SOURCE)
+    cpu_set_t cpus;
+
+    CPU_ZERO(&cpus);
+    CPU_SET(s->Id % CPU_SETSIZE,&cpus);
+    pthread_setaffinity_np(pthread_self(),sizeof(cpus),&cpus);
+#endif  // defined(_GNU_SOURCE)
+    // the Thread fields are written when the state changes
+    while (__atomic_load_n(&e->State,__ATOMIC_ACQUIRE) == TSHARD_IDLE) {
+        sched_yield();
+    }
+    while (__atomic_load_n(&e->State,__ATOMIC_ACQUIRE) == TSHARD_RUNNING) {
+        busy = (e->Poller != NULL) && e->Poller(s->Id,e->Arg);
+        busy |= TimerShardTick_(s);
+        for (n = 0u; (n < TSHARD_BATCH) && TimerShardTake_(s,&h); n++) {
+            s->Expirations++;
+            e->Handler(h,e->Arg);
+        }
+        if (n == 0u) {
+            for (k = 1u; k < e->NShards; k++) {
+                victim = (victim + 1u == e->NShards) ? 0u : victim + 1u;
+                if ((victim != s->Id) && TimerShardSteal_(&e->Shard[victim],&h)) {
+                    s->Expirations++;
+                    s->Stolen++;
+                    e->Handler(h,e->Arg);
+                    n = 1u;
+                    break;
+                }
+            }
+        }
+        if ((busy == false) && (n == 0u)) {
+            // nothing to do before the next tick
+            at = e->Start + (s->Ticks + 1u) * e->TickNs;
+            ts.tv_sec = (time_t)(at / 1000000000uLL);
+            ts.tv_nsec = (long)(at % 1000000000uLL);
+            clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&ts,NULL);
+        }
+    }
+    return NULL;
+}
+
+static inline void TimerShardJoin_(TimerShardEngine *e, uint32_t n)
+{
+    uint32_t k;
+
+    __atomic_store_n(&e->State,TSHARD_STOPPING,__ATOMIC_RELEASE);
+    for (k = 0u; k < n; k++) {
+        pthread_join(e->Shard[k].Thread,NULL);
+    }
+    __atomic_store_n(&e->State,TSHARD_IDLE,__ATOMIC_RELEASE);
+}
+
+// stop and join of the workers; expirations not handled yet stay in the deques
+static inline void TimerShardShutdown(TimerShardEngine *e)
+{
+    TimerShardJoin_(e,e->NShards);
+}
+
+// start of the workers; tick 0 is now. When a thread cannot be created the
+// ones started are joined and false is returned; all shards stay for
+// TimerShardFree()
+static inline bool TimerShardRun(TimerShardEngine *e)
+{
+    uint32_t k;
+
+    e->Start = TimerShardNow_();
+    for (k = 0u; k < e->NShards; k++) {
+        if (pthread_create(&e->Shard[k].Thread,NULL,TimerShardWorker_,&e->Shard[k]) != 0) {
+            TimerShardJoin_(e,k);
+            return false;
+        }
+    }
+    __atomic_store_n(&e->State,TSHARD_RUNNING,__ATOMIC_RELEASE);
+    return true;
+}
+
+#endif  // !defined(timeshard_h_included)
+
+// End of timeshard.h
@@ -0,0 +1,424 @@
+/* timeshm.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if !defined(timeshm_h_included)
+#define timeshm_h_included
+
+// SHARED MEMORY TIMER SERVICE (Linux)
+// One daemon process owns the tick and keeps all timers in a POSIX shared memory
+// segment. Client processes arm and stop timers through a lock-free command ring
+// (no system calls), the daemon applies the commands at the start of every tick
+// and delivers expirations to per-client event rings. Clients sleep on a futex
+// word in the segment; the daemon wakes only clients that have new events.
+//
+// Timers are identified by id 0..TSHM_MAX_TIMERS-1; the applications assign the
+// ids like they assign names to DEFINE_* timers. An expiration is delivered to
+// the client that armed the timer last. Semantics are those of
+// SINGLE_PULSE_TIMER and CONTINUOUS_TIMER with 32-bit counters.
+//
+// daemon:                                  client:
+//   s = TimerShmCreate("/timers",10000000);  s = TimerShmAttach("/timers");
+//   TimerShmServe(s);                        c = TimerShmRegister(s);
+//                                            TimerShmSetSinglePulseTimer(s,c,5u,50u);
+//                                            n = TimerShmWait(s,c,ids,16u);
+//                                            TimerShmDetach(s,c);
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "timering.h"
+
+#if !defined(TSHM_MAX_TIMERS)
+#define TSHM_MAX_TIMERS     (4096u)
+#endif  // !defined(TSHM_MAX_TIMERS)
+#if !defined(TSHM_MAX_CLIENTS)
+#define TSHM_MAX_CLIENTS    (16u)
+#endif  // !defined(TSHM_MAX_CLIENTS)
+#if !defined(TSHM_COMMAND_RING)
+#define TSHM_COMMAND_RING   (1024u)     // power of 2
+#endif  // !defined(TSHM_COMMAND_RING)
+#if !defined(TSHM_EVENT_RING)
+#define TSHM_EVENT_RING     (1024u)     // power of 2
+#endif  // !defined(TSHM_EVENT_RING)
+
+#if (TSHM_MAX_CLIENTS > 32u) || (TSHM_MAX_TIMERS > 65535u)
+#error "timeshm.h: at most 32 clients and 65535 timers"
+#endif
+
+#define TSHM_MAGIC          (0x54534D31uL)  // "TSM1"
+
+// commands
+#define TSHM_CMD_SET_SINGLE_PULSE   (1u)
+#define TSHM_CMD_SET_CONTINUOUS     (2u)
+#define TSHM_CMD_STOP               (3u)
+#define TSHM_CMD_DETACH             (4u)
+
+// states of a client slot
+#define TSHM_CLIENT_FREE            (0u)
+#define TSHM_CLIENT_ATTACHED        (1u)
+#define TSHM_CLIENT_DETACHING       (2u)    // until the daemon has run the detach
+
+typedef struct {
+    uint8_t Op;
+    uint8_t Client;
+    uint16_t Id;
+    uint32_t Per;
+} TimerShmCommand;
+
+typedef struct {
+    uint32_t Counter;
+    uint32_t Setting;       // 0 for single pulse timers
+    uint16_t Active;        // position in the active list + 1, 0 when stopped
+    uint8_t Client;
+    uint8_t Reserved;
+} TimerShmTimer;
+
+typedef struct {
+    uint32_t Attached;      // TSHM_CLIENT_*
+    uint32_t Futex;         // changed by the daemon after events are pushed
+    uint32_t Waiters;
+    uint32_t Lost;          // expirations lost because the event ring was full
+    TIMER_RING(uint16_t,TSHM_EVENT_RING) Events;
+} TimerShmClient;
+
+typedef struct {
+    uint32_t Magic;
+    uint32_t Running;
+    uint64_t TickNs;
+    uint64_t Ticks;
+    uint32_t NActive;
+    uint32_t Pending;       // bit per client with events pushed in the current tick
+    TIMER_RING(TimerShmCommand,TSHM_COMMAND_RING) Commands;
+    TimerShmClient Client[TSHM_MAX_CLIENTS];
+    TimerShmTimer Timer[TSHM_MAX_TIMERS];
+    uint16_t Active[TSHM_MAX_TIMERS];
+} TimerShmSegment;
+
+static inline long TimerShmFutex(uint32_t *addr, int op, uint32_t val)
+{
+    return syscall(SYS_futex,addr,op,val,NULL,NULL,0);
+}
+
+static inline TimerShmSegment *TimerShmMap(const char *name, int oflag)
+{
+    TimerShmSegment *s;
+    int fd = shm_open(name,oflag,0600);
+
+    if (fd < 0) {
+        return NULL;
+    }
+    if (((oflag & O_CREAT) != 0) && (ftruncate(fd,(off_t)sizeof(TimerShmSegment)) != 0)) {
+        close(fd);
+        return NULL;
+    }
+    s = (TimerShmSegment *)mmap(NULL,sizeof(TimerShmSegment),PROT_READ | PROT_WRITE,MAP_SHARED,fd,0);
+    close(fd);
+    return (s == MAP_FAILED) ? NULL : s;
+}
+
+// daemon: creation of the segment; tick_ns - tick period in nanoseconds
+static inline TimerShmSegment *TimerShmCreate(const char *name, uint64_t tick_ns)
+{
+    TimerShmSegment *s = TimerShmMap(name,O_CREAT | O_RDWR | O_TRUNC);
+    uint32_t i;
+
+    if (s == NULL) {
+        return NULL;
+    }
+    s->TickNs = tick_ns;
+    s->Ticks = 0u;
+    s->NActive = 0u;
+    s->Pending = 0u;
+    TimerRingInit(s->Commands,TSHM_COMMAND_RING);
+    for (i = 0u; i < TSHM_MAX_CLIENTS; i++) {
+        s->Client[i].Attached = TSHM_CLIENT_FREE;
+        s->Client[i].Futex = 0u;
+        s->Client[i].Waiters = 0u;
+        s->Client[i].Lost = 0u;
+        TimerRingInit(s->Client[i].Events,TSHM_EVENT_RING);
+    }
+    s->Running = 1u;
+    __atomic_store_n(&s->Magic,TSHM_MAGIC,__ATOMIC_RELEASE);
+    return s;
+}
+
+// daemon: removal of the segment
+static inline void TimerShmDestroy(const char *name, TimerShmSegment *s)
+{
+    __atomic_store_n(&s->Magic,0u,__ATOMIC_RELEASE);
+    munmap(s,sizeof(TimerShmSegment));
+    shm_unlink(name);
+}
+
+// client: attach to an existing segment
+static inline TimerShmSegment *TimerShmAttach(const char *name)
+{
+    TimerShmSegment *s = TimerShmMap(name,O_RDWR);
+
+    if ((s != NULL) && (__atomic_load_n(&s->Magic,__ATOMIC_ACQUIRE) != TSHM_MAGIC)) {
+        munmap(s,sizeof(TimerShmSegment));
+        s = NULL;
+    }
+    return s;
+}
+
+// client: registration; returns the client number or -1 if all are taken
+static inline int TimerShmRegister(TimerShmSegment *s)
+{
+    uint32_t i, expected;
+
+    for (i = 0u; i < TSHM_MAX_CLIENTS; i++) {
+        expected = TSHM_CLIENT_FREE;
+        if (__atomic_compare_exchange_n(&s->Client[i].Attached,&expected,TSHM_CLIENT_ATTACHED,false,__ATOMIC_ACQ_REL,__ATOMIC_RELAXED)) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+static inline bool TimerShmCommand_(TimerShmSegment *s, uint8_t op, int client, uint16_t id, uint32_t per)
+{
+    TimerShmCommand c;
+    bool ok;
+
+    c.Op = op;
+    c.Client = (uint8_t)client;
+    c.Id = id;
+    c.Per = per;
+    TimerRingPush(s->Commands,TSHM_COMMAND_RING,c,ok);
+    return ok;
+}
+
+// client: arm and stop; no system calls; false if the command ring is full
+static inline bool TimerShmSetSinglePulseTimer(TimerShmSegment *s, int client, uint16_t id, uint32_t per)
+{
+    return TimerShmCommand_(s,TSHM_CMD_SET_SINGLE_PULSE,client,id,per);
+}
+static inline bool TimerShmSetContinuousTimer(TimerShmSegment *s, int client, uint16_t id, uint32_t per)
+{
+    return TimerShmCommand_(s,TSHM_CMD_SET_CONTINUOUS,client,id,per);
+}
+static inline bool TimerShmStopTimer(TimerShmSegment *s, int client, uint16_t id)
+{
+    return TimerShmCommand_(s,TSHM_CMD_STOP,client,id,0u);
+}
+
+// client: release of the client number and detach; the daemon stops the timers
+// of the client, empties its event ring and frees the number at its next tick,
+// a slot in TSHM_CLIENT_DETACHING is not given to TimerShmRegister()
+static inline void TimerShmDetach(TimerShmSegment *s, int client)
+{
+    struct timespec ts = { 0, 1000000L };
+
+    if (client >= 0) {
+        __atomic_store_n(&s->Client[client].Attached,TSHM_CLIENT_DETACHING,__ATOMIC_RELEASE);
+        while ((TimerShmCommand_(s,TSHM_CMD_DETACH,client,0u,0u) == false) &&
+                (__atomic_load_n(&s->Running,__ATOMIC_ACQUIRE) != 0u)) {
+            (void)nanosleep(&ts,NULL);
+        }
+    }
+    munmap(s,sizeof(TimerShmSegment));
+}
+
+// client: non-blocking retrieval of up to max expired timer ids
+static inline uint32_t TimerShmPoll(TimerShmSegment *s, int client, uint16_t *ids, uint32_t max)
+{
+    uint32_t n = 0u;
+    bool ok = true;
+
+    while ((n < max) && ok) {
+        TimerRingPop(s->Client[client].Events,TSHM_EVENT_RING,ids[n],ok);
+        if (ok) {
+            n++;
+        }
+    }
+    return n;
+}
+
+// client: blocking retrieval of up to max expired timer ids
+static inline uint32_t TimerShmWait(TimerShmSegment *s, int client, uint16_t *ids, uint32_t max)
+{
+    TimerShmClient *c = &s->Client[client];
+    uint32_t f, n;
+
+    for (;;) {
+        f = __atomic_load_n(&c->Futex,__ATOMIC_SEQ_CST);
+        n = TimerShmPoll(s,client,ids,max);
+        if ((n != 0u) || (__atomic_load_n(&s->Running,__ATOMIC_ACQUIRE) == 0u)) {
+            return n;
+        }
+        __atomic_add_fetch(&c->Waiters,1u,__ATOMIC_SEQ_CST);
+        TimerShmFutex(&c->Futex,FUTEX_WAIT,f);
+        __atomic_sub_fetch(&c->Waiters,1u,__ATOMIC_SEQ_CST);
+    }
+}
+
+static inline void TimerShmStart_(TimerShmSegment *s, uint16_t id)
+{
+    if (s->Timer[id].Active == 0u) {
+        s->Active[s->NActive] = id;
+        s->Timer[id].Active = (uint16_t)(++s->NActive);
+    }
+}
+
+static inline void TimerShmStop_(TimerShmSegment *s, uint16_t id)
+{
+    uint32_t pos = s->Timer[id].Active;
+    uint16_t last;
+
+    if (pos != 0u) {
+        last = s->Active[--s->NActive];
+        s->Active[pos - 1u] = last;
+        s->Timer[last].Active = (uint16_t)pos;
+        s->Timer[id].Active = 0u;
+    }
+}
+
+static inline void TimerShmEvent_(TimerShmSegment *s, uint8_t client, uint16_t id)
+{
+    bool ok;
+
+    if (client < TSHM_MAX_CLIENTS) {
+        TimerRingPush(s->Client[client].Events,TSHM_EVENT_RING,id,ok);
+        if (ok) {
+            s->Pending |= (1uL << client);
+        } else {
+            s->Client[client].Lost++;
+        }
+    }
+}
+
+// stop of the timers of a detached client, a clean event ring for the next one
+static inline void TimerShmDetach_(TimerShmSegment *s, uint8_t client)
+{
+    TimerShmClient *cl = &s->Client[client];
+    uint32_t i = 0u;
+
+    while (i < s->NActive) {
+        if (s->Timer[s->Active[i]].Client == client) {
+            TimerShmStop_(s,s->Active[i]);     // the last one moves to i
+        } else {
+            i++;
+        }
+    }
+    TimerRingInit(cl->Events,TSHM_EVENT_RING);
+    cl->Lost = 0u;
+    s->Pending &= ~(1uL << client);
+    __atomic_store_n(&cl->Attached,TSHM_CLIENT_FREE,__ATOMIC_RELEASE);
+}
+
+// daemon: one step of n ticks (n > 1 when the daemon was late)
+static inline void TimerShmTick(TimerShmSegment *s, uint32_t n)
+{
+    TimerShmCommand c;
+    TimerShmTimer *t;
+    TimerShmClient *cl;
+    uint32_t i, client;
+    bool ok = true;
+
+    for (;;) {
+        TimerRingPop(s->Commands,TSHM_COMMAND_RING,c,ok);
+        if (!ok) {
+            break;
+        }
+        if ((c.Id >= TSHM_MAX_TIMERS) || (c.Client >= TSHM_MAX_CLIENTS)) {
+            continue;
+        }
+        t = &s->Timer[c.Id];
+        if (c.Op == TSHM_CMD_DETACH) {
+            TimerShmDetach_(s,c.Client);
+        } else if (c.Op == TSHM_CMD_STOP) {
+            TimerShmStop_(s,c.Id);
+        } else if (c.Per != 0u) {
+            t->Counter = c.Per;
+            t->Setting = (c.Op == TSHM_CMD_SET_CONTINUOUS) ? c.Per : 0u;
+            t->Client = c.Client;
+            TimerShmStart_(s,c.Id);
+        }
+    }
+
+    i = 0u;
+    while (i < s->NActive) {
+        t = &s->Timer[s->Active[i]];
+        if (t->Counter > n) {
+            t->Counter -= n;
+            i++;
+        } else if (t->Setting != 0u) {
+            t->Counter = t->Setting - ((n - t->Counter) % t->Setting);
+            TimerShmEvent_(s,t->Client,s->Active[i]);
+            i++;
+        } else {
+            t->Counter = 0u;
+            TimerShmEvent_(s,t->Client,s->Active[i]);
+            TimerShmStop_(s,s->Active[i]);     // the last one moves to i
+        }
+    }
+    s->Ticks += n;
+
+    for (client = 0u; s->Pending != 0u; client++) {
+        if ((s->Pending & (1uL << client)) != 0u) {
+            s->Pending &= ~(1uL << client);
+            cl = &s->Client[client];
+            __atomic_add_fetch(&cl->Futex,1u,__ATOMIC_SEQ_CST);
+            if (__atomic_load_n(&cl->Waiters,__ATOMIC_SEQ_CST) != 0u) {
+                TimerShmFutex(&cl->Futex,FUTEX_WAKE,INT_MAX);
+            }
+        }
+    }
+}
+
+// daemon: tick loop, one wakeup per tick; returns after TimerShmShutdown()
+static inline void TimerShmServe(TimerShmSegment *s)
+{
+    struct timespec next, now;
+    uint64_t start, t, due;
+    uint32_t client;
+
+    clock_gettime(CLOCK_MONOTONIC,&now);
+    start = (uint64_t)now.tv_sec * 1000000000uLL + (uint64_t)now.tv_nsec - s->Ticks * s->TickNs;
+    while (__atomic_load_n(&s->Running,__ATOMIC_ACQUIRE) != 0u) {
+        t = start + (s->Ticks + 1u) * s->TickNs;
+        next.tv_sec = (time_t)(t / 1000000000uLL);
+        next.tv_nsec = (long)(t % 1000000000uLL);
+        while (clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&next,NULL) == EINTR) {
+        }
+        clock_gettime(CLOCK_MONOTONIC,&now);
+        due = ((uint64_t)now.tv_sec * 1000000000uLL + (uint64_t)now.tv_nsec - start) / s->TickNs;
+        if (due > s->Ticks) {
+            TimerShmTick(s,(uint32_t)(due - s->Ticks));
+        }
+    }
+    for (client = 0u; client < TSHM_MAX_CLIENTS; client++) {
+        __atomic_add_fetch(&s->Client[client].Futex,1u,__ATOMIC_SEQ_CST);
+        TimerShmFutex(&s->Client[client].Futex,FUTEX_WAKE,INT_MAX);
+    }
+}
+
+// stop of TimerShmServe() from a signal handler or another thread
+static inline void TimerShmShutdown(TimerShmSegment *s)
+{
+    __atomic_store_n(&s->Running,0u,__ATOMIC_RELEASE);
+}
+
+#endif  // !defined(timeshm_h_included)
+
+// End of timeshm.h
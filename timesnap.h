@@ -0,0 +1,310 @@
+/* timesnap.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if !defined(timesnap_h_included)
+#define timesnap_h_included
+
+// TIMER SNAPSHOT
+// checkpoint of the timers defined with DEFINE_* into a compact binary image
+// and restore from it with elapsed time catch-up
+//
+// image layout (native byte order)
+//
+//  +-------+---------+--------+---------------------+----------+
+//  | magic | version | layout | record ... record   | checksum |
+//  +-------+---------+--------+---------------------+----------+
+//      1        1        1                                2
+// magic - TSNAP_MAGIC
+// version - TSNAP_VERSION, format of the records
+// layout - defined by the application; change it when the list of saved timers changes
+// record - one per Snapshot* call: flags byte followed by the counters and settings
+// checksum - Fletcher-16 over all preceding bytes
+//
+// The image is a plain byte array: copy it to EEPROM/flash, or let the buffer
+// be an mmap'd file on a host. Every Snapshot* macro disables the interrupts
+// only while its own timer is copied. Restore* macros are called in the same
+// order as Snapshot* ones, when interrupts are disabled (at startup). elapsed is
+// the number of ticks passed since the snapshot was taken (0 if unknown).
+
+#define TSNAP_MAGIC     (0xA5u)
+#define TSNAP_VERSION   (1u)
+
+#define TSNAP_HEADER_SIZE   (3u)
+#define TSNAP_TRAILER_SIZE  (2u)
+
+// record sizes, for dimensioning of the image buffer
+#define TSNAP_SINGLE_PULSE_TIMER_SIZE(ttype) (1u + sizeof(ttype))
+#define TSNAP_CONTINUOUS_TIMER_SIZE(ttype) (1u + 2u * sizeof(ttype))
+#define TSNAP_CONST_CONTINUOUS_TIMER_SIZE(ttype) (1u + sizeof(ttype))
+#define TSNAP_CONST_FREE_CONTINUOUS_TIMER_SIZE(ttype) (1u + sizeof(ttype))
+#define TSNAP_FBSINGLE_PULSE_TIMER_SIZE(ttype) (1u + 2u * sizeof(ttype))
+#define TSNAP_FBVSINGLE_PULSE_TIMER_SIZE(ttype) (1u + 4u * sizeof(ttype))
+#define TSNAP_ASYMMETRIC_CONTINUOUS_TIMER_SIZE(ttype) (1u + 3u * sizeof(ttype))
+#define TSNAP_ASYMMETRIC_SINGLE_PULSE_TIMER_SIZE(ttype) (1u + 3u * sizeof(ttype))
+#define TSNAP_BURST_GENERATOR_SIZE(ttype) (3u + 4u * sizeof(ttype))
+
+// flags byte bits
+#define TSNAP_F0    (0x01u)
+#define TSNAP_F1    (0x02u)
+#define TSNAP_F2    (0x04u)
+#define TSNAP_F3    (0x08u)
+#define TSNAP_F4    (0x10u)
+
+#define TSNAP_Bit(b,f) (((b) == true) ? (f) : 0u)
+#define TSNAP_Flag(fl,f) ((((fl) & (f)) != 0u) ? true : false)
+
+// copy of a variable to / from the image; p is an uint8_t * cursor
+#define TSNAP_PutVar(p,v) { \
+    const uint8_t *s_ = (const uint8_t *)&(v); \
+    uint8_t n_ = (uint8_t)sizeof(v); \
+    do { \
+        *(p)++ = *s_++; \
+    } while (--n_ != 0u); \
+}
+#define TSNAP_GetVar(p,v) { \
+    uint8_t *d_ = (uint8_t *)&(v); \
+    uint8_t n_ = (uint8_t)sizeof(v); \
+    do { \
+        *d_++ = *(p)++; \
+    } while (--n_ != 0u); \
+}
+
+// Fletcher-16 of len bytes starting at b
+#define TSNAP_Checksum(b,len,s1,s2) { \
+    const uint8_t *c_ = (b); \
+    uint16_t l_ = (len); \
+    s1 = 0u; \
+    s2 = 0u; \
+    while (l_-- != 0u) { \
+        s1 = (uint8_t)((s1 + *c_++) % 255u); \
+        s2 = (uint8_t)((s2 + s1) % 255u); \
+    } \
+}
+
+// start of the image; p is set at the first record
+#define TimerSnapshotBegin(img,p,layout) { \
+    (p) = (img); \
+    *(p)++ = TSNAP_MAGIC; \
+    *(p)++ = TSNAP_VERSION; \
+    *(p)++ = (uint8_t)(layout); \
+}
+// end of the image; p is set after the checksum, image length is p - img
+#define TimerSnapshotEnd(img,p) { \
+    uint8_t s1_, s2_; \
+    TSNAP_Checksum((img),(uint16_t)((p) - (img)),s1_,s2_); \
+    *(p)++ = s1_; \
+    *(p)++ = s2_; \
+}
+// validation of an image of len bytes; ok receives true or false
+#define TimerSnapshotCheck(img,len,layout,ok) { \
+    uint8_t s1_, s2_; \
+    ok = false; \
+    if (((len) >= (TSNAP_HEADER_SIZE + TSNAP_TRAILER_SIZE)) && \
+        ((img)[0] == TSNAP_MAGIC) && ((img)[1] == TSNAP_VERSION) && ((img)[2] == (uint8_t)(layout))) { \
+        TSNAP_Checksum((img),(uint16_t)((len) - TSNAP_TRAILER_SIZE),s1_,s2_); \
+        if (((img)[(len) - 2u] == s1_) && ((img)[(len) - 1u] == s2_)) { \
+            ok = true; \
+        } \
+    } \
+}
+// start of restore from a checked image; p is set at the first record
+#define TimerRestoreBegin(img,p) { \
+    (p) = (img) + TSNAP_HEADER_SIZE; \
+}
+
+// SINGLE PULSE TIMER
+#define SnapshotSinglePulseTimer(x,p) { \
+    DisableInterrupts(); \
+    *(p)++ = (uint8_t)(TSNAP_Bit(ST_Flag_##x,TSNAP_F0) | TSNAP_Bit(ST_Expired_##x,TSNAP_F1)); \
+    TSNAP_PutVar(p,ST_Counter_##x); \
+    EnableInterrupts(); \
+}
+#define RestoreSinglePulseTimer(x,p,elapsed) { \
+    uint8_t f_ = *(p)++; \
+    ST_Flag_##x = TSNAP_Flag(f_,TSNAP_F0); \
+    ST_Expired_##x = TSNAP_Flag(f_,TSNAP_F1); \
+    TSNAP_GetVar(p,ST_Counter_##x); \
+    AdvanceSinglePulseTimer(x,elapsed); \
+}
+
+// CONTINUOUS TIMER
+#define SnapshotContinuousTimer(x,p) { \
+    DisableInterrupts(); \
+    *(p)++ = (uint8_t)(TSNAP_Bit(CT_Flag_##x,TSNAP_F0) | TSNAP_Bit(CT_Tick_##x,TSNAP_F1)); \
+    TSNAP_PutVar(p,CT_Counter_##x); \
+    TSNAP_PutVar(p,CT_Setting_##x); \
+    EnableInterrupts(); \
+}
+#define RestoreContinuousTimer(x,p,elapsed) { \
+    uint8_t f_ = *(p)++; \
+    CT_Flag_##x = TSNAP_Flag(f_,TSNAP_F0); \
+    CT_Tick_##x = TSNAP_Flag(f_,TSNAP_F1); \
+    TSNAP_GetVar(p,CT_Counter_##x); \
+    TSNAP_GetVar(p,CT_Setting_##x); \
+    AdvanceContinuousTimer(x,elapsed); \
+}
+
+// CONST_CONTINUOUS_TIMER
+#define SnapshotConstContinuousTimer(x,p) { \
+    DisableInterrupts(); \
+    *(p)++ = (uint8_t)(TSNAP_Bit(CCT_Flag_##x,TSNAP_F0) | TSNAP_Bit(CCT_Tick_##x,TSNAP_F1)); \
+    TSNAP_PutVar(p,CCT_Counter_##x); \
+    EnableInterrupts(); \
+}
+#define RestoreConstContinuousTimer(x,p,per,elapsed) { \
+    uint8_t f_ = *(p)++; \
+    CCT_Flag_##x = TSNAP_Flag(f_,TSNAP_F0); \
+    CCT_Tick_##x = TSNAP_Flag(f_,TSNAP_F1); \
+    TSNAP_GetVar(p,CCT_Counter_##x); \
+    AdvanceConstContinuousTimer(x,per,elapsed); \
+}
+
+// CONST_FREE_CONTINUOUS_TIMER
+#define SnapshotConstFreeContinuousTimer(x,p) { \
+    DisableInterrupts(); \
+    *(p)++ = (uint8_t)TSNAP_Bit(CFCT_Tick_##x,TSNAP_F1); \
+    TSNAP_PutVar(p,CFCT_Counter_##x); \
+    EnableInterrupts(); \
+}
+#define RestoreConstFreeContinuousTimer(x,p,per,elapsed) { \
+    uint8_t f_ = *(p)++; \
+    CFCT_Tick_##x = TSNAP_Flag(f_,TSNAP_F1); \
+    TSNAP_GetVar(p,CFCT_Counter_##x); \
+    AdvanceConstFreeContinuousTimer(x,per,elapsed); \
+}
+
+// FB_SINGLE_SHOT_TIMER
+#define SnapshotFBSinglePulseTimer(x,p) { \
+    DisableInterrupts(); \
+    *(p)++ = (uint8_t)(TSNAP_Bit(FBS_Flag_##x,TSNAP_F0) | TSNAP_Bit(FBS_Expired_##x,TSNAP_F1) | \
+        TSNAP_Bit(FBS_Direction_##x,TSNAP_F2)); \
+    TSNAP_PutVar(p,FBS_Counter_##x); \
+    TSNAP_PutVar(p,FBS_Setting_##x); \
+    EnableInterrupts(); \
+}
+#define RestoreFBSinglePulseTimer(x,p,elapsed) { \
+    uint8_t f_ = *(p)++; \
+    FBS_Flag_##x = TSNAP_Flag(f_,TSNAP_F0); \
+    FBS_Expired_##x = TSNAP_Flag(f_,TSNAP_F1); \
+    FBS_Direction_##x = TSNAP_Flag(f_,TSNAP_F2); \
+    TSNAP_GetVar(p,FBS_Counter_##x); \
+    TSNAP_GetVar(p,FBS_Setting_##x); \
+    AdvanceFBSinglePulseTimer(x,elapsed); \
+}
+
+// FBV_SINGLE_PULSE_TIMER
+#define SnapshotFBVSinglePulseTimer(x,p) { \
+    DisableInterrupts(); \
+    *(p)++ = (uint8_t)(TSNAP_Bit(FBVS_Flag_##x,TSNAP_F0) | TSNAP_Bit(FBVS_Expired_##x,TSNAP_F1) | \
+        TSNAP_Bit(FBVS_Direction_##x,TSNAP_F2)); \
+    TSNAP_PutVar(p,FBVS_Counter_##x); \
+    TSNAP_PutVar(p,FBVS_Setting_##x); \
+    TSNAP_PutVar(p,FBVS_StepF_##x); \
+    TSNAP_PutVar(p,FBVS_StepB_##x); \
+    EnableInterrupts(); \
+}
+#define RestoreFBVSinglePulseTimer(x,p,elapsed) { \
+    uint8_t f_ = *(p)++; \
+    FBVS_Flag_##x = TSNAP_Flag(f_,TSNAP_F0); \
+    FBVS_Expired_##x = TSNAP_Flag(f_,TSNAP_F1); \
+    FBVS_Direction_##x = TSNAP_Flag(f_,TSNAP_F2); \
+    TSNAP_GetVar(p,FBVS_Counter_##x); \
+    TSNAP_GetVar(p,FBVS_Setting_##x); \
+    TSNAP_GetVar(p,FBVS_StepF_##x); \
+    TSNAP_GetVar(p,FBVS_StepB_##x); \
+    AdvanceFBVSinglePulseTimer(x,elapsed); \
+}
+
+// ASYMMETRIC_CONTINUOUS_TIMER
+#define SnapshotAsymmetricContinuousTimer(x,p) { \
+    DisableInterrupts(); \
+    *(p)++ = (uint8_t)(TSNAP_Bit(ACT_Flag_##x,TSNAP_F0) | TSNAP_Bit(ACT_Tick_##x,TSNAP_F1) | \
+        TSNAP_Bit(ACT_State_##x,TSNAP_F2)); \
+    TSNAP_PutVar(p,ACT_Counter_##x); \
+    TSNAP_PutVar(p,ACT_SettingHigh_##x); \
+    TSNAP_PutVar(p,ACT_SettingLow_##x); \
+    EnableInterrupts(); \
+}
+#define RestoreAsymmetricContinuousTimer(x,p,elapsed) { \
+    uint8_t f_ = *(p)++; \
+    ACT_Flag_##x = TSNAP_Flag(f_,TSNAP_F0); \
+    ACT_Tick_##x = TSNAP_Flag(f_,TSNAP_F1); \
+    ACT_State_##x = TSNAP_Flag(f_,TSNAP_F2); \
+    TSNAP_GetVar(p,ACT_Counter_##x); \
+    TSNAP_GetVar(p,ACT_SettingHigh_##x); \
+    TSNAP_GetVar(p,ACT_SettingLow_##x); \
+    AdvanceAsymmetricContinuousTimer(x,elapsed); \
+}
+
+// ASYMMETRIC SINGLE PULSE TIMER
+#define SnapshotAsymmetricSinglePulseTimer(x,p) { \
+    DisableInterrupts(); \
+    *(p)++ = (uint8_t)(TSNAP_Bit(ASP_Flag_##x,TSNAP_F0) | TSNAP_Bit(ASP_Expired_##x,TSNAP_F1) | \
+        TSNAP_Bit(ASP_State_##x,TSNAP_F2) | TSNAP_Bit(ASP_sp_##x,TSNAP_F3) | \
+        TSNAP_Bit(ASP_SemiPeriod_Expired_##x,TSNAP_F4)); \
+    TSNAP_PutVar(p,ASP_Counter_##x); \
+    TSNAP_PutVar(p,ASP_SettingFirst_##x); \
+    TSNAP_PutVar(p,ASP_SettingSecond_##x); \
+    EnableInterrupts(); \
+}
+#define RestoreAsymmetricSinglePulseTimer(x,p,elapsed) { \
+    uint8_t f_ = *(p)++; \
+    ASP_Flag_##x = TSNAP_Flag(f_,TSNAP_F0); \
+    ASP_Expired_##x = TSNAP_Flag(f_,TSNAP_F1); \
+    ASP_State_##x = TSNAP_Flag(f_,TSNAP_F2); \
+    ASP_sp_##x = TSNAP_Flag(f_,TSNAP_F3); \
+    ASP_SemiPeriod_Expired_##x = TSNAP_Flag(f_,TSNAP_F4); \
+    TSNAP_GetVar(p,ASP_Counter_##x); \
+    TSNAP_GetVar(p,ASP_SettingFirst_##x); \
+    TSNAP_GetVar(p,ASP_SettingSecond_##x); \
+    AdvanceAsymmetricSinglePulseTimer(x,elapsed); \
+}
+
+// BURST GENERATOR
+#define SnapshotBurstGenerator(x,p) { \
+    DisableInterrupts(); \
+    *(p)++ = (uint8_t)(TSNAP_Bit(BG_Flag_##x,TSNAP_F0) | TSNAP_Bit(BG_Tick_##x,TSNAP_F1) | \
+        TSNAP_Bit(BG_state_##x,TSNAP_F2)); \
+    *(p)++ = BG_pulses_##x; \
+    *(p)++ = BG_pc_##x; \
+    TSNAP_PutVar(p,BG_Counter_##x); \
+    TSNAP_PutVar(p,BG_ht_##x); \
+    TSNAP_PutVar(p,BG_lt_##x); \
+    TSNAP_PutVar(p,BG_it_##x); \
+    EnableInterrupts(); \
+}
+#define RestoreBurstGenerator(x,p,elapsed) { \
+    uint8_t f_ = *(p)++; \
+    BG_Flag_##x = TSNAP_Flag(f_,TSNAP_F0); \
+    BG_Tick_##x = TSNAP_Flag(f_,TSNAP_F1); \
+    BG_state_##x = TSNAP_Flag(f_,TSNAP_F2); \
+    BG_pulses_##x = *(p)++; \
+    BG_pc_##x = *(p)++; \
+    TSNAP_GetVar(p,BG_Counter_##x); \
+    TSNAP_GetVar(p,BG_ht_##x); \
+    TSNAP_GetVar(p,BG_lt_##x); \
+    TSNAP_GetVar(p,BG_it_##x); \
+    AdvanceBurstGenerator(x,elapsed); \
+}
+// restore with output, the output is set according to the restored state
+#define RestoreBurstGeneratorWithOutput(x,p,elapsed,out) { \
+    RestoreBurstGenerator(x,p,0u); \
+    out = (BG_state_##x == BG_STATE_HIGH) ? highstate : lowstate; \
+    AdvanceBurstGeneratorWithOutput(x,elapsed,out); \
+}
+
+#endif  // !defined(timesnap_h_included)
+
+// End of timesnap.h
@@ -0,0 +1,200 @@
+/* timestats.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if !defined(timestats_h_included)
+#define timestats_h_included
+
+// PER-TIMER STATISTICS
+// Counters that show whether the main loop keeps up with the timer events. For
+// every watched event flag (Expired, Tick) there is a record of
+// - Fires      - the events
+// - Overruns   - events while the flag was still set: they were merged into
+//                the pending one and lost for the consumer
+// - Latency    - histogram of the ticks from the event to its clearing by the
+//                consumer: bin 0 is the same tick, bin k is 2^(k-1)..2^k-1
+//                ticks, the last bin collects the rest; MaxLatency is the worst
+// The records are in one table with a small header, so a debugger or a debug
+// interface can read it as a block; on the host it can be in shared memory
+// (TIMER_STATS_TABLE).
+//
+// The statistics are compiled in with TIMER_STATS only. Without it the macros
+// are the plain tick and clear.
+//
+//  enum { STAT_T1, STAT_G1 };                      // ids below TIMER_STATS_TIMERS
+//  DEFINE_TIMER_STATS
+//
+//  in the tick interrupt:
+//      TimerStatsTick();
+//      TickWithStats(SinglePulseTimerExpired(T1),STAT_T1,TickSinglePulseTimer(T1));
+//      TickWithStats(BurstGeneratorTick(G1),STAT_G1,TickBurstGeneratorWithOutput(G1,LATAbits.LATA1));
+//  in the main loop:
+//      if (SinglePulseTimerExpired(T1) == true) {
+//          ClearWithStats(SinglePulseTimerExpired(T1),STAT_T1);
+//          ...
+//      }
+//
+// TickWithStats runs in the context of the tick (interrupt), and the flag must
+// be a B1 variable. The tick and the consumer share only the flag: the tick
+// writes FiredAt only while the flag is clear, the consumer reads it before it
+// clears the flag.
+
+#include <stdint.h>
+#include <string.h>
+
+#if !defined(TIMER_STATS_TIMERS)
+#define TIMER_STATS_TIMERS  (8u)        // records in the table
+#endif  // !defined(TIMER_STATS_TIMERS)
+#if !defined(TIMER_STATS_BINS)
+#define TIMER_STATS_BINS    (8u)        // latency bins: 0, 1, 2-3, .. 64+ ticks
+#endif  // !defined(TIMER_STATS_BINS)
+#if !defined(TIMER_STATS_COUNT)
+#define TIMER_STATS_COUNT   uint16_t    // type of the counters, they saturate at TIMER_STATS_COUNT_MAX
+#define TIMER_STATS_COUNT_MAX (0xFFFFu)
+#endif  // !defined(TIMER_STATS_COUNT)
+#if !defined(TIMER_STATS_STAMP)
+#define TIMER_STATS_STAMP   uint16_t    // type of the tick stamps; latencies are modulo its range
+#endif  // !defined(TIMER_STATS_STAMP)
+
+#define TIMER_STATS_MAGIC   (0x54535453uL)  // "STST"
+#define TIMER_STATS_VERSION (1u)
+
+typedef struct {
+    TIMER_STATS_COUNT Fires;
+    TIMER_STATS_COUNT Overruns;
+    TIMER_STATS_STAMP FiredAt;      // tick of the pending event
+    TIMER_STATS_STAMP MaxLatency;
+    TIMER_STATS_COUNT Latency[TIMER_STATS_BINS];
+} TimerStats;
+
+typedef struct {
+    uint32_t Magic;
+    uint8_t Version;
+    uint8_t Timers;
+    uint8_t Bins;
+    uint8_t CountSize;              // sizeof(TIMER_STATS_COUNT)
+    TIMER_STATS_STAMP Now;          // ticks
+    TimerStats Timer[TIMER_STATS_TIMERS];
+} TimerStatsTable;
+
+#if !defined(TIMER_STATS_TABLE)
+#define TIMER_STATS_TABLE   TimerStats_ // the table object; (*p) for a table in shared memory
+#endif  // !defined(TIMER_STATS_TABLE)
+
+#if defined(TIMER_STATS)
+
+// definition in a C file
+#define DEFINE_TIMER_STATS TimerStatsTable TimerStats_ = { TIMER_STATS_MAGIC, TIMER_STATS_VERSION, \
+    TIMER_STATS_TIMERS, TIMER_STATS_BINS, sizeof(TIMER_STATS_COUNT), 0u, { { 0u } } };
+// declaration in a header file
+#define EXTERN_TIMER_STATS extern TimerStatsTable TimerStats_;
+
+// header of a table that is not defined with DEFINE_TIMER_STATS (shared memory)
+#define InitTimerStats(t) { \
+    memset(&(t),0,sizeof(TimerStatsTable)); \
+    (t).Magic = TIMER_STATS_MAGIC; \
+    (t).Version = TIMER_STATS_VERSION; \
+    (t).Timers = TIMER_STATS_TIMERS; \
+    (t).Bins = TIMER_STATS_BINS; \
+    (t).CountSize = sizeof(TIMER_STATS_COUNT); \
+}
+
+#define TimerStatsOf(id) (TIMER_STATS_TABLE.Timer[id])
+
+#define TimerStatsInc_(c) { \
+    if ((c) != TIMER_STATS_COUNT_MAX) { \
+        (c)++; \
+    } \
+}
+
+// at the start of every tick
+#define TimerStatsTick() { \
+    TIMER_STATS_TABLE.Now++; \
+}
+// after a catch-up of n ticks (Advance*)
+#define TimerStatsAdvance(n) { \
+    TIMER_STATS_TABLE.Now += (TIMER_STATS_STAMP)(n); \
+}
+
+// tick is the tick (or Advance) statement of the timer that sets flag
+#define TickWithStats(flag,id,tick) { \
+    B1 was_ = (flag); \
+    flag = false; \
+    tick; \
+    if ((flag) == true) { \
+        TimerStatsInc_(TimerStatsOf(id).Fires); \
+        if (was_ == true) { \
+            TimerStatsInc_(TimerStatsOf(id).Overruns); \
+        } else { \
+            TimerStatsOf(id).FiredAt = TIMER_STATS_TABLE.Now; \
+        } \
+    } else { \
+        flag = was_; \
+    } \
+}
+
+// clear of the flag by the consumer when interrupts are disabled
+#define ClearWithStatsI(flag,id) { \
+    if ((flag) == true) { \
+        TIMER_STATS_STAMP l_ = (TIMER_STATS_STAMP)(TIMER_STATS_TABLE.Now - TimerStatsOf(id).FiredAt); \
+        TIMER_STATS_STAMP v_ = l_; \
+        uint8_t b_ = 0u; \
+        while ((v_ != 0u) && (b_ < TIMER_STATS_BINS - 1u)) { \
+            v_ >>= 1; \
+            b_++; \
+        } \
+        TimerStatsInc_(TimerStatsOf(id).Latency[b_]); \
+        if (l_ > TimerStatsOf(id).MaxLatency) { \
+            TimerStatsOf(id).MaxLatency = l_; \
+        } \
+        flag = false; \
+    } \
+}
+// clear of the flag by the consumer
+#define ClearWithStats(flag,id) { \
+    DisableInterrupts(); \
+    ClearWithStatsI(flag,id); \
+    EnableInterrupts(); \
+}
+
+// zeroes the records; the header stays
+#define ResetTimerStats() { \
+    DisableInterrupts(); \
+    memset(TIMER_STATS_TABLE.Timer,0,sizeof(TIMER_STATS_TABLE.Timer)); \
+    EnableInterrupts(); \
+}
+
+#else   // defined(TIMER_STATS)
+
+#define DEFINE_TIMER_STATS
+#define EXTERN_TIMER_STATS
+#define InitTimerStats(t)
+#define TimerStatsTick()
+#define TimerStatsAdvance(n)
+#define TickWithStats(flag,id,tick) { \
+    tick; \
+}
+#define ClearWithStatsI(flag,id) { \
+    flag = false; \
+}
+#define ClearWithStats(flag,id) { \
+    flag = false; \
+}
+#define ResetTimerStats()
+
+#endif  // defined(TIMER_STATS)
+
+#endif  // !defined(timestats_h_included)
+
+// End of timestats.h
@@ -0,0 +1,548 @@
+/* timesync.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if !defined(timesync_h_included)
+#define timesync_h_included
+
+// TICK PHASE SYNCHRONIZATION
+// Several nodes share one tick timeline, so that continuous timers started on
+// the same tick number stay in phase on all of them although the clocks of the
+// nodes drift. One node is the reference: every Interval ticks it sends a
+// beacon with its tick number and the fraction of the tick elapsed. The other
+// nodes compare it with their own timeline at the arrival and correct it:
+// - an error over TIMER_SYNC_STEP (and the first beacon) is stepped: the tick
+//   number and phase are set to those of the reference
+// - a smaller error is slewed: a PI controller shortens or stretches the next
+//   ticks; the proportional part removes 1/TIMER_SYNC_KP of the error until the
+//   next beacon, the integral part follows the rate difference of the clocks
+// The period of a tick is changed by at most 1/TIMER_SYNC_MAX_SLEW.
+//
+// The servo does not depend on the system: it works in the units of a local
+// clock (TIMER_SYNC_TIME) and the port drives it:
+// - TimerSyncTick() when a tick ends; it returns the length of the next tick,
+//   to which the port programs its tick timer
+// - TimerSyncTicksDue() gives the ticks to hand to the timers (Advance*); it is
+//   1 except after a step
+// - TimerSyncInput() with a received beacon and the clock at its arrival; true
+//   when the end of the current tick moved (a step), which the port programs
+//   anew at TimerSyncTickEnd()
+// - TimerSyncBeaconOut() on the reference after a tick: the beacon to send
+//
+// Controller (XC8; int64_t is needed, PIC18 in C99 mode): the clock is the
+// tick timeline itself counted by the tick timer, e.g. with the TMR0 of
+// sample/demo.X in RTC_ADAPTIVE, where RTClockRead() - RTC_Base counts from the
+// start of the tick:
+//
+//  TimerSyncInit(&Sync,NODE,0u,RTC_COUNTS,10u,0);
+//  tick interrupt (TMR0 overflow):
+//      RTClockSyncProgram((uint16_t)TimerSyncTick(&Sync),RTClockRead());
+//      n = TimerSyncTicksDue(&Sync);       // Advance* of the timers by n
+//  beacon from the UART or CAN, interrupts disabled:
+//      now = TimerSyncTickStart(&Sync) + (uint16_t)(RTClockRead() - RTC_Base);
+//      if (TimerSyncInput(&Sync,b,n,now) == true) {
+//          RTClockSyncProgram((uint16_t)(TimerSyncTickEnd(&Sync) - TimerSyncTickStart(&Sync)),
+//                  (uint16_t)(now - TimerSyncTickStart(&Sync)));
+//      }
+//
+// RTClockSyncProgram(c,e) is RTClockProgram() of timeadapt.h for a tick of c
+// counts of which e have elapsed: TMR0 = e + (0 - c), RTC_Base = 0 - c.
+//
+// Linux: TimerSyncOpen() and TimerSyncWait() run the servo in CLOCK_MONOTONIC
+// nanoseconds and sleep in pselect() on the transport to the next tick:
+//
+//  TimerSyncUdp u;
+//  TimerSyncTransport tr;
+//  TimerSync s;
+//  TimerSyncUdpOpen(&u,&tr,5000u + node);
+//  TimerSyncUdpPeer(&u,5001u);             // reference: the ports of the others
+//  TimerSyncOpen(&s,&tr,node,0u,10000000uLL,10u);
+//  for (;;) {
+//      n = TimerSyncWait(&s);              // sleeps, takes the beacons
+//      AdvanceContinuousTimer(T1,n);       // n is 1 except after a step
+//  }
+//
+// The continuous timers have to be started on the same tick number on all nodes,
+// e.g. when TimerSyncTicks(&s) % per == 0. After a step forward the skipped
+// ticks are due too; after a step back no tick is due until the timeline comes
+// to the last tick handed out again.
+// The transport is a datagram one: Send/Recv of whole beacons and a descriptor
+// for select(). UDP (loopback or LAN) and pipe transports are here; the delay of
+// the transport is taken as TIMER_SYNC_DELAY (clock units).
+// sample/bench/syncbench.c runs a reference and a drifting follower.
+//
+// Metrics: PhaseError (last error in 1/65536 tick), MaxError (worst absolute
+// error since the lock), Locked (TIMER_SYNC_LOCK_COUNT beacons in a row within
+// TIMER_SYNC_LOCK), Convergence (ticks from the last step or loss of the lock to
+// the lock), Beacons and Steps.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#if !defined(TIMER_SYNC_TIME)
+#define TIMER_SYNC_TIME     int64_t     // local clock: ns on Linux, timer counts on a controller
+#endif  // !defined(TIMER_SYNC_TIME)
+#if !defined(TIMER_SYNC_STEP)
+#define TIMER_SYNC_STEP     (0x4000)    // errors over a quarter of a tick are stepped
+#endif  // !defined(TIMER_SYNC_STEP)
+#if !defined(TIMER_SYNC_KP)
+#define TIMER_SYNC_KP       (2)         // part of the error slewed until the next beacon
+#define TIMER_SYNC_KI       (8)         // integral gain divider
+#endif  // !defined(TIMER_SYNC_KP)
+#if !defined(TIMER_SYNC_MAX_SLEW)
+#define TIMER_SYNC_MAX_SLEW (20)        // a tick is changed by 1/20 of the period at most
+#endif  // !defined(TIMER_SYNC_MAX_SLEW)
+#if !defined(TIMER_SYNC_LOCK)
+#define TIMER_SYNC_LOCK     (655)       // 1/100 of a tick
+#define TIMER_SYNC_LOCK_COUNT (4u)
+#endif  // !defined(TIMER_SYNC_LOCK)
+#if !defined(TIMER_SYNC_DELAY)
+#define TIMER_SYNC_DELAY    (0)         // delay of the transport
+#endif  // !defined(TIMER_SYNC_DELAY)
+#if !defined(TIMER_SYNC_PEERS)
+#define TIMER_SYNC_PEERS    (8u)        // destinations of an UDP transport
+#endif  // !defined(TIMER_SYNC_PEERS)
+
+#define TIMER_SYNC_MAGIC    (0x5354u)   // "TS"
+#define TIMER_SYNC_VERSION  (1u)
+#define TIMER_SYNC_BEACON   (12u)       // bytes of a beacon
+
+// beacon, little endian on the wire:
+// Magic:16, Version:8, Node:8, Ticks:32, Phase:16 (1/65536 tick), Seq:16
+typedef struct {
+    uint8_t Node;
+    uint32_t Ticks;
+    uint16_t Phase;
+    uint16_t Seq;
+} TimerSyncBeacon;
+
+typedef struct {
+    int Fd;                                                 // readable when a beacon came
+    int (*Send)(void *ctx, const uint8_t *b, uint32_t n);
+    int (*Recv)(void *ctx, uint8_t *b, uint32_t n);         // non-blocking; bytes or <= 0
+    void *Ctx;
+} TimerSyncTransport;
+
+typedef struct {
+    TimerSyncTransport *Transport;  // Linux
+    uint8_t Node;
+    uint8_t Reference;      // node of the reference timeline
+    uint16_t Interval;      // ticks between the beacons of the reference
+    uint16_t Seq;
+    TIMER_SYNC_TIME Tick;   // nominal period
+    TIMER_SYNC_TIME Last;   // local time of tick Ticks
+    TIMER_SYNC_TIME Next;   // and of the next one
+    uint32_t Ticks;         // tick number of the shared timeline
+    uint32_t Applied;       // ticks handed out by TimerSyncTicksDue
+    int64_t Freq;           // rate correction in 1/1024 clock units per tick
+    int64_t Slew;           // phase correction per tick, also in 1/1024
+    int64_t Rest;           // parts of a clock unit carried to the next ticks
+    uint32_t SlewTicks;
+    uint32_t RemoteTicks;   // of the previous beacon
+    uint32_t LockFrom;      // tick of the last step or loss of the lock
+    uint8_t Synced;
+    uint8_t Good;           // beacons in a row within TIMER_SYNC_LOCK
+    // metrics
+    uint8_t Locked;
+    int32_t PhaseError;
+    uint32_t MaxError;
+    uint32_t Convergence;
+    uint32_t Beacons;
+    uint32_t Steps;
+} TimerSync;
+
+static inline void TimerSyncEncode(uint8_t *b, const TimerSyncBeacon *m)
+{
+    b[0] = (uint8_t)TIMER_SYNC_MAGIC;
+    b[1] = (uint8_t)(TIMER_SYNC_MAGIC >> 8);
+    b[2] = TIMER_SYNC_VERSION;
+    b[3] = m->Node;
+    b[4] = (uint8_t)m->Ticks;
+    b[5] = (uint8_t)(m->Ticks >> 8);
+    b[6] = (uint8_t)(m->Ticks >> 16);
+    b[7] = (uint8_t)(m->Ticks >> 24);
+    b[8] = (uint8_t)m->Phase;
+    b[9] = (uint8_t)(m->Phase >> 8);
+    b[10] = (uint8_t)m->Seq;
+    b[11] = (uint8_t)(m->Seq >> 8);
+}
+
+// false for a datagram that is not a beacon
+static inline bool TimerSyncDecode(const uint8_t *b, uint32_t n, TimerSyncBeacon *m)
+{
+    if ((n != TIMER_SYNC_BEACON) || (b[0] != (uint8_t)TIMER_SYNC_MAGIC) ||
+            (b[1] != (uint8_t)(TIMER_SYNC_MAGIC >> 8)) || (b[2] != TIMER_SYNC_VERSION)) {
+        return false;
+    }
+    m->Node = b[3];
+    m->Ticks = (uint32_t)b[4] | ((uint32_t)b[5] << 8) | ((uint32_t)b[6] << 16) | ((uint32_t)b[7] << 24);
+    m->Phase = (uint16_t)(b[8] | (b[9] << 8));
+    m->Seq = (uint16_t)(b[10] | (b[11] << 8));
+    return true;
+}
+
+// tick is the nominal period, now the local time of the start of tick 0;
+// interval is used by the reference only
+static inline void TimerSyncInit(TimerSync *s, uint8_t node, uint8_t reference, TIMER_SYNC_TIME tick, uint16_t interval, TIMER_SYNC_TIME now)
+{
+    memset(s,0,sizeof(*s));
+    s->Node = node;
+    s->Reference = reference;
+    s->Interval = (interval != 0u) ? interval : 1u;
+    s->Tick = tick;
+    s->Last = now;
+    s->Next = now + tick;
+    s->Locked = (node == reference) ? 1u : 0u;
+}
+
+#define TimerSyncTicks(s) ((s)->Ticks)
+#define TimerSyncLocked(s) ((s)->Locked != 0u)
+#define TimerSyncTickStart(s) ((s)->Last)
+#define TimerSyncTickEnd(s) ((s)->Next)
+
+// phase of the local timeline at time t in 1/65536 tick since tick Ticks
+static inline int64_t TimerSyncPhase_(const TimerSync *s, TIMER_SYNC_TIME t)
+{
+    return (int64_t)(t - s->Last) * 65536 / (int64_t)(s->Next - s->Last);
+}
+
+// the local timeline is moved by e (1/65536 tick): the whole ticks to the tick
+// number, the fraction to the start of the tick
+static inline void TimerSyncStep_(TimerSync *s, TIMER_SYNC_TIME now, int64_t e)
+{
+    int64_t w = (e >= 0) ? e / 65536 : -((-e + 65535) / 65536);
+
+    s->Ticks += (uint32_t)w;
+    s->Last -= (TIMER_SYNC_TIME)((e - w * 65536) * (int64_t)s->Tick / 65536);
+    while (now - s->Last >= s->Tick) {
+        s->Ticks++;
+        s->Last += s->Tick;
+    }
+    s->Next = s->Last + s->Tick;
+    s->Slew = 0;
+    s->SlewTicks = 0u;
+    s->Steps++;
+    s->LockFrom = s->Ticks;
+}
+
+// true after a step
+static inline bool TimerSyncBeacon_(TimerSync *s, const TimerSyncBeacon *m, TIMER_SYNC_TIME now)
+{
+    int64_t e, ens, lim;
+    uint32_t a, interval;
+
+    e = ((int64_t)(int32_t)(m->Ticks - s->Ticks) << 16) + (int64_t)m->Phase - TimerSyncPhase_(s,now) +
+            (int64_t)TIMER_SYNC_DELAY * 65536 / (int64_t)s->Tick;
+    s->Beacons++;
+    s->PhaseError = (e > INT32_MAX) ? INT32_MAX : (e < INT32_MIN) ? INT32_MIN : (int32_t)e;
+    if ((s->Synced == 0u) || (e > TIMER_SYNC_STEP) || (e < -TIMER_SYNC_STEP)) {
+        TimerSyncStep_(s,now,e);
+        s->Synced = 1u;
+        s->RemoteTicks = m->Ticks;
+        s->Good = 0u;
+        s->Locked = 0u;
+        return true;
+    }
+
+    // PI: the integral is the rate, the proportional part is spread over the
+    // ticks to the next beacon
+    interval = m->Ticks - s->RemoteTicks;
+    if ((interval == 0u) || (interval > 0x10000u)) {
+        interval = 1u;
+    }
+    s->RemoteTicks = m->Ticks;
+    ens = e * (int64_t)s->Tick / 64;    // in 1/1024 clock units
+    lim = (int64_t)s->Tick * 1024 / TIMER_SYNC_MAX_SLEW;
+    s->Freq += ens / ((int64_t)interval * TIMER_SYNC_KI);
+    s->Freq = (s->Freq > lim) ? lim : (s->Freq < -lim) ? -lim : s->Freq;
+    s->Slew = ens / TIMER_SYNC_KP / (int64_t)interval;
+    s->SlewTicks = interval;
+
+    a = (uint32_t)((e < 0) ? -e : e);
+    if (a <= TIMER_SYNC_LOCK) {
+        if ((s->Locked == 0u) && (++s->Good >= TIMER_SYNC_LOCK_COUNT)) {
+            s->Locked = 1u;
+            s->MaxError = 0u;
+            s->Convergence = s->Ticks - s->LockFrom;
+        }
+    } else {
+        if (s->Locked != 0u) {
+            s->LockFrom = s->Ticks;
+        }
+        s->Good = 0u;
+        s->Locked = 0u;
+    }
+    if ((s->Locked != 0u) && (a > s->MaxError)) {
+        s->MaxError = a;
+    }
+    return false;
+}
+
+// beacon datagram b of n bytes that came at the local time now; true when the
+// end of the current tick moved
+static inline bool TimerSyncInput(TimerSync *s, const uint8_t *b, uint32_t n, TIMER_SYNC_TIME now)
+{
+    TimerSyncBeacon m;
+
+    if ((TimerSyncDecode(b,n,&m) == true) && (m.Node == s->Reference) && (s->Node != s->Reference)) {
+        return TimerSyncBeacon_(s,&m,now);
+    }
+    return false;
+}
+
+// the current tick ended; returns the length of the next one
+static inline TIMER_SYNC_TIME TimerSyncTick(TimerSync *s)
+{
+    int64_t d, lim = (int64_t)s->Tick / TIMER_SYNC_MAX_SLEW;
+
+    s->Rest += s->Freq;
+    if (s->SlewTicks != 0u) {
+        s->SlewTicks--;
+        s->Rest += s->Slew;
+    }
+    d = s->Rest / 1024;
+    s->Rest -= d * 1024;
+    d = (d > lim) ? lim : (d < -lim) ? -lim : d;
+    s->Ticks++;
+    s->Last = s->Next;
+    s->Next = s->Last + s->Tick - (TIMER_SYNC_TIME)d;
+    return s->Next - s->Last;
+}
+
+// ticks to hand to the timers since the last call; 0 while the timeline comes
+// back after a step back
+static inline uint32_t TimerSyncTicksDue(TimerSync *s)
+{
+    uint32_t n = s->Ticks - s->Applied;
+
+    if ((n == 0u) || (n >= 0x80000000uL)) {
+        return 0u;
+    }
+    s->Applied = s->Ticks;
+    return n;
+}
+
+// reference, after TimerSyncTick: the beacon of the tick into b (TIMER_SYNC_BEACON
+// bytes) when one is due; now is the local time
+static inline bool TimerSyncBeaconOut(TimerSync *s, uint8_t *b, TIMER_SYNC_TIME now)
+{
+    TimerSyncBeacon m;
+    int64_t p;
+
+    if ((s->Node != s->Reference) || (s->Ticks % s->Interval != 0u)) {
+        return false;
+    }
+    // a late port may be past the end of the tick
+    p = TimerSyncPhase_(s,now);
+    m.Node = s->Node;
+    m.Ticks = s->Ticks + (uint32_t)(p >> 16);
+    m.Phase = (uint16_t)p;
+    m.Seq = s->Seq++;
+    TimerSyncEncode(b,&m);
+    return true;
+}
+
+#if !defined(__XC8)
+
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+
+static inline int64_t TimerSyncNow_(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// tick_ns is the nominal period; interval is used by the reference only
+static inline void TimerSyncOpen(TimerSync *s, TimerSyncTransport *t, uint8_t node, uint8_t reference, uint64_t tick_ns, uint16_t interval)
+{
+    TimerSyncInit(s,node,reference,(TIMER_SYNC_TIME)tick_ns,interval,TimerSyncNow_());
+    s->Transport = t;
+}
+
+static inline void TimerSyncReceive_(TimerSync *s)
+{
+    uint8_t b[64];
+    int n;
+
+    while ((n = s->Transport->Recv(s->Transport->Ctx,b,sizeof(b))) > 0) {
+        (void)TimerSyncInput(s,b,(uint32_t)n,TimerSyncNow_());
+    }
+}
+
+// sleeps to the next tick of the timeline, taking the beacons on the way;
+// returns the ticks to hand to the timers
+static inline uint32_t TimerSyncWait(TimerSync *s)
+{
+    fd_set r;
+    struct timespec ts;
+    uint8_t b[TIMER_SYNC_BEACON];
+    int64_t now, d;
+    uint32_t n;
+
+    for (;;) {
+        now = TimerSyncNow_();
+        if (now < s->Next) {
+            d = s->Next - now;
+            ts.tv_sec = (time_t)(d / 1000000000LL);
+            ts.tv_nsec = (long)(d % 1000000000LL);
+            if ((s->Transport != NULL) && (s->Transport->Fd >= 0)) {
+                FD_ZERO(&r);
+                FD_SET(s->Transport->Fd,&r);
+                if (pselect(s->Transport->Fd + 1,&r,NULL,NULL,&ts,NULL) > 0) {
+                    TimerSyncReceive_(s);
+                }
+            } else {
+                (void)nanosleep(&ts,NULL);
+            }
+            continue;
+        }
+        (void)TimerSyncTick(s);
+        if ((s->Transport != NULL) && (TimerSyncBeaconOut(s,b,now) == true)) {
+            (void)s->Transport->Send(s->Transport->Ctx,b,TIMER_SYNC_BEACON);
+        }
+        if ((n = TimerSyncTicksDue(s)) != 0u) {
+            return n;
+        }
+    }
+}
+
+// UDP TRANSPORT
+typedef struct {
+    int Fd;
+    uint8_t Peers;
+    struct sockaddr_in Peer[TIMER_SYNC_PEERS];
+} TimerSyncUdp;
+
+static inline int TimerSyncUdpSend_(void *ctx, const uint8_t *b, uint32_t n)
+{
+    TimerSyncUdp *u = (TimerSyncUdp *)ctx;
+    uint8_t i;
+
+    for (i = 0u; i < u->Peers; i++) {
+        (void)sendto(u->Fd,b,n,0,(const struct sockaddr *)&u->Peer[i],sizeof(u->Peer[i]));
+    }
+    return (int)n;
+}
+
+static inline int TimerSyncUdpRecv_(void *ctx, uint8_t *b, uint32_t n)
+{
+    return (int)recv(((TimerSyncUdp *)ctx)->Fd,b,n,MSG_DONTWAIT);
+}
+
+// socket bound to port of the loopback interface (INADDR_ANY with addr); -1 at an error
+static inline int TimerSyncUdpOpenAddr(TimerSyncUdp *u, TimerSyncTransport *t, uint32_t addr, uint16_t port)
+{
+    struct sockaddr_in a;
+
+    memset(u,0,sizeof(*u));
+    u->Fd = socket(AF_INET,SOCK_DGRAM | SOCK_CLOEXEC,0);
+    if (u->Fd < 0) {
+        return -1;
+    }
+    memset(&a,0,sizeof(a));
+    a.sin_family = AF_INET;
+    a.sin_port = htons(port);
+    a.sin_addr.s_addr = htonl(addr);
+    if (bind(u->Fd,(const struct sockaddr *)&a,sizeof(a)) != 0) {
+        close(u->Fd);
+        u->Fd = -1;
+        return -1;
+    }
+    t->Fd = u->Fd;
+    t->Send = TimerSyncUdpSend_;
+    t->Recv = TimerSyncUdpRecv_;
+    t->Ctx = u;
+    return 0;
+}
+
+#define TimerSyncUdpOpen(u,t,port) TimerSyncUdpOpenAddr(u,t,INADDR_LOOPBACK,port)
+
+// destination of the beacons (the reference sends them); -1 when full
+static inline int TimerSyncUdpPeerAddr(TimerSyncUdp *u, uint32_t addr, uint16_t port)
+{
+    if (u->Peers == TIMER_SYNC_PEERS) {
+        return -1;
+    }
+    memset(&u->Peer[u->Peers],0,sizeof(u->Peer[0]));
+    u->Peer[u->Peers].sin_family = AF_INET;
+    u->Peer[u->Peers].sin_port = htons(port);
+    u->Peer[u->Peers].sin_addr.s_addr = htonl(addr);
+    u->Peers++;
+    return 0;
+}
+
+#define TimerSyncUdpPeer(u,port) TimerSyncUdpPeerAddr(u,INADDR_LOOPBACK,port)
+
+static inline void TimerSyncUdpClose(TimerSyncUdp *u)
+{
+    if (u->Fd >= 0) {
+        close(u->Fd);
+        u->Fd = -1;
+    }
+}
+
+// PIPE TRANSPORT
+// one direction of a pipe(); the beacons are written in one piece, so they are
+// not split
+typedef struct {
+    int ReadFd;
+    int WriteFd;
+} TimerSyncPipe;
+
+static inline int TimerSyncPipeSend_(void *ctx, const uint8_t *b, uint32_t n)
+{
+    TimerSyncPipe *p = (TimerSyncPipe *)ctx;
+
+    return (p->WriteFd >= 0) ? (int)write(p->WriteFd,b,n) : -1;
+}
+
+static inline int TimerSyncPipeRecv_(void *ctx, uint8_t *b, uint32_t n)
+{
+    TimerSyncPipe *p = (TimerSyncPipe *)ctx;
+
+    if (p->ReadFd < 0) {
+        return -1;
+    }
+    // one beacon at a time
+    return (int)read(p->ReadFd,b,(n < TIMER_SYNC_BEACON) ? n : TIMER_SYNC_BEACON);
+}
+
+// rfd or wfd may be -1; rfd is made non-blocking
+static inline void TimerSyncPipeOpen(TimerSyncPipe *p, TimerSyncTransport *t, int rfd, int wfd)
+{
+    p->ReadFd = rfd;
+    p->WriteFd = wfd;
+    if (rfd >= 0) {
+        (void)fcntl(rfd,F_SETFL,fcntl(rfd,F_GETFL) | O_NONBLOCK);
+    }
+    t->Fd = rfd;
+    t->Send = TimerSyncPipeSend_;
+    t->Recv = TimerSyncPipeRecv_;
+    t->Ctx = p;
+}
+
+#endif  // !defined(__XC8)
+
+#endif  // !defined(timesync_h_included)
+
+// End of timesync.h
@@ -0,0 +1,245 @@
+/* timetrace.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if !defined(timetrace_h_included)
+#define timetrace_h_included
+
+// GOLDEN TRACES (host)
+// A trace is the stream of the commands given to the timers - Set, Stop, change
+// of direction or setting - each with the tick it was given at, followed by the
+// events (Expired/Tick flags) that the timers of timedefs.h produce for it. An
+// engine that replaces the macros (wheel, pool, bank, table driven kernel) has
+// to give the same events on the same ticks; sample/bench/tracebench.c replays a
+// trace against an engine, compares the events and measures its speed.
+//
+// A host build of the application records its commands with the Trace* macros
+// below, which record and then do the command, and TimerTraceTick() in its
+// tick; tracebench import adds the events of the reference engine to such a
+// trace.
+//
+//  TimerTraceWriter w;
+//  TimerTraceCreate(&w,"app.trc",16u);
+//  TraceSetSinglePulseTimer(&w,0u,T1,50u);
+//  in the tick: TimerTraceTick(&w,1u);
+//  TimerTraceClose(&w);
+//
+// File: a header and records of 24 bytes in the byte order of the host. A
+// command with Tick t is given after t ticks, before tick t + 1; an event with
+// Tick t is produced by tick t or by a command with Tick t (a Stop of a burst
+// generator sets its Tick, a change of the FBV setting may expire it, a Set of
+// an asymmetric single pulse timer with first 0 ends its first phase). The
+// events of tick t are written before the commands of t, the ones of the
+// commands after them, each group in the order of kind and id. Ids are per
+// kind, below Timers. The phases of a burst bank are fixed by the trace (see
+// TIMER_TRACE_BANK_CHANNELS), so the bank has no Trace* macro.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TIMER_TRACE_MAGIC   (0x43525454uL)  // "TTRC"
+#define TIMER_TRACE_VERSION (1u)
+
+// operations
+#define TIMER_TRACE_SET         (1u)    // arguments of the Set* macro
+#define TIMER_TRACE_STOP        (2u)
+#define TIMER_TRACE_DIRECTION   (3u)    // FBV: A = 1 forward
+#define TIMER_TRACE_SETTING     (4u)    // FBV: A = setting; ACT: A = high, B = low
+#define TIMER_TRACE_EVENT       (5u)    // Expired or Tick flag set; ASP: end of either phase
+
+// kinds and the arguments of TIMER_TRACE_SET
+#define TIMER_TRACE_SINGLE_PULSE    (0u)    // A = per
+#define TIMER_TRACE_CONTINUOUS      (1u)    // A = per
+#define TIMER_TRACE_FBV             (2u)    // A = per, B = stepF, C = stepB, D = 1 forward
+#define TIMER_TRACE_ASYMMETRIC      (3u)    // A = high, B = low
+#define TIMER_TRACE_BURST           (4u)    // A = pulses, B = ht, C = lt, D = it
+#define TIMER_TRACE_ASYMMETRIC_SP   (5u)    // A = first, B = second, C = 1 high first
+#define TIMER_TRACE_BANK            (6u)    // A = pulses, B = ht, C = lt, D = it
+#define TIMER_TRACE_KINDS           (7u)
+
+// a burst bank of a trace has these channels, channel c delayed by c / CHANNELS
+// of the package period
+#define TIMER_TRACE_BANK_CHANNELS   (4u)
+
+typedef struct {
+    uint32_t Magic;
+    uint16_t Version;
+    uint16_t RecordSize;
+    uint32_t Timers;        // per kind
+    uint32_t Ticks;         // length of the trace
+    uint32_t Records;
+    uint32_t Events;
+} TimerTraceHeader;
+
+typedef struct {
+    uint32_t Tick;
+    uint8_t Op;
+    uint8_t Kind;
+    uint16_t Id;
+    uint32_t A;
+    uint32_t B;
+    uint32_t C;
+    uint32_t D;
+} TimerTraceRecord;
+
+typedef struct {
+    FILE *F;
+    TimerTraceHeader H;
+    uint32_t Now;
+} TimerTraceWriter;
+
+// false when the file cannot be created
+static inline bool TimerTraceCreate(TimerTraceWriter *w, const char *path, uint32_t timers)
+{
+    memset(w,0,sizeof(*w));
+    w->H.Magic = TIMER_TRACE_MAGIC;
+    w->H.Version = TIMER_TRACE_VERSION;
+    w->H.RecordSize = sizeof(TimerTraceRecord);
+    w->H.Timers = timers;
+    w->F = fopen(path,"wb");
+    return (w->F != NULL) && (fwrite(&w->H,sizeof(w->H),1u,w->F) == 1u);
+}
+
+static inline void TimerTraceTick(TimerTraceWriter *w, uint32_t n)
+{
+    w->Now += n;
+}
+
+static inline void TimerTraceWrite(TimerTraceWriter *w, const TimerTraceRecord *r)
+{
+    if (fwrite(r,sizeof(*r),1u,w->F) == 1u) {
+        w->H.Records++;
+        if (r->Op == TIMER_TRACE_EVENT) {
+            w->H.Events++;
+        }
+    }
+}
+
+static inline void TimerTraceCommand(TimerTraceWriter *w, uint8_t op, uint8_t kind, uint16_t id,
+        uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+    TimerTraceRecord r = { w->Now, op, kind, id, a, b, c, d };
+
+    TimerTraceWrite(w,&r);
+}
+
+static inline void TimerTraceEvent(TimerTraceWriter *w, uint8_t kind, uint16_t id)
+{
+    TimerTraceCommand(w,TIMER_TRACE_EVENT,kind,id,0u,0u,0u,0u);
+}
+
+// writes the final header; false at an error
+static inline bool TimerTraceClose(TimerTraceWriter *w)
+{
+    bool ok;
+
+    if (w->F == NULL) {
+        return false;
+    }
+    w->H.Ticks = w->Now;
+    ok = (fseek(w->F,0L,SEEK_SET) == 0) && (fwrite(&w->H,sizeof(w->H),1u,w->F) == 1u);
+    ok = (fclose(w->F) == 0) && ok;
+    w->F = NULL;
+    return ok;
+}
+
+// all records of a trace in one allocation (free()); NULL at an error
+static inline TimerTraceRecord *TimerTraceLoad(const char *path, TimerTraceHeader *h)
+{
+    FILE *f = fopen(path,"rb");
+    TimerTraceRecord *r = NULL;
+
+    if (f == NULL) {
+        return NULL;
+    }
+    if ((fread(h,sizeof(*h),1u,f) == 1u) && (h->Magic == TIMER_TRACE_MAGIC) &&
+            (h->Version == TIMER_TRACE_VERSION) && (h->RecordSize == sizeof(TimerTraceRecord))) {
+        r = (TimerTraceRecord *)malloc((size_t)h->Records * sizeof(*r) + 1u);
+        if ((r != NULL) && (fread(r,sizeof(*r),h->Records,f) != h->Records)) {
+            free(r);
+            r = NULL;
+        }
+    }
+    fclose(f);
+    return r;
+}
+
+// recording of the commands of an application
+#define TraceSetSinglePulseTimer(w,id,x,per) { \
+    TimerTraceCommand(w,TIMER_TRACE_SET,TIMER_TRACE_SINGLE_PULSE,id,per,0u,0u,0u); \
+    SetSinglePulseTimer(x,per); \
+}
+#define TraceStopSinglePulseTimer(w,id,x) { \
+    TimerTraceCommand(w,TIMER_TRACE_STOP,TIMER_TRACE_SINGLE_PULSE,id,0u,0u,0u,0u); \
+    StopSinglePulseTimer(x); \
+}
+#define TraceSetContinuousTimer(w,id,x,per) { \
+    TimerTraceCommand(w,TIMER_TRACE_SET,TIMER_TRACE_CONTINUOUS,id,per,0u,0u,0u); \
+    SetContinuousTimer(x,per); \
+}
+#define TraceStopContinuousTimer(w,id,x) { \
+    TimerTraceCommand(w,TIMER_TRACE_STOP,TIMER_TRACE_CONTINUOUS,id,0u,0u,0u,0u); \
+    StopContinuousTimer(x); \
+}
+#define TraceSetFBVSinglePulseTimer(w,id,x,per,stepF,stepB,direction) { \
+    TimerTraceCommand(w,TIMER_TRACE_SET,TIMER_TRACE_FBV,id,per,stepF,stepB,((direction) == FBS_FORWARD) ? 1u : 0u); \
+    SetFBVSinglePulseTimer(x,per,stepF,stepB,direction); \
+}
+#define TraceStopFBVSinglePulseTimer(w,id,x) { \
+    TimerTraceCommand(w,TIMER_TRACE_STOP,TIMER_TRACE_FBV,id,0u,0u,0u,0u); \
+    StopFBVSinglePulseTimer(x); \
+}
+#define TraceSetFBVSinglePulseTimerDirection(w,id,x,direction) { \
+    TimerTraceCommand(w,TIMER_TRACE_DIRECTION,TIMER_TRACE_FBV,id,((direction) == FBS_FORWARD) ? 1u : 0u,0u,0u,0u); \
+    SetFBVSinglePulseTimerDirection(x,direction); \
+}
+#define TraceChangeFBVSinglePulseTimerSetting(w,id,x,per) { \
+    TimerTraceCommand(w,TIMER_TRACE_SETTING,TIMER_TRACE_FBV,id,per,0u,0u,0u); \
+    ChangeFBVSinglePulseTimerSetting(x,per); \
+}
+#define TraceSetAsymmetricContinuousTimer(w,id,x,perh,perl) { \
+    TimerTraceCommand(w,TIMER_TRACE_SET,TIMER_TRACE_ASYMMETRIC,id,perh,perl,0u,0u); \
+    SetAsymmetricContinuousTimer(x,perh,perl); \
+}
+#define TraceStopAsymmetricContinuousTimer(w,id,x) { \
+    TimerTraceCommand(w,TIMER_TRACE_STOP,TIMER_TRACE_ASYMMETRIC,id,0u,0u,0u,0u); \
+    StopAsymmetricContinuousTimer(x); \
+}
+#define TraceChangeAsymmetricContinuousTimerSetting(w,id,x,perh,perl) { \
+    TimerTraceCommand(w,TIMER_TRACE_SETTING,TIMER_TRACE_ASYMMETRIC,id,perh,perl,0u,0u); \
+    ChangeAsymmetricContinuousTimerSetting(x,perh,perl); \
+}
+#define TraceSetAsymmetricSinglePulseTimer(w,id,x,first,second,istate) { \
+    TimerTraceCommand(w,TIMER_TRACE_SET,TIMER_TRACE_ASYMMETRIC_SP,id,first,second,((istate) == ASPT_STATE_HIGH) ? 1u : 0u,0u); \
+    SetAsymmetricSinglePulseTimer(x,first,second,istate); \
+}
+#define TraceStopAsymmetricSinglePulseTimer(w,id,x) { \
+    TimerTraceCommand(w,TIMER_TRACE_STOP,TIMER_TRACE_ASYMMETRIC_SP,id,0u,0u,0u,0u); \
+    StopAsymmetricSinglePulseTimer(x); \
+}
+#define TraceSetBurstGenerator(w,id,x,pulses,ht,lt,it) { \
+    TimerTraceCommand(w,TIMER_TRACE_SET,TIMER_TRACE_BURST,id,pulses,ht,lt,it); \
+    SetBurstGenerator(x,pulses,ht,lt,it); \
+}
+#define TraceStopBurstGenerator(w,id,x) { \
+    TimerTraceCommand(w,TIMER_TRACE_STOP,TIMER_TRACE_BURST,id,0u,0u,0u,0u); \
+    StopBurstGenerator(x); \
+}
+
+#endif  // !defined(timetrace_h_included)
+
+// End of timetrace.h
@@ -0,0 +1,274 @@
+/* timewait.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if !defined(timewait_h_included)
+#define timewait_h_included
+
+// WAIT FOR TIMER EVENTS
+// The main loop sleeps until one of the event flags it consumes is set, instead
+// of checking the flags in a loop. The application lists its flags once and
+// gives every one a bit:
+//
+//  #define EV_T1   (0x01u)
+//  #define EV_G1   (0x02u)
+//
+//  static uint8_t TimersPending(void)
+//  {
+//      uint8_t m = 0u;
+//      if (SinglePulseTimerExpired(T1) == true) {
+//          m |= EV_T1;
+//      }
+//      if (BurstGeneratorTick(G1) == true) {
+//          m |= EV_G1;
+//      }
+//      return m;
+//  }
+//
+//  do {
+//      WaitForTimerEvent(TimersPending,ev);
+//      if ((ev & EV_T1) != 0u) { ... }
+//  } while (1);
+//
+// WaitForTimerEvent returns (in m) the events pending at the time, never 0.
+//
+// PIC (XC8): the flags are checked with the interrupts disabled (GIE = 0) and
+// the device goes to IDLE: the CPU stops, the peripherals and the RTC run on. An
+// enabled interrupt wakes it up even with GIE = 0, and an interrupt that came
+// after the check makes the SLEEP instruction a NOP, so no event is missed;
+// then GIE = 1 lets the interrupt routine run and the flags are checked again.
+// WaitForTimerEventOrSleep also takes the function that gives the distance to
+// the next timer event (NextEvent*): when no timer is armed (TIMER_WAIT_NONE)
+// the device goes to full SLEEP, where the RTC stops too, and only the wake-up
+// sources set up by the application (pin change, WDT) wake it.
+//
+// Host: the tick thread calls TimerWaitNotify(m) after its ticks with the mask
+// m of the events whose flags they set; m = 0 (no flag set) does nothing, so the
+// other ticks cost no atomic operation and wake no thread (on the PIC it is
+// empty, so a shared interrupt routine may call it too):
+//
+//  m = (SinglePulseTimerExpired(T1) == true) ? 0u : EV_T1;
+//  TickSinglePulseTimer(T1);
+//  if (SinglePulseTimerExpired(T1) == false) {  // not set by this tick
+//      m &= ~EV_T1;
+//  }
+//  TimerWaitNotify(m);
+//
+// The waiting thread blocks on a futex; in WaitForTimerEventOrSleep for at most
+// next() ticks of TIMER_WAIT_TICK_NS, without a timeout when no timer is armed.
+// TimerWaitOpenFd() gives in addition an eventfd for an epoll/io_uring loop.
+// The tick thread writes it only when the loop armed it before going to sleep,
+// once per arming, so the ticks cost no system call while the loop is busy:
+//
+//  fd = TimerWaitOpenFd(&TimerWait_);     // in the epoll set
+//  for (;;) {
+//      seq = TimerWaitSeq(&TimerWait_);
+//      if ((ev = TimersPending()) != 0u) { ...; continue; }
+//      if (TimerWaitArmFd(&TimerWait_,seq) == true) {
+//          epoll_wait(...);                // fd readable: TimerWaitReadFd()
+//      }
+//  }
+
+#include <stdint.h>
+
+#define TIMER_WAIT_NONE     (0xFFFFu)   // distance when no timer is armed
+
+#if defined(__XC8)
+
+#if !defined(TIMER_WAIT_IDLE)
+#define TIMER_WAIT_IDLE() { CPUDOZEbits.IDLEN = true; }     // the next SLEEP enters IDLE
+#define TIMER_WAIT_SLEEP() { CPUDOZEbits.IDLEN = false; }   // the next SLEEP enters SLEEP
+#endif  // !defined(TIMER_WAIT_IDLE)
+
+#define DEFINE_TIMER_WAIT
+#define EXTERN_TIMER_WAIT
+#define TimerWaitNotify(m)
+
+// the next instruction is executed before the interrupt routine
+#define TimerWaitSleep_() { \
+    CLRWDT(); \
+    SLEEP(); \
+    NOP(); \
+}
+
+#define WaitForTimerEvent(pending,m) { \
+    for (;;) { \
+        DisableInterrupts(); \
+        m = (pending)(); \
+        if (m != 0u) { \
+            EnableInterrupts(); \
+            break; \
+        } \
+        TIMER_WAIT_IDLE(); \
+        TimerWaitSleep_(); \
+        EnableInterrupts(); \
+    } \
+}
+
+#define WaitForTimerEventOrSleep(pending,next,m) { \
+    for (;;) { \
+        DisableInterrupts(); \
+        m = (pending)(); \
+        if (m != 0u) { \
+            EnableInterrupts(); \
+            break; \
+        } \
+        if ((next)() == TIMER_WAIT_NONE) { \
+            TIMER_WAIT_SLEEP(); \
+        } else { \
+            TIMER_WAIT_IDLE(); \
+        } \
+        TimerWaitSleep_(); \
+        EnableInterrupts(); \
+    } \
+}
+
+#else   // defined(__XC8)
+
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <time.h>
+#include <linux/futex.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if !defined(TIMER_WAIT_TICK_NS)
+#define TIMER_WAIT_TICK_NS  (1000000uL)     // tick period for the next() timeout
+#endif  // !defined(TIMER_WAIT_TICK_NS)
+
+typedef struct {
+    uint32_t Seq;           // notifications
+    uint32_t Waiters;       // threads in the futex or going to it
+    uint32_t Armed;         // the eventfd is written at the next notification
+    int Fd;                 // eventfd or -1
+} TimerWait;
+
+// definition in a C file
+#define DEFINE_TIMER_WAIT TimerWait TimerWait_ = { 0u, 0u, 0u, -1 };
+// declaration in a header file
+#define EXTERN_TIMER_WAIT extern TimerWait TimerWait_;
+
+// eventfd readable after notifications; -1 at an error
+static inline int TimerWaitOpenFd(TimerWait *w)
+{
+    if (w->Fd < 0) {
+        w->Fd = eventfd(0u,EFD_NONBLOCK | EFD_CLOEXEC);
+    }
+    return w->Fd;
+}
+
+#define TimerWaitSeq(w) __atomic_load_n(&(w)->Seq,__ATOMIC_ACQUIRE)
+
+// before the epoll loop sleeps: the next notification writes the eventfd; false
+// (do not sleep) when one came after seq was read
+static inline bool TimerWaitArmFd(TimerWait *w, uint32_t seq)
+{
+    __atomic_store_n(&w->Armed,1u,__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&w->Seq,__ATOMIC_SEQ_CST) != seq) {
+        __atomic_store_n(&w->Armed,0u,__ATOMIC_RELAXED);
+        return false;
+    }
+    return true;
+}
+
+// when the eventfd is readable
+static inline void TimerWaitReadFd(TimerWait *w)
+{
+    uint64_t n;
+
+    (void)read(w->Fd,&n,sizeof(n));
+}
+
+// by the tick thread after flags were set; a system call only when a thread
+// waits or the eventfd is armed
+static inline void TimerWaitNotify_(TimerWait *w)
+{
+    uint64_t one = 1u;
+
+    __atomic_fetch_add(&w->Seq,1u,__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&w->Waiters,__ATOMIC_SEQ_CST) != 0u) {
+        syscall(SYS_futex,&w->Seq,FUTEX_WAKE_PRIVATE,INT_MAX,NULL,NULL,0);
+    }
+    if ((__atomic_load_n(&w->Armed,__ATOMIC_SEQ_CST) != 0u) &&
+            (__atomic_exchange_n(&w->Armed,0u,__ATOMIC_SEQ_CST) != 0u) && (w->Fd >= 0)) {
+        (void)write(w->Fd,&one,sizeof(one));
+    }
+}
+
+// returns at once when a notification came after seq was read, else after the
+// notification or at the timeout (NULL: none)
+static inline void TimerWaitBlock_(TimerWait *w, uint32_t seq, const struct timespec *timeout)
+{
+    __atomic_fetch_add(&w->Waiters,1u,__ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&w->Seq,__ATOMIC_SEQ_CST) == seq) {
+        if ((syscall(SYS_futex,&w->Seq,FUTEX_WAIT_PRIVATE,seq,timeout,NULL,0) != 0) && (errno != EINTR)) {
+            break;
+        }
+    }
+    __atomic_fetch_sub(&w->Waiters,1u,__ATOMIC_SEQ_CST);
+}
+
+// timeout of d ticks, at least one; NULL when no timer is armed
+static inline const struct timespec *TimerWaitTimeout_(struct timespec *ts, uint32_t d)
+{
+    uint64_t ns;
+
+    if (d == TIMER_WAIT_NONE) {
+        return NULL;
+    }
+    ns = (uint64_t)((d != 0u) ? d : 1u) * TIMER_WAIT_TICK_NS;
+    ts->tv_sec = (time_t)(ns / 1000000000uLL);
+    ts->tv_nsec = (long)(ns % 1000000000uLL);
+    return ts;
+}
+
+// m - events set by the ticks; nothing when 0
+#define TimerWaitNotify(m) { \
+    if ((m) != 0u) { \
+        TimerWaitNotify_(&TimerWait_); \
+    } \
+}
+
+#define WaitForTimerEvent(pending,m) { \
+    for (;;) { \
+        uint32_t s_ = __atomic_load_n(&TimerWait_.Seq,__ATOMIC_ACQUIRE); \
+        m = (pending)(); \
+        if (m != 0u) { \
+            break; \
+        } \
+        TimerWaitBlock_(&TimerWait_,s_,NULL); \
+    } \
+}
+
+// the wait is bounded by the next timer event also when the tick thread does
+// not notify every flag the application consumes
+#define WaitForTimerEventOrSleep(pending,next,m) { \
+    struct timespec t_; \
+    for (;;) { \
+        uint32_t s_ = __atomic_load_n(&TimerWait_.Seq,__ATOMIC_ACQUIRE); \
+        m = (pending)(); \
+        if (m != 0u) { \
+            break; \
+        } \
+        TimerWaitBlock_(&TimerWait_,s_,TimerWaitTimeout_(&t_,(uint32_t)(next)())); \
+    } \
+}
+
+#endif  // defined(__XC8)
+
+#endif  // !defined(timewait_h_included)
+
+// End of timewait.h
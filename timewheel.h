@@ -0,0 +1,295 @@
+/* timewheel.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if !defined(timewheel_h_included)
+#define timewheel_h_included
+
+// HASHED TIMING WHEEL
+// Single pulse timers for large numbers of timeouts that are mostly stopped or
+// re-armed before they expire (connection idle timeouts). Records are 16 bytes,
+// defined with DEFINE_TIMER_WHEEL, and referred to by the same generation-checked
+// handles as the timers of timepool.h.
+//
+// The wheel has slots (a power of 2) lists; a timer expiring at tick e is kept
+// in the list of slot e % slots and only that list is visited on a tick.
+// - Stop only marks the record; it is unlinked when its slot is visited.
+// - Set of a timer that is already in a list does not touch the lists when the
+//   new expiration is not earlier than the previous one (the usual case of a
+//   re-armed timeout); the record is moved when its old slot is visited.
+// - Destroy unlinks the record at once, so it can be reused immediately.
+// Every operation except Tick is O(1). Tick costs the length of one list.
+// The size must be below 2^31 timers.
+//
+// Like timepool.h, the functions do not touch the interrupts.
+//
+//  DEFINE_TIMER_WHEEL(Idle,10000000u,65536u);
+//
+//  TimerWheelInit(&Idle);
+//  h = TimerWheelCreate(&Idle);
+//  TimerWheelSet(&Idle,h,30u*MU_1S);          // on every received packet
+//  ...
+//  TimerWheelTick(&Idle);
+//  while ((e = TimerWheelNextExpired(&Idle)) != TIMER_HANDLE_NULL) { ... }
+
+#include "timepool.h"
+
+#define TIMER_WHEEL_NIL     (0xFFFFFFFFuL)
+#define TIMER_WHEEL_HEAD    (0x80000000uL)  // Prev of the first record of a list: HEAD | slot
+
+// record flags
+#define TIMER_WHEEL_LINKED  (0x04u) // in a slot list
+
+typedef struct {
+    uint32_t Expires;       // tick of the expiration
+    uint32_t Next;          // next record in the slot list, or next free record
+    uint32_t Prev;          // previous record in the slot list, or TIMER_WHEEL_HEAD | slot
+    uint16_t Gen;           // generation; never 0
+    uint8_t State;          // TIMER_POOL_FREE, _IDLE or _ARMED
+    uint8_t Flags;          // TIMER_POOL_EXPIRED, TIMER_POOL_QUEUED, TIMER_WHEEL_LINKED
+} TimerWheelRecord;
+
+typedef struct {
+    TimerWheelRecord *Record;
+    uint32_t *Slot;         // heads of the slot lists
+    uint32_t *Expired;      // queue of expired indexes
+    uint32_t Size;
+    uint32_t Mask;          // slots - 1
+    uint32_t Now;
+    uint32_t FreeHead;
+    uint32_t FreeTail;
+    uint32_t NFree;
+    uint32_t ExpiredHead;
+    uint32_t NExpired;
+} TimerWheel;
+
+// definition of a wheel of size timers and slots lists in a C file
+#define DEFINE_TIMER_WHEEL(w,size,slots) TimerWheelRecord TW_Record_##w[size]; \
+    uint32_t TW_Slot_##w[slots]; \
+    uint32_t TW_Expired_##w[size]; \
+    TimerWheel w = { TW_Record_##w, TW_Slot_##w, TW_Expired_##w, (size), (slots) - 1u, 0u, 0u, 0u, 0u, 0u, 0u };
+// declaration in a header file
+#define EXTERN_TIMER_WHEEL(w) extern TimerWheel w;
+
+#define TimerWheelHandle_(w,i) (((TimerHandle)(w)->Record[i].Gen << 32) | (i))
+
+static inline void TimerWheelInit(TimerWheel *w)
+{
+    uint32_t i;
+
+    for (i = 0u; i < w->Size; i++) {
+        w->Record[i].State = TIMER_POOL_FREE;
+        w->Record[i].Flags = 0u;
+        w->Record[i].Gen = 1u;
+        w->Record[i].Next = i + 1u;
+    }
+    for (i = 0u; i <= w->Mask; i++) {
+        w->Slot[i] = TIMER_WHEEL_NIL;
+    }
+    w->Now = 0u;
+    w->FreeHead = 0u;
+    w->FreeTail = w->Size - 1u;
+    w->NFree = w->Size;
+    w->ExpiredHead = 0u;
+    w->NExpired = 0u;
+}
+
+// record of a valid handle or NULL for a stale one
+static inline TimerWheelRecord *TimerWheelRecordOf(TimerWheel *w, TimerHandle h)
+{
+    uint32_t i = TimerPoolIndex_(h);
+
+    if ((i < w->Size) && (w->Record[i].Gen == TimerPoolGen_(h)) && (w->Record[i].State != TIMER_POOL_FREE)) {
+        return &w->Record[i];
+    }
+    return NULL;
+}
+
+static inline bool TimerWheelValid(TimerWheel *w, TimerHandle h)
+{
+    return TimerWheelRecordOf(w,h) != NULL;
+}
+
+static inline void TimerWheelLink_(TimerWheel *w, uint32_t i)
+{
+    TimerWheelRecord *r = &w->Record[i];
+    uint32_t s = r->Expires & w->Mask;
+    uint32_t *head = &w->Slot[s];
+
+    r->Prev = TIMER_WHEEL_HEAD | s;
+    r->Next = *head;
+    if (*head != TIMER_WHEEL_NIL) {
+        w->Record[*head].Prev = i;
+    }
+    *head = i;
+    r->Flags |= TIMER_WHEEL_LINKED;
+}
+
+static inline void TimerWheelUnlink_(TimerWheel *w, uint32_t i)
+{
+    TimerWheelRecord *r = &w->Record[i];
+
+    if ((r->Prev & TIMER_WHEEL_HEAD) != 0u) {
+        w->Slot[r->Prev & ~TIMER_WHEEL_HEAD] = r->Next;
+    } else {
+        w->Record[r->Prev].Next = r->Next;
+    }
+    if (r->Next != TIMER_WHEEL_NIL) {
+        w->Record[r->Next].Prev = r->Prev;
+    }
+    r->Flags &= (uint8_t)~TIMER_WHEEL_LINKED;
+}
+
+// new stopped timer; TIMER_HANDLE_NULL when the wheel is full
+static inline TimerHandle TimerWheelCreate(TimerWheel *w)
+{
+    uint32_t i;
+
+    if (w->NFree == 0u) {
+        return TIMER_HANDLE_NULL;
+    }
+    i = w->FreeHead;
+    w->FreeHead = w->Record[i].Next;
+    w->NFree--;
+    w->Record[i].State = TIMER_POOL_IDLE;
+    w->Record[i].Flags &= TIMER_POOL_QUEUED;
+    return TimerWheelHandle_(w,i);
+}
+
+// release of the timer; false for a stale handle
+static inline bool TimerWheelDestroy(TimerWheel *w, TimerHandle h)
+{
+    TimerWheelRecord *r = TimerWheelRecordOf(w,h);
+    uint32_t i = TimerPoolIndex_(h);
+
+    if (r == NULL) {
+        return false;
+    }
+    if ((r->Flags & TIMER_WHEEL_LINKED) != 0u) {
+        TimerWheelUnlink_(w,i);
+    }
+    r->State = TIMER_POOL_FREE;
+    r->Flags &= TIMER_POOL_QUEUED;
+    if (++r->Gen == 0u) {
+        r->Gen = 1u;
+    }
+    if (w->NFree == 0u) {
+        w->FreeHead = i;
+    } else {
+        w->Record[w->FreeTail].Next = i;
+    }
+    w->FreeTail = i;
+    w->NFree++;
+    return true;
+}
+
+// start (or restart) to expire per ticks from now; false for a stale handle or per 0
+static inline bool TimerWheelSet(TimerWheel *w, TimerHandle h, uint32_t per)
+{
+    TimerWheelRecord *r = TimerWheelRecordOf(w,h);
+    uint32_t i = TimerPoolIndex_(h);
+    uint32_t e;
+
+    if ((r == NULL) || (per == 0u)) {
+        return false;
+    }
+    e = w->Now + per;
+    r->State = TIMER_POOL_ARMED;
+    r->Flags &= (uint8_t)~TIMER_POOL_EXPIRED;
+    if ((r->Flags & TIMER_WHEEL_LINKED) != 0u) {
+        // a linked record is visited not later than its expiration, so a later
+        // expiration can wait for that visit
+        if ((int32_t)(e - r->Expires) >= 0) {
+            r->Expires = e;
+            return true;
+        }
+        TimerWheelUnlink_(w,i);
+    }
+    r->Expires = e;
+    TimerWheelLink_(w,i);
+    return true;
+}
+
+// stop and forget a pending expiration; false for a stale handle
+static inline bool TimerWheelStop(TimerWheel *w, TimerHandle h)
+{
+    TimerWheelRecord *r = TimerWheelRecordOf(w,h);
+
+    if (r == NULL) {
+        return false;
+    }
+    r->State = TIMER_POOL_IDLE;
+    r->Flags &= (uint8_t)~TIMER_POOL_EXPIRED;
+    return true;
+}
+
+// true when the timer has expired and it was not read yet
+static inline bool TimerWheelExpired(TimerWheel *w, TimerHandle h)
+{
+    TimerWheelRecord *r = TimerWheelRecordOf(w,h);
+
+    return (r != NULL) && ((r->Flags & TIMER_POOL_EXPIRED) != 0u);
+}
+
+// tick; visits one slot list
+static inline void TimerWheelTick(TimerWheel *w)
+{
+    TimerWheelRecord *r;
+    uint32_t s, i, next;
+
+    s = ++w->Now & w->Mask;
+    for (i = w->Slot[s]; i != TIMER_WHEEL_NIL; i = next) {
+        r = &w->Record[i];
+        next = r->Next;
+        if (r->State != TIMER_POOL_ARMED) {
+            TimerWheelUnlink_(w,i);
+        } else if (r->Expires == w->Now) {
+            TimerWheelUnlink_(w,i);
+            r->State = TIMER_POOL_IDLE;
+            r->Flags |= TIMER_POOL_EXPIRED;
+            if ((r->Flags & TIMER_POOL_QUEUED) == 0u) {
+                r->Flags |= TIMER_POOL_QUEUED;
+                w->Expired[(w->ExpiredHead + w->NExpired++) % w->Size] = i;
+            }
+        } else if ((r->Expires & w->Mask) != s) {
+            TimerWheelUnlink_(w,i);
+            TimerWheelLink_(w,i);
+        }
+    }
+}
+
+// next expired timer in order of expiration, or TIMER_HANDLE_NULL; the
+// expiration is consumed
+static inline TimerHandle TimerWheelNextExpired(TimerWheel *w)
+{
+    TimerWheelRecord *r;
+    uint32_t i;
+
+    while (w->NExpired != 0u) {
+        i = w->Expired[w->ExpiredHead];
+        w->ExpiredHead = (w->ExpiredHead + 1u) % w->Size;
+        w->NExpired--;
+        r = &w->Record[i];
+        r->Flags &= (uint8_t)~TIMER_POOL_QUEUED;
+        if ((r->State != TIMER_POOL_FREE) && ((r->Flags & TIMER_POOL_EXPIRED) != 0u)) {
+            r->Flags &= (uint8_t)~TIMER_POOL_EXPIRED;
+            return TimerWheelHandle_(w,i);
+        }
+    }
+    return TIMER_HANDLE_NULL;
+}
+
+#endif  // !defined(timewheel_h_included)
+
+// End of timewheel.h
@@ -0,0 +1,226 @@
+/* timehyper.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Generator of the hyperperiod schedule tables of timehyper.h. The header is
+// written to the standard output; the periods are in RTC ticks.
+//
+//  gcc -O2 -o timehyper timehyper.c
+//  ./timehyper Blink LED=50 BEEP=30 WDOG=100+7 > blink.h
+//
+// A timer fires every per ticks from tick offset (1..per, default per). The
+// schedule is rejected when the hyperperiod does not fit 32 bits or it has more
+// than 65535 firing ticks; the ROM budget itself is checked when the header is
+// compiled (TIMER_HYPER_ROM).
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_TIMERS  (32u)
+#define MAX_ENTRIES (65535u)
+
+typedef struct {
+    const char *Name;
+    size_t NameLen;
+    uint32_t Per;
+    uint32_t Offset;
+    uint64_t Next;
+} Timer;
+
+static Timer timers[MAX_TIMERS];
+static uint32_t deltas[MAX_ENTRIES];
+static uint32_t masks[MAX_ENTRIES];
+
+static int Identifier(const char *s, size_t len)
+{
+    size_t i;
+
+    if ((len == 0u) || (isdigit((unsigned char)s[0]) != 0)) {
+        return 0;
+    }
+    for (i = 0u; i < len; i++) {
+        if ((isalnum((unsigned char)s[i]) == 0) && (s[i] != '_')) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static uint64_t Gcd(uint64_t a, uint64_t b)
+{
+    uint64_t t;
+
+    while (b != 0u) {
+        t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// smallest unsigned type for the value v
+static const char *Type(uint64_t v)
+{
+    return (v <= 0xFFu) ? "uint8_t" : (v <= 0xFFFFu) ? "uint16_t" : "uint32_t";
+}
+
+static unsigned Bytes(uint64_t v)
+{
+    return (v <= 0xFFu) ? 1u : (v <= 0xFFFFu) ? 2u : 4u;
+}
+
+static void Table(const char *type, const char *array, const char *name, const uint32_t *v, uint32_t n)
+{
+    uint32_t i;
+
+    printf("static const %s%s %s%s[%u] = {",type,name,array,name,n);
+    for (i = 0u; i < n; i++) {
+        printf("%s%s%u",(i == 0u) ? "" : ",",(i % 16u == 0u) ? "\n    " : " ",v[i]);
+    }
+    printf("\n};\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *name, *eq;
+    char *end;
+    uint64_t h = 1u, t, prev, maxd;
+    uint32_t n = 0u, e = 0u, k, j, all, m, first;
+    unsigned long v;
+
+    if (argc < 3) {
+        fprintf(stderr,"usage: %s schedule timer=per[+offset] ...\n",argv[0]);
+        return 2;
+    }
+    name = argv[1];
+    if (Identifier(name,strlen(name)) == 0) {
+        fprintf(stderr,"bad schedule name: %s\n",name);
+        return 1;
+    }
+    if ((uint32_t)(argc - 2) > MAX_TIMERS) {
+        fprintf(stderr,"more than %u timers\n",MAX_TIMERS);
+        return 1;
+    }
+    for (k = 0u; k < (uint32_t)(argc - 2); k++) {
+        eq = strchr(argv[k + 2u],'=');
+        timers[k].Name = argv[k + 2u];
+        timers[k].NameLen = (eq != NULL) ? (size_t)(eq - argv[k + 2u]) : 0u;
+        if ((eq == NULL) || (Identifier(timers[k].Name,timers[k].NameLen) == 0)) {
+            fprintf(stderr,"bad timer: %s\n",argv[k + 2u]);
+            return 1;
+        }
+        for (j = 0u; j < k; j++) {
+            if ((timers[j].NameLen == timers[k].NameLen) && (strncmp(timers[j].Name,timers[k].Name,timers[k].NameLen) == 0)) {
+                fprintf(stderr,"timer given twice: %s\n",argv[k + 2u]);
+                return 1;
+            }
+        }
+        v = strtoul(eq + 1,&end,0);
+        if ((end == eq + 1) || (v == 0u) || (v > 0xFFFFFFFFuL)) {
+            fprintf(stderr,"bad period: %s\n",argv[k + 2u]);
+            return 1;
+        }
+        timers[k].Per = (uint32_t)v;
+        timers[k].Offset = (uint32_t)v;
+        if (*end == '+') {
+            eq = end;
+            v = strtoul(eq + 1,&end,0);
+            if ((end == eq + 1) || (v == 0u) || (v > timers[k].Per)) {
+                fprintf(stderr,"bad offset (1..per): %s\n",argv[k + 2u]);
+                return 1;
+            }
+            timers[k].Offset = (uint32_t)v;
+        }
+        if (*end != '\0') {
+            fprintf(stderr,"bad timer: %s\n",argv[k + 2u]);
+            return 1;
+        }
+        timers[k].Next = timers[k].Offset;
+        h = h / Gcd(h,timers[k].Per) * timers[k].Per;
+        if (h > 0xFFFFFFFFuLL) {
+            fprintf(stderr,"the hyperperiod exceeds 32 bits\n");
+            return 1;
+        }
+        n++;
+    }
+
+    // firing ticks in 1..h; the first delta is from the last firing tick of the
+    // previous hyperperiod
+    prev = 0u;
+    for (;;) {
+        t = UINT64_MAX;
+        for (k = 0u; k < n; k++) {
+            if (timers[k].Next < t) {
+                t = timers[k].Next;
+            }
+        }
+        if (t > h) {
+            break;
+        }
+        if (e == MAX_ENTRIES) {
+            fprintf(stderr,"more than %u firing ticks in the hyperperiod of %llu ticks\n",MAX_ENTRIES,(unsigned long long)h);
+            return 1;
+        }
+        m = 0u;
+        for (k = 0u; k < n; k++) {
+            if (timers[k].Next == t) {
+                m |= 1uL << k;
+                timers[k].Next += timers[k].Per;
+            }
+        }
+        deltas[e] = (uint32_t)(t - prev);
+        masks[e] = m;
+        prev = t;
+        e++;
+    }
+    first = deltas[0];
+    deltas[0] += (uint32_t)(h - prev);
+    maxd = 0u;
+    for (j = 0u; j < e; j++) {
+        if (deltas[j] > maxd) {
+            maxd = deltas[j];
+        }
+    }
+    all = (n == 32u) ? 0xFFFFFFFFuL : (uint32_t)((1uL << n) - 1u);
+
+    printf("/* hyperperiod schedule %s generated by tools/timehyper:\n *",name);
+    for (k = 2u; k < (uint32_t)argc; k++) {
+        printf(" %s",argv[k]);
+    }
+    printf("\n * include in one C file after timehyper.h\n*/\n\n");
+    printf("#if !defined(hyper_%s_included)\n#define hyper_%s_included\n\n",name,name);
+    printf("#include <stdint.h>\n\n");
+    for (k = 0u; k < n; k++) {
+        printf("#define HYPER_%s_%.*s (0x%02Xu%s)\n",name,(int)timers[k].NameLen,timers[k].Name,
+                (unsigned)(1uL << k),(n > 16u) ? "L" : "");
+    }
+    printf("#define HYPER_ALL_%s (0x%02Xu%s)\n",name,(unsigned)all,(n > 16u) ? "L" : "");
+    printf("#define HYPER_PERIOD_%s (%lluuL)\n",name,(unsigned long long)h);
+    printf("#define HYPER_ENTRIES_%s (%uu)\n",name,e);
+    printf("#define HYPER_FIRST_%s (%uu)\n",name,first);
+    printf("#define HYPER_ROM_%s (%luuL)\n\n",name,(unsigned long)e * (Bytes(maxd) + Bytes(all)));
+    printf("#if HYPER_ROM_%s > TIMER_HYPER_ROM\n",name);
+    printf("#error \"%s: the schedule tables exceed TIMER_HYPER_ROM\"\n",name);
+    printf("#endif  // HYPER_ROM_%s > TIMER_HYPER_ROM\n\n",name);
+    printf("typedef %s HyperDelta_%s;\n",Type(maxd),name);
+    printf("typedef %s HyperIndex_%s;\n",(e <= 0xFFu) ? "uint8_t" : "uint16_t",name);
+    printf("typedef %s HyperMask_%s;\n\n",Type(all),name);
+    Table("HyperDelta_","HyperDeltas_",name,deltas,e);
+    Table("HyperMask_","HyperMasks_",name,masks,e);
+    printf("\n#endif  // !defined(hyper_%s_included)\n",name);
+    return 0;
+}